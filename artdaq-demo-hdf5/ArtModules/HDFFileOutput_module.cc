@@ -1,5 +1,6 @@
 #define TRACE_NAME "HDFFileOutput"
 
+#include "artdaq-demo-hdf5/ArtModules/detail/FragmentSelector.hh"
 #include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
 
 #include "art/Framework/Core/ModuleMacros.h"
@@ -18,14 +19,17 @@
 #include "canvas/Utilities/Exception.h"
 #include "fhiclcpp/ParameterSet.h"
 
+#include "artdaq-core/Utilities/ExceptionHandler.hh"
 #include "artdaq/ArtModules/ArtdaqFragmentNamingService.h"
 #include "artdaq/DAQdata/Globals.hh"
 
 #include <unistd.h>
+#include <chrono>
 #include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -54,6 +58,14 @@ public:
 	 * HDFFileOutput also expects the following Parameters:
 	 * "fileName" (REQUIRED): Name of the file to write
 	 * "directIO" (Default: false): Whether to use O_DIRECT
+	 * "metrics" (Default: {}): Configuration for the artdaq MetricManager
+	 * "writeMetricLevel" (Default: 2): Level of the write time, bytes written and events written metrics
+	 * "fragmentTypeMetricLevel" (Default: 3): Level of the per-Fragment-type bytes written metrics
+	 * "fileMetricLevel" (Default: 3): Level of the file size and dataset extension count metrics
+	 * "selection" (Default: {}): Events and Fragments to write, see artdaq::detail::FragmentSelector. Events which are
+	 *   not selected are not written at all (not even their header), and Fragments which are not selected are dropped
+	 *   from the events which are written. ContainerFragments are selected by their own type, Fragment ID and
+	 *   timestamp, and are kept or dropped whole: the Fragments inside them are not selected individually.
 	 */
 	explicit HDFFileOutput(ParameterSet const& ps);
 
@@ -77,20 +89,54 @@ private:
 	void writeRun(RunPrincipal& /*r*/) override{};
 	void writeSubRun(SubRunPrincipal& /*sr*/) override{};
 
+	void sendMetrics_(double write_time, size_t event_bytes, size_t rejected_bytes, std::map<std::string, size_t> const& type_bytes);
+	void sendSelectionMetrics_(size_t rejected_bytes);
+
 private:
 	std::string name_ = "HDFFileOutput";
 	art::FileStatsCollector fstats_;
 
 	std::unique_ptr<artdaq::hdf5::FragmentDataset> ntuple_;
+	artdaq::detail::FragmentSelector selector_;
+
+	int writeMetricLevel_;
+	int fragmentTypeMetricLevel_;
+	int fileMetricLevel_;
+	size_t bytesWritten_;
+	size_t eventsWritten_;
+	size_t bytesRejected_;
+	size_t eventsRejected_;
+	std::map<std::string, size_t> typeBytesWritten_;
 };
 
 art::HDFFileOutput::HDFFileOutput(ParameterSet const& ps)
     : OutputModule(ps)
     , fstats_{name_, processName()}
+    , selector_(ps.get<fhicl::ParameterSet>("selection", fhicl::ParameterSet()))
+    , writeMetricLevel_(ps.get<int>("writeMetricLevel", 2))
+    , fragmentTypeMetricLevel_(ps.get<int>("fragmentTypeMetricLevel", 3))
+    , fileMetricLevel_(ps.get<int>("fileMetricLevel", 3))
+    , bytesWritten_(0)
+    , eventsWritten_(0)
+    , bytesRejected_(0)
+    , eventsRejected_(0)
 {
 	TLOG(TLVL_DEBUG) << "Begin: HDFFileOutput::HDFFileOutput(ParameterSet const& ps)\n";
 
 	ntuple_ = artdaq::hdf5::MakeDatasetPlugin(ps, "dataset");
+
+	try
+	{
+		if (metricMan)
+		{
+			metricMan->initialize(ps.get<fhicl::ParameterSet>("metrics", fhicl::ParameterSet()), "art");
+			metricMan->do_start();
+		}
+	}
+	catch (...)
+	{
+		artdaq::ExceptionHandler(artdaq::ExceptionHandlerRethrow::no, "Error loading metrics in HDFFileOutput()");
+	}
 	TLOG(TLVL_DEBUG)
 	    << "End: HDFFileOutput::HDFFileOutput(ParameterSet const& ps)\n";
 }
@@ -106,6 +152,11 @@ void art::HDFFileOutput::beginJob()
 void art::HDFFileOutput::endJob()
 {
 	TLOG(TLVL_DEBUG) << "Begin: HDFFileOutput::endJob()\n";
+	if (selector_.enabled())
+	{
+		TLOG(TLVL_INFO) << "HDFFileOutput wrote " << eventsWritten_ << " events (" << bytesWritten_ << " bytes), selection rejected "
+		                << eventsRejected_ << " events and " << bytesRejected_ << " bytes";
+	}
 	TLOG(TLVL_DEBUG) << "End:   HDFFileOutput::endJob()\n";
 }
 
@@ -117,10 +168,15 @@ void art::HDFFileOutput::write(EventPrincipal& ep)
 	using RawEventHandle = art::Handle<RawEvent>;
 	using RawEventHeaderHandle = art::Handle<artdaq::detail::RawEventHeader>;
 
-	auto hdr_found = false;
 	auto sequence_id = artdaq::Fragment::InvalidSequenceID;
+	size_t event_bytes = 0;
+	size_t rejected_bytes = 0;
+	std::map<std::string, size_t> type_bytes;
+	std::chrono::steady_clock::duration write_time{0};
 
+	// Products and headers are retrieved before anything is written, so that the whole event can be selected first
 	TLOG(5) << "write: Retrieving event Fragments";
+	std::vector<RawEventHandle> raw_event_handles;
 	{
 		auto result_handles = std::vector<art::GroupQueryResult>();
 		auto const& wrapped = art::WrappedTypeID::make<RawEvent>();
@@ -141,13 +197,12 @@ void art::HDFFileOutput::write(EventPrincipal& ep)
 				TLOG(10) << "raw_event_handle labels: moduleLabel:" << raw_event_handle.provenance()->moduleLabel();
 				TLOG(10) << "raw_event_handle labels: processName:" << raw_event_handle.provenance()->processName();
 				sequence_id = (*raw_event_handle).front().sequenceID();
-
-				TLOG(5) << "write: Writing to dataset";
-				ntuple_->insertMany(*raw_event_handle);
+				raw_event_handles.push_back(raw_event_handle);
 			}
 		}
 	}
 	TLOG(5) << "write: Retrieving Event Header";
+	std::vector<RawEventHeaderHandle> raw_event_header_handles;
 	{
 		auto result_handles = std::vector<art::GroupQueryResult>();
 		auto const& wrapped = art::WrappedTypeID::make<artdaq::detail::RawEventHeader>();
@@ -163,30 +218,140 @@ void art::HDFFileOutput::write(EventPrincipal& ep)
 
 			if (raw_event_header_handle.isValid())
 			{
-				auto const& header = *raw_event_header_handle;
-
-				auto evt_sequence_id = header.sequence_id;
-				TLOG(TLVL_TRACE) << "HDFFileOutput::write header seq=" << evt_sequence_id;
+				raw_event_header_handles.push_back(raw_event_header_handle);
+			}
+		}
+	}
 
-				ntuple_->insertHeader(header);
+	if (selector_.enabled())
+	{
+		auto has_trigger = false;
+		if (selector_.requiresTrigger())
+		{
+			for (auto const& raw_event_handle : raw_event_handles)
+			{
+				has_trigger = has_trigger || selector_.hasTrigger(*raw_event_handle);
+			}
+		}
+		// Events without a RawEventHeader get a complete autogenerated one
+		auto is_complete = true;
+		for (auto const& raw_event_header_handle : raw_event_header_handles)
+		{
+			is_complete = is_complete && raw_event_header_handle->is_complete;
+		}
 
-				hdr_found = true;
-				TLOG(5) << "HDFFileOutput::write header seq=" << evt_sequence_id << " done errno=" << errno;
+		if (!selector_.acceptEvent(has_trigger, is_complete))
+		{
+			for (auto const& raw_event_handle : raw_event_handles)
+			{
+				for (auto const& frag : *raw_event_handle)
+				{
+					rejected_bytes += frag.sizeBytes();
+				}
 			}
+			TLOG(TLVL_TRACE) << "write: Event " << ep.event() << " (seq=" << sequence_id << ") not selected, has_trigger=" << has_trigger
+			                 << " is_complete=" << is_complete;
+			eventsRejected_++;
+			sendSelectionMetrics_(rejected_bytes);
+			return;
+		}
+	}
+
+	for (auto const& raw_event_handle : raw_event_handles)
+	{
+		auto const* frags = raw_event_handle.product();
+		artdaq::Fragments selected;
+		if (selector_.selectsFragments() && !selector_.selectFragments(*frags, selected, rejected_bytes))
+		{
+			TLOG(10) << "write: Selected " << selected.size() << " of " << frags->size() << " Fragments from " << raw_event_handle.provenance()->productInstanceName();
+			frags = &selected;
+		}
+		if (frags->empty()) continue;
+
+		size_t product_bytes = 0;
+		for (auto const& frag : *frags)
+		{
+			product_bytes += frag.sizeBytes();
 		}
+		event_bytes += product_bytes;
+		type_bytes[raw_event_handle.provenance()->productInstanceName()] += product_bytes;
+
+		TLOG(5) << "write: Writing to dataset";
+		auto insert_start_time = std::chrono::steady_clock::now();
+		ntuple_->insertMany(*frags);
+		write_time += std::chrono::steady_clock::now() - insert_start_time;
+	}
+
+	for (auto const& raw_event_header_handle : raw_event_header_handles)
+	{
+		auto const& header = *raw_event_header_handle;
+
+		auto evt_sequence_id = header.sequence_id;
+		TLOG(TLVL_TRACE) << "HDFFileOutput::write header seq=" << evt_sequence_id;
+
+		auto insert_start_time = std::chrono::steady_clock::now();
+		ntuple_->insertHeader(header);
+		write_time += std::chrono::steady_clock::now() - insert_start_time;
+
+		TLOG(5) << "HDFFileOutput::write header seq=" << evt_sequence_id << " done errno=" << errno;
 	}
-	if (!hdr_found)
+	if (raw_event_header_handles.empty())
 	{
 		TLOG(5) << "write: Header not found, autogenerating";
 		artdaq::detail::RawEventHeader hdr(ep.run(), ep.subRun(), ep.event(), sequence_id, 0);
 		hdr.is_complete = true;
 
+		auto insert_start_time = std::chrono::steady_clock::now();
 		ntuple_->insertHeader(hdr);
+		write_time += std::chrono::steady_clock::now() - insert_start_time;
 	}
 
 	fstats_.recordEvent(ep.eventID());
+	sendMetrics_(std::chrono::duration<double>(write_time).count(), event_bytes, rejected_bytes, type_bytes);
 
 	TLOG(TLVL_TRACE) << "End: HDFFileOUtput::write(EventPrincipal& ep)";
 }
 
+void art::HDFFileOutput::sendMetrics_(double write_time, size_t event_bytes, size_t rejected_bytes, std::map<std::string, size_t> const& type_bytes)
+{
+	sendSelectionMetrics_(rejected_bytes);
+
+	bytesWritten_ += event_bytes;
+	eventsWritten_++;
+	for (auto const& type : type_bytes)
+	{
+		typeBytesWritten_[type.first] += type.second;
+	}
+
+	TLOG(10) << "sendMetrics: write_time=" << write_time << " bytesWritten=" << bytesWritten_ << " metricMan=" << static_cast<void*>(metricMan.get());
+	if (metricMan)
+	{
+		metricMan->sendMetric("Avg Write Time", write_time, "s", writeMetricLevel_, artdaq::MetricMode::Average);
+		metricMan->sendMetric("Max Write Time", write_time, "s", writeMetricLevel_, artdaq::MetricMode::Maximum);
+		metricMan->sendMetric("Write Rate", event_bytes, "B/s", writeMetricLevel_, artdaq::MetricMode::Rate);
+		metricMan->sendMetric("bytesWritten", bytesWritten_, "B", writeMetricLevel_, artdaq::MetricMode::LastPoint);
+		metricMan->sendMetric("eventsWritten", eventsWritten_, "events", writeMetricLevel_, artdaq::MetricMode::LastPoint);
+		for (auto const& type : typeBytesWritten_)
+		{
+			metricMan->sendMetric("bytesWritten " + type.first, type.second, "B", fragmentTypeMetricLevel_, artdaq::MetricMode::LastPoint);
+		}
+		metricMan->sendMetric("HDF5 File Size", ntuple_->getFileSize(), "B", fileMetricLevel_, artdaq::MetricMode::LastPoint);
+		metricMan->sendMetric("HDF5 Dataset Extensions", ntuple_->getDatasetExtensionCount(), "extensions", fileMetricLevel_, artdaq::MetricMode::LastPoint);
+	}
+}
+
+void art::HDFFileOutput::sendSelectionMetrics_(size_t rejected_bytes)
+{
+	if (!selector_.enabled()) return;
+	bytesRejected_ += rejected_bytes;
+
+	TLOG(10) << "sendSelectionMetrics: bytesRejected=" << bytesRejected_ << " eventsRejected=" << eventsRejected_;
+	if (metricMan)
+	{
+		metricMan->sendMetric("Reject Rate", rejected_bytes, "B/s", writeMetricLevel_, artdaq::MetricMode::Rate);
+		metricMan->sendMetric("bytesRejected", bytesRejected_, "B", writeMetricLevel_, artdaq::MetricMode::LastPoint);
+		metricMan->sendMetric("eventsRejected", eventsRejected_, "events", writeMetricLevel_, artdaq::MetricMode::LastPoint);
+	}
+}
+
 DEFINE_ART_MODULE(art::HDFFileOutput)  // NOLINT(performance-unnecessary-value-param)
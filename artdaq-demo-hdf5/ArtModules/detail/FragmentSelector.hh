@@ -0,0 +1,238 @@
+#ifndef artdaq_ArtModules_detail_FragmentSelector_hh
+#define artdaq_ArtModules_detail_FragmentSelector_hh
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "fhiclcpp/ParameterSet.h"
+
+#include "tracemf.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace artdaq {
+namespace detail {
+
+/**
+ * \brief Event and Fragment selection applied by HDFFileOutput before data reaches the Dataset plugin
+ *
+ * The configuration is compiled into flat tables when the selector is constructed: one flag byte per Fragment type,
+ * one accept byte per Fragment ID (only allocated when IDs are listed), and a sorted list of disjoint timestamp
+ * windows. Deciding whether a Fragment is kept is then two table lookups and a binary search, without per-Fragment
+ * set or map lookups.
+ */
+class FragmentSelector
+{
+public:
+	/**
+	 * \brief FragmentSelector Constructor
+	 * \param ps ParameterSet used to configure the FragmentSelector
+	 *
+	 * \verbatim
+	 * FragmentSelector accepts the following Parameters:
+	 * "includeTypes" (Default: []): Fragment types to write (all types if empty)
+	 * "excludeTypes" (Default: []): Fragment types not to write, applied after includeTypes
+	 * "includeFragmentIDs" (Default: []): Fragment IDs to write (all IDs if empty)
+	 * "excludeFragmentIDs" (Default: []): Fragment IDs not to write, applied after includeFragmentIDs
+	 * "timestampWindows" (Default: []): List of [begin, end) Fragment timestamp windows. If set, only Fragments with a
+	 *   timestamp inside one of the windows are written.
+	 * "triggerTypes" (Default: []): If set, events are only written if they contain a Fragment of one of these types
+	 *   (checked before the Fragment selection, ContainerFragments count with their own type)
+	 * "requireComplete" (Default: false): Only write events whose RawEventHeader has is_complete set
+	 * "prescale" (Default: 1): Write one in this many of the events which pass the other event requirements
+	 * \endverbatim
+	 *
+	 * The type, Fragment ID and timestamp selection applies to the Fragments as they appear in the event. A
+	 * ContainerFragment is selected by its own type (artdaq::Fragment::ContainerFragmentType), Fragment ID and timestamp,
+	 * not by the Fragments it contains, and is written or dropped as a whole.
+	 */
+	explicit FragmentSelector(fhicl::ParameterSet const& ps)
+	    : id_mask_(0)
+	    , require_trigger_(false)
+	    , require_complete_(ps.get<bool>("requireComplete", false))
+	    , prescale_(ps.get<size_t>("prescale", 1))
+	    , prescale_count_(0)
+	    , fragment_cuts_(false)
+	{
+		if (prescale_ == 0)
+		{
+			TLOG(TLVL_WARNING) << "FragmentSelector: prescale must be at least 1, writing all events";
+			prescale_ = 1;
+		}
+
+		auto includeTypes = ps.get<std::vector<int>>("includeTypes", std::vector<int>());
+		auto excludeTypes = ps.get<std::vector<int>>("excludeTypes", std::vector<int>());
+		auto triggerTypes = ps.get<std::vector<int>>("triggerTypes", std::vector<int>());
+		type_flags_.fill(includeTypes.empty() ? KeepType : 0);
+		auto setTypeFlag = [this](int type, uint8_t flag, bool set, char const* param) {
+			if (type < 0 || type > std::numeric_limits<artdaq::Fragment::type_t>::max())
+			{
+				TLOG(TLVL_WARNING) << "FragmentSelector: Ignoring invalid Fragment type " << type << " in " << param;
+				return;
+			}
+			if (set)
+				type_flags_[type] |= flag;
+			else
+				type_flags_[type] &= ~flag;
+		};
+		for (auto type : includeTypes) setTypeFlag(type, KeepType, true, "includeTypes");
+		for (auto type : excludeTypes) setTypeFlag(type, KeepType, false, "excludeTypes");
+		for (auto type : triggerTypes) setTypeFlag(type, TriggerType, true, "triggerTypes");
+		require_trigger_ = !triggerTypes.empty();
+		fragment_cuts_ = !includeTypes.empty() || !excludeTypes.empty();
+
+		auto includeIDs = ps.get<std::vector<artdaq::Fragment::fragment_id_t>>("includeFragmentIDs", std::vector<artdaq::Fragment::fragment_id_t>());
+		auto excludeIDs = ps.get<std::vector<artdaq::Fragment::fragment_id_t>>("excludeFragmentIDs", std::vector<artdaq::Fragment::fragment_id_t>());
+		if (includeIDs.empty() && excludeIDs.empty())
+		{
+			// A single entry, which every ID maps to through a zero mask
+			id_accept_.assign(1, 1);
+		}
+		else
+		{
+			id_accept_.assign(static_cast<size_t>(std::numeric_limits<artdaq::Fragment::fragment_id_t>::max()) + 1, includeIDs.empty() ? 1 : 0);
+			id_mask_ = std::numeric_limits<artdaq::Fragment::fragment_id_t>::max();
+			for (auto id : includeIDs) id_accept_[id] = 1;
+			for (auto id : excludeIDs) id_accept_[id] = 0;
+			fragment_cuts_ = true;
+		}
+
+		// Sort and merge the windows, so that a Fragment is checked against only the last window beginning at or before it
+		auto windows = ps.get<std::vector<std::pair<uint64_t, uint64_t>>>("timestampWindows", std::vector<std::pair<uint64_t, uint64_t>>());
+		std::sort(windows.begin(), windows.end());
+		for (auto const& window : windows)
+		{
+			if (window.second <= window.first)
+			{
+				TLOG(TLVL_WARNING) << "FragmentSelector: Ignoring empty timestamp window [" << window.first << ", " << window.second << ")";
+				continue;
+			}
+			if (!window_begins_.empty() && window.first <= window_ends_.back())
+			{
+				window_ends_.back() = std::max(window_ends_.back(), window.second);
+				continue;
+			}
+			window_begins_.push_back(window.first);
+			window_ends_.push_back(window.second);
+		}
+		if (window_begins_.empty())
+		{
+			if (!windows.empty())
+			{
+				TLOG(TLVL_WARNING) << "FragmentSelector: No valid timestamp windows, Fragments are not selected by timestamp";
+			}
+			window_begins_.push_back(0);
+			window_ends_.push_back(std::numeric_limits<uint64_t>::max());
+		}
+		else
+		{
+			fragment_cuts_ = true;
+		}
+	}
+
+	/**
+	 * \brief Whether any selection is configured
+	 * \return False if every event and Fragment is written, so that the selection can be skipped
+	 */
+	bool enabled() const { return fragment_cuts_ || require_trigger_ || require_complete_ || prescale_ > 1; }
+
+	/**
+	 * \brief Whether the Fragment selection can drop Fragments
+	 * \return True if types, Fragment IDs or timestamp windows are configured
+	 */
+	bool selectsFragments() const { return fragment_cuts_; }
+
+	/**
+	 * \brief Check whether a Fragment passes the type, Fragment ID and timestamp selection
+	 * \param frag Fragment to check (a ContainerFragment is checked itself, not its contents)
+	 * \return Whether the Fragment should be written
+	 */
+	bool acceptFragment(artdaq::Fragment const& frag) const
+	{
+		auto ts = frag.timestamp();
+		// Last window beginning at or before the timestamp; the first window always exists, so index 0 is safe
+		auto window = std::upper_bound(window_begins_.begin(), window_begins_.end(), ts) - window_begins_.begin();
+		window = window > 0 ? window - 1 : 0;
+		return ((type_flags_[frag.type()] & KeepType) != 0) & (id_accept_[frag.fragmentID() & id_mask_] != 0) &
+		       (ts >= window_begins_[window]) & (ts < window_ends_[window]);
+	}
+
+	/**
+	 * \brief Select the Fragments of one product
+	 * \param frags Fragments of the product
+	 * \param selected Filled with copies of the selected Fragments, if some are dropped
+	 * \param rejected_bytes Incremented by the size of the dropped Fragments
+	 * \return True if all Fragments were selected (selected is then left empty and frags can be written as they are)
+	 */
+	bool selectFragments(artdaq::Fragments const& frags, artdaq::Fragments& selected, size_t& rejected_bytes) const
+	{
+		auto first_rejected = std::find_if(frags.begin(), frags.end(), [this](artdaq::Fragment const& frag) { return !acceptFragment(frag); });
+		if (first_rejected == frags.end()) return true;
+
+		selected.reserve(frags.size());
+		selected.insert(selected.end(), frags.begin(), first_rejected);
+		for (auto it = first_rejected; it != frags.end(); ++it)
+		{
+			if (acceptFragment(*it))
+				selected.push_back(*it);
+			else
+				rejected_bytes += it->sizeBytes();
+		}
+		return false;
+	}
+
+	/**
+	 * \brief Whether events must contain a Fragment of one of the trigger types
+	 * \return True if triggerTypes is configured
+	 */
+	bool requiresTrigger() const { return require_trigger_; }
+
+	/**
+	 * \brief Check whether any of the Fragments is of a trigger type
+	 * \param frags Fragments to check
+	 * \return Whether a trigger-type Fragment was found
+	 */
+	bool hasTrigger(artdaq::Fragments const& frags) const
+	{
+		uint8_t flags = 0;
+		for (auto const& frag : frags) flags |= type_flags_[frag.type()];
+		return (flags & TriggerType) != 0;
+	}
+
+	/**
+	 * \brief Apply the event requirements and the prescale
+	 * \param has_trigger Whether the event contains a Fragment of one of the trigger types
+	 * \param is_complete Whether the event is complete
+	 * \return Whether the event should be written
+	 *
+	 * The prescale only counts events which pass the trigger and completeness requirements.
+	 */
+	bool acceptEvent(bool has_trigger, bool is_complete)
+	{
+		if ((require_trigger_ && !has_trigger) || (require_complete_ && !is_complete)) return false;
+		return prescale_count_++ % prescale_ == 0;
+	}
+
+private:
+	static constexpr uint8_t KeepType = 0x1;
+	static constexpr uint8_t TriggerType = 0x2;
+
+	std::array<uint8_t, static_cast<size_t>(std::numeric_limits<artdaq::Fragment::type_t>::max()) + 1> type_flags_;
+	std::vector<uint8_t> id_accept_;
+	artdaq::Fragment::fragment_id_t id_mask_;
+	std::vector<uint64_t> window_begins_;
+	std::vector<uint64_t> window_ends_;
+	bool require_trigger_;
+	bool require_complete_;
+	size_t prescale_;
+	size_t prescale_count_;
+	bool fragment_cuts_;
+};
+
+}  // namespace detail
+}  // namespace artdaq
+
+#endif  // artdaq_ArtModules_detail_FragmentSelector_hh
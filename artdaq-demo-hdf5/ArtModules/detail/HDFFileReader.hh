@@ -25,6 +25,7 @@
 #include <sys/time.h>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace artdaq {
 namespace detail {
@@ -62,6 +63,10 @@ struct HDFFileReader
 	std::chrono::steady_clock::time_point last_read_time;       ///< Time last read was completed
 	unsigned readNext_calls_;                                   ///< The number of times readNext has been called
 	std::unique_ptr<artdaq::hdf5::FragmentDataset> inputFile_;  ///< The Dataset plugin which this input source will be reading from
+	std::set<std::string> instance_names_;                      ///< The product instance names registered with art
+	std::vector<std::pair<uint64_t, uint64_t>> time_ranges_;    ///< Time ranges to read as events, instead of the events in the file
+	size_t next_time_range_;                                    ///< Index of the next time range to read
+	artdaq::hdf5::FragmentTimeRangeFilter time_range_filter_;   ///< Fragment selection used when reading time ranges
 
 	/**
 	 * \brief HDFFileReader Constructor
@@ -73,6 +78,12 @@ struct HDFFileReader
 	 * HDFFileReader accepts the following Parameters:
 	 * "raw_data_label" (Default: "daq"): The label to use for all raw data
 	 * "shared_memory_key" (Default: 0xBEE7): The key for the shared memory segment
+	 * "timeRanges" (Default: []): List of [begin, end) Fragment timestamp ranges. If set, each range is read from the
+	 *   dataset with FragmentDataset::readTimeRange and becomes one art event, instead of the events stored in the file.
+	 *   The run and subrun are taken from the header of an event overlapping the range, and events are numbered from 1.
+	 * "timeRangeFragmentTypes" (Default: []): Fragment types to read for time ranges (all types if empty)
+	 * "timeRangeFragmentIDs" (Default: []): Fragment IDs to read for time ranges (all IDs if empty)
+	 * "trimFrames" (Default: true): Whether framed Fragments are trimmed to the frames in each time range
 	 * \endverbatim
 	 */
 	HDFFileReader(fhicl::ParameterSet const& ps,
@@ -84,6 +95,8 @@ struct HDFFileReader
 	    , bytesRead(0)
 	    , last_read_time(std::chrono::steady_clock::now())
 	    , readNext_calls_(0)
+	    , time_ranges_(ps.get<std::vector<std::pair<uint64_t, uint64_t>>>("timeRanges", std::vector<std::pair<uint64_t, uint64_t>>()))
+	    , next_time_range_(0)
 	{
 #if 0
 		volatile bool keep_looping = true;
@@ -95,6 +108,16 @@ struct HDFFileReader
 		art::ServiceHandle<ArtdaqFragmentNamingServiceInterface> translator;
 		inputFile_ = artdaq::hdf5::MakeDatasetPlugin(ps, "dataset");
 
+		for (auto type : ps.get<std::vector<artdaq::Fragment::type_t>>("timeRangeFragmentTypes", std::vector<artdaq::Fragment::type_t>()))
+		{
+			time_range_filter_.types.insert(type);
+		}
+		for (auto id : ps.get<std::vector<artdaq::Fragment::fragment_id_t>>("timeRangeFragmentIDs", std::vector<artdaq::Fragment::fragment_id_t>()))
+		{
+			time_range_filter_.fragment_ids.insert(id);
+		}
+		time_range_filter_.trim_frames = ps.get<bool>("trimFrames", true);
+
 		help.reconstitutes<Fragments, art::InEvent>(pretend_module_name, translator->GetUnidentifiedInstanceName());
 
 		// Workaround for #22979
@@ -114,11 +137,13 @@ struct HDFFileReader
 			artdaq::ExceptionHandler(artdaq::ExceptionHandlerRethrow::no, "Error loading metrics in HDFFileReader()");
 		}
 
-		std::set<std::string> instance_names = translator->GetAllProductInstanceNames();
-		for (const auto& set_iter : instance_names)
+		for (const auto& set_iter : translator->GetAllProductInstanceNames())
 		{
 			help.reconstitutes<Fragments, art::InEvent>(pretend_module_name, set_iter);
 		}
+		// The unidentified instance name was registered above, it is only added for the instance name lookup
+		instance_names_ = translator->GetAllProductInstanceNames();
+		instance_names_.insert(translator->GetUnidentifiedInstanceName());
 
 		TLOG_INFO("HDFFileReader") << "HDFFileReader initialized with ParameterSet: " << ps.to_string();
 	}
@@ -187,7 +212,7 @@ struct HDFFileReader
 
 		auto read_start_time = std::chrono::steady_clock::now();
 
-		std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> eventMap = inputFile_->readNextEvent();
+		std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> eventMap = time_ranges_.empty() ? inputFile_->readNextEventByInstanceName() : readNextTimeRange_(*translator);
 		if (eventMap.empty())
 		{
 			TLOG_ERROR("HDFFileReader") << "No data received, either because of incompatible plugin or end of file. Returning false (should exit art)";
@@ -196,9 +221,9 @@ struct HDFFileReader
 		}
 
 		auto got_event_time = std::chrono::steady_clock::now();
-		auto firstFragmentType = eventMap.begin()->first;
+		auto firstFragmentType = eventMap.begin()->second->at(0).type();
 		TLOG_DEBUG("HDFFileReader") << "First Fragment type is " << static_cast<int>(firstFragmentType) << " ("
-		                            << translator->GetInstanceNameForType(firstFragmentType) << ")";
+		                            << eventMap.begin()->first << ")";
 		// We return false, indicating we're done reading, if:
 		//   1) we did not obtain an event, because we timed out and were
 		//      configured NOT to keep trying after a timeout, or
@@ -212,6 +237,11 @@ struct HDFFileReader
 		}
 
 		auto evtHeader = inputFile_->getEventHeader(eventMap.begin()->second->at(0).sequenceID());
+		if (evtHeader != nullptr && !time_ranges_.empty())
+		{
+			// Time range events take their run and subrun from the first overlapping event, and are numbered by range
+			evtHeader->event_id = static_cast<uint32_t>(next_time_range_);
+		}
 		if (evtHeader == nullptr)
 		{
 			TLOG_DEBUG("HDFFileReader") << "Did not receive Event Header for sequence ID " << eventMap.begin()->second->at(0).sequenceID() << ", skipping event";
@@ -313,44 +343,53 @@ struct HDFFileReader
 		}
 		outE = pmaker.makeEventPrincipal(evtHeader->run_id, evtHeader->subrun_id, evtHeader->event_id, currentTime);
 
-		// insert the Fragments of each type into the EventPrincipal
-		for (auto& fragmentTypePair : eventMap)
+		// insert the Fragments of each instance name into the EventPrincipal
+		std::unordered_map<std::string, std::unique_ptr<Fragments>> derived_fragments;
+		for (auto& fragmentLabelPair : eventMap)
 		{
-			auto type_code = fragmentTypePair.first;
-			TLOG_TRACE("HDFFileReader") << "Before GetFragmentsByType call, type is " << static_cast<int>(type_code);
-			TLOG_TRACE("HDFFileReader") << "After GetFragmentsByType call, number of fragments is " << fragmentTypePair.second->size();
-
-			std::unordered_map<std::string, std::unique_ptr<Fragments>> derived_fragments;
-			for (auto& frag : *fragmentTypePair.second)
+			for (auto& frag : *fragmentLabelPair.second)
 			{
 				bytesRead += frag.sizeBytes();
+			}
+
+			if (instance_names_.count(fragmentLabelPair.first) != 0u && derived_fragments.count(fragmentLabelPair.first) == 0u)
+			{
+				TLOG_TRACE("HDFFileReader") << "Using " << fragmentLabelPair.second->size() << " Fragments with label " << fragmentLabelPair.first << " from dataset as-is";
+				derived_fragments[fragmentLabelPair.first] = std::move(fragmentLabelPair.second);
+				continue;
+			}
 
+			// The dataset's instance name is not one that art knows about (e.g. the file was written with a different
+			// FragmentNameHelper configuration), so translate each Fragment with the naming service instead
+			TLOG_DEBUG("HDFFileReader") << "Instance name " << fragmentLabelPair.first << " from dataset is not registered or was already used, translating Fragments";
+			for (auto& frag : *fragmentLabelPair.second)
+			{
 				std::pair<bool, std::string> instance_name_result =
 				    translator->GetInstanceNameForFragment(frag);
 				std::string label = instance_name_result.second;
 				if (!instance_name_result.first)
 				{
 					TLOG_WARNING("HDFFileReader")
-					    << "UnknownFragmentType: The product instance name mapping for fragment type \"" << static_cast<int>(type_code)
+					    << "UnknownFragmentType: The product instance name mapping for fragment type \"" << static_cast<int>(frag.type())
 					    << "\" is not known. Fragments of this "
 					    << "type will be stored in the event with an instance name of \"" << label << "\".";
 				}
 				if (!derived_fragments.count(label))
 				{
 					derived_fragments[label] = std::make_unique<Fragments>();
+					derived_fragments[label]->reserve(fragmentLabelPair.second->size());
 				}
-				auto fragSize = frag.size();
-				TLOG_TRACE("HDFFileReader") << "Moving Fragment with size " << fragSize << " from type map (type=" << type_code << ") to derived map label=" << label;
+				TLOG_TRACE("HDFFileReader") << "Moving Fragment with size " << frag.size() << " from dataset label " << fragmentLabelPair.first << " to derived map label=" << label;
 				derived_fragments[label]->emplace_back(std::move(frag));
 			}
-			TLOG_TRACE("HDFFileReader") << "Placing derived fragments in outE";
-			for (auto& type : derived_fragments)
-			{
-				put_product_in_principal(std::move(type.second),
-				                         *outE,
-				                         pretend_module_name,
-				                         type.first);
-			}
+		}
+		TLOG_TRACE("HDFFileReader") << "Placing derived fragments in outE";
+		for (auto& type : derived_fragments)
+		{
+			put_product_in_principal(std::move(type.second),
+			                         *outE,
+			                         pretend_module_name,
+			                         type.first);
 		}
 		TLOG_TRACE("HDFFileReader") << "After putting fragments in event";
 
@@ -371,6 +410,39 @@ struct HDFFileReader
 		last_read_time = std::chrono::steady_clock::now();
 		return true;
 	}
+
+private:
+	/**
+	 * \brief Read the Fragments of the next non-empty time range, grouped by product instance name
+	 * \param translator Naming service used to find the instance name of each Fragment
+	 * \return Map of instance names and Fragments, empty once all time ranges have been read
+	 */
+	std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> readNextTimeRange_(ArtdaqFragmentNamingServiceInterface& translator)
+	{
+		std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> output;
+		while (output.empty() && next_time_range_ < time_ranges_.size())
+		{
+			auto const& range = time_ranges_[next_time_range_++];
+			TLOG_DEBUG("HDFFileReader") << "Reading time range " << next_time_range_ << " [" << range.first << ", " << range.second << ")";
+			auto frags = inputFile_->readTimeRange(range.first, range.second, time_range_filter_);
+			if (frags.empty())
+			{
+				TLOG_WARNING("HDFFileReader") << "No Fragments found in time range [" << range.first << ", " << range.second << "), skipping";
+				continue;
+			}
+
+			for (auto& frag : frags)
+			{
+				auto label = translator.GetInstanceNameForFragment(frag).second;
+				if (!output.count(label))
+				{
+					output[label] = std::make_unique<Fragments>();
+				}
+				output[label]->emplace_back(std::move(frag));
+			}
+		}
+		return output;
+	}
 };
 }  // namespace detail
 }  // namespace artdaq
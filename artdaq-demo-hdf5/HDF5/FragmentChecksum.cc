@@ -0,0 +1,157 @@
+#include "artdaq-demo-hdf5/HDF5/FragmentChecksum.hh"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace {
+constexpr uint32_t Crc32cPolynomial = 0x82F63B78;  // Reflected Castagnoli polynomial
+
+using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+Crc32cTables makeTables()
+{
+	Crc32cTables tables{};
+	for (uint32_t ii = 0; ii < 256; ++ii)
+	{
+		uint32_t crc = ii;
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1) ^ ((crc & 1u) != 0u ? Crc32cPolynomial : 0u);
+		}
+		tables[0][ii] = crc;
+	}
+	for (uint32_t ii = 0; ii < 256; ++ii)
+	{
+		for (size_t slice = 1; slice < 8; ++slice)
+		{
+			tables[slice][ii] = (tables[slice - 1][ii] >> 8) ^ tables[0][tables[slice - 1][ii] & 0xFF];
+		}
+	}
+	return tables;
+}
+
+uint32_t crc32cTable(uint8_t const* data, size_t bytes, uint32_t crc)
+{
+	static const Crc32cTables tables = makeTables();
+	while (bytes >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		word ^= crc;
+		crc = tables[7][word & 0xFF] ^ tables[6][(word >> 8) & 0xFF] ^ tables[5][(word >> 16) & 0xFF] ^ tables[4][(word >> 24) & 0xFF] ^
+		      tables[3][(word >> 32) & 0xFF] ^ tables[2][(word >> 40) & 0xFF] ^ tables[1][(word >> 48) & 0xFF] ^ tables[0][word >> 56];
+		data += 8;
+		bytes -= 8;
+	}
+	while (bytes-- > 0)
+	{
+		crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xFF];
+	}
+	return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc)
+{
+	uint64_t crc64 = crc;
+	while (bytes >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+		data += 8;
+		bytes -= 8;
+	}
+	crc = static_cast<uint32_t>(crc64);
+	while (bytes-- > 0)
+	{
+		crc = _mm_crc32_u8(crc, *data++);
+	}
+	return crc;
+}
+
+bool detectHardware()
+{
+	unsigned eax, ebx, ecx, edx;
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0 && (ecx & bit_SSE4_2) != 0;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+// The ACLE intrinsics need the compiler to target the CRC extension (e.g. -march=armv8-a+crc); without it the table is used
+uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc)
+{
+	while (bytes >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		crc = __crc32cd(crc, word);
+		data += 8;
+		bytes -= 8;
+	}
+	while (bytes-- > 0)
+	{
+		crc = __crc32cb(crc, *data++);
+	}
+	return crc;
+}
+
+bool detectHardware()
+{
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#else
+uint32_t crc32cHardware(uint8_t const* data, size_t bytes, uint32_t crc)
+{
+	return crc32cTable(data, bytes, crc);
+}
+
+bool detectHardware()
+{
+	return false;
+}
+#endif
+}  // namespace
+
+bool artdaq::hdf5::crc32cIsHardware()
+{
+	static const bool hardware = detectHardware();
+	return hardware;
+}
+
+uint32_t artdaq::hdf5::crc32c(void const* data, size_t bytes, uint32_t crc)
+{
+	auto bytePtr = static_cast<uint8_t const*>(data);
+	crc = ~crc;
+	crc = crc32cIsHardware() ? crc32cHardware(bytePtr, bytes, crc) : crc32cTable(bytePtr, bytes, crc);
+	return ~crc;
+}
+
+uint32_t artdaq::hdf5::crc32cSoftware(void const* data, size_t bytes, uint32_t crc)
+{
+	return ~crc32cTable(static_cast<uint8_t const*>(data), bytes, ~crc);
+}
+
+uint32_t artdaq::hdf5::fragmentChecksum(artdaq::detail::RawFragmentHeader const& hdr, artdaq::RawDataType const* data, size_t dataWords)
+{
+	std::array<uint64_t, 6> fields{hdr.sequence_id, hdr.fragment_id, hdr.type, hdr.timestamp, hdr.word_count, hdr.metadata_word_count};
+	auto crc = crc32c(fields.data(), sizeof(fields));
+	return crc32c(data, dataWords * sizeof(artdaq::RawDataType), crc);
+}
+
+uint32_t artdaq::hdf5::fragmentChecksum(artdaq::RawDataType const* words)
+{
+	artdaq::detail::RawFragmentHeader hdr;
+	memcpy(&hdr, words, sizeof(hdr));
+	auto headerWords = artdaq::detail::RawFragmentHeader::num_words();
+	return fragmentChecksum(hdr, words + headerWords, hdr.word_count - headerWords);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
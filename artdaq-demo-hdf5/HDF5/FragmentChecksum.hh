@@ -0,0 +1,73 @@
+#ifndef artdaq_demo_hdf5_HDF5_FragmentChecksum_hh
+#define artdaq_demo_hdf5_HDF5_FragmentChecksum_hh 1
+
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Compute the CRC-32C (Castagnoli) of a buffer
+ * @param data Buffer to checksum
+ * @param bytes Size of the buffer, in bytes
+ * @param crc CRC of the preceding data, to checksum a message in several pieces (0 to start a new message)
+ * @return CRC-32C of the data
+ *
+ * Uses the SSE4.2 or ARMv8 CRC32 instructions when the CPU provides them, and a slice-by-8 table otherwise. The ARMv8
+ * instructions are only used when the library is built for a target with the CRC extension (__ARM_FEATURE_CRC32).
+ */
+uint32_t crc32c(void const* data, size_t bytes, uint32_t crc = 0);
+
+/**
+ * @brief Compute the CRC-32C of a buffer with the slice-by-8 table, even if the CPU has CRC instructions
+ * @param data Buffer to checksum
+ * @param bytes Size of the buffer, in bytes
+ * @param crc CRC of the preceding data (0 to start a new message)
+ * @return CRC-32C of the data, identical to crc32c
+ */
+uint32_t crc32cSoftware(void const* data, size_t bytes, uint32_t crc = 0);
+
+/**
+ * @brief Whether crc32c uses the CPU's CRC instructions
+ * @return True if crc32c is hardware-accelerated on this machine
+ */
+bool crc32cIsHardware();
+
+/**
+ * @brief Compute the checksum stored for a Fragment by the FragmentDataset plugins
+ * @param hdr Header of the Fragment
+ * @param data Fragment data (metadata and payload, i.e. everything after the header)
+ * @param dataWords Number of words in data
+ * @return CRC-32C of the Fragment
+ *
+ * Some file layouts store the Fragment header as attributes and rebuild it when reading, so the checksum covers the
+ * header fields which every layout preserves (sequence ID, Fragment ID, type, timestamp, word count and metadata word
+ * count), followed by all data words. A checksum computed from a Fragment read with any plugin therefore matches the
+ * one computed when it was written.
+ */
+uint32_t fragmentChecksum(artdaq::detail::RawFragmentHeader const& hdr, artdaq::RawDataType const* data, size_t dataWords);
+
+/**
+ * @brief Compute the checksum stored for a Fragment by the FragmentDataset plugins
+ * @param frag Fragment to checksum
+ * @return CRC-32C of the Fragment, see fragmentChecksum(RawFragmentHeader const&, RawDataType const*, size_t)
+ */
+inline uint32_t fragmentChecksum(artdaq::Fragment const& frag)
+{
+	return fragmentChecksum(frag.fragmentHeader(), frag.headerBegin() + frag.headerSizeWords(), frag.size() - frag.headerSizeWords());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+/**
+ * @brief Compute the checksum of a Fragment stored in a buffer (header followed by data), e.g. a ContainerFragment block
+ * @param words Fragment, starting with its RawFragmentHeader
+ * @return CRC-32C of the Fragment, see fragmentChecksum(RawFragmentHeader const&, RawDataType const*, size_t)
+ */
+uint32_t fragmentChecksum(artdaq::RawDataType const* words);
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_FragmentChecksum_hh
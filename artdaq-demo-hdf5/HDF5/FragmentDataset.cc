@@ -2,8 +2,18 @@
 #define TRACE_NAME "FragmentDataset"
 
 #include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "artdaq-core/Data/ContainerFragment.hh"
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <sstream>
 
 artdaq::hdf5::FragmentDataset::FragmentDataset(fhicl::ParameterSet const& ps, const std::string& mode)
+    : writeChecksums_(ps.get<bool>("writeChecksums", false))
+    , verifyChecksums_(ps.get<bool>("verifyChecksums", false))
+    , checksumErrorsFatal_(ps.get<bool>("checksumErrorsFatal", true))
 {
 	TLOG(TLVL_DEBUG) << "FragmentDataset CONSTRUCTOR Begin";
 	if (mode.find("rite") != std::string::npos || mode == "1")
@@ -21,5 +31,390 @@ artdaq::hdf5::FragmentDataset::FragmentDataset(fhicl::ParameterSet const& ps, co
 
 	nameHelper_ = artdaq::makeNameHelper(fragmentNameHelperPluginType, unidentified_instance_name, extraTypes);
 
+	for (auto const& frameFormat : ps.get<std::vector<fhicl::ParameterSet>>("frameFormats", std::vector<fhicl::ParameterSet>()))
+	{
+		auto type = frameFormat.get<artdaq::Fragment::type_t>("fragmentType");
+		FragmentFrameFormat format;
+		format.frame_words = frameFormat.get<size_t>("frameWords", 0);
+		format.timestamp_word = frameFormat.get<size_t>("timestampWord", 0);
+		if (format.frame_words == 0 || format.timestamp_word >= format.frame_words)
+		{
+			TLOG(TLVL_WARNING) << "Invalid frame format for Fragment type " << static_cast<int>(type) << " (frameWords " << format.frame_words << ", timestampWord " << format.timestamp_word << "), ignoring";
+			continue;
+		}
+		frameFormats_[type] = format;
+	}
+
+	if (verifyChecksums_)
+	{
+		TLOG(TLVL_DEBUG) << "Verifying Fragment checksums, CRC-32C is " << (crc32cIsHardware() ? "hardware-accelerated" : "computed in software");
+	}
+
 	TLOG(TLVL_DEBUG) << "FragmentDataset CONSTRUCTOR End";
-}
\ No newline at end of file
+}
+
+artdaq::hdf5::FragmentDataset::~FragmentDataset() noexcept
+{
+	if (ARTDAQ_DEMO_HDF5_TIMING)
+	{
+		auto report = timingReport();
+		if (!report.empty())
+		{
+			TLOG(TLVL_INFO) << "Dataset operation timing:" << std::endl
+			                << report;
+		}
+	}
+}
+
+std::string artdaq::hdf5::FragmentDatasetOperationName(FragmentDatasetOperation op)
+{
+	switch (op)
+	{
+		case FragmentDatasetOperation::InsertOne:
+			return "insertOne";
+		case FragmentDatasetOperation::InsertHeader:
+			return "insertHeader";
+		case FragmentDatasetOperation::ReadNextEvent:
+			return "readNextEvent";
+		case FragmentDatasetOperation::GetEventHeader:
+			return "getEventHeader";
+		case FragmentDatasetOperation::WriteFragment:
+			return "writeFragment";
+		case FragmentDatasetOperation::ReadFragment:
+			return "readFragment";
+		case FragmentDatasetOperation::CreateGroup:
+			return "createGroup";
+		case FragmentDatasetOperation::CreateDataset:
+			return "createDataset";
+		case FragmentDatasetOperation::WriteAttributes:
+			return "writeAttributes";
+		case FragmentDatasetOperation::ReadAttributes:
+			return "readAttributes";
+		case FragmentDatasetOperation::WritePayload:
+			return "writePayload";
+		case FragmentDatasetOperation::ReadPayload:
+			return "readPayload";
+		case FragmentDatasetOperation::CopyFragment:
+			return "copyFragment";
+		case FragmentDatasetOperation::Resize:
+			return "resize";
+		case FragmentDatasetOperation::Count:
+			break;
+	}
+	return "unknown";
+}
+
+std::string artdaq::hdf5::FragmentDataset::timingReport() const
+{
+	std::ostringstream o;
+	for (size_t ii = 0; ii < timingHistograms_.size(); ++ii)
+	{
+		if (timingHistograms_[ii].count() == 0) continue;
+		o << "  " << FragmentDatasetOperationName(static_cast<FragmentDatasetOperation>(ii)) << ": " << timingHistograms_[ii].summary() << std::endl;
+	}
+	return o.str();
+}
+
+std::vector<artdaq::hdf5::FragmentDatasetEventSummary> artdaq::hdf5::FragmentDataset::scanEvents()
+{
+	TLOG(TLVL_WARNING) << "scanEvents is not supported by this Dataset plugin, returning empty event list";
+	return std::vector<FragmentDatasetEventSummary>();
+}
+
+std::vector<artdaq::hdf5::FragmentTimeIndexEntry> artdaq::hdf5::FragmentDataset::getTimeIndex()
+{
+	TLOG(TLVL_WARNING) << "getTimeIndex is not supported by this Dataset plugin, returning empty time index";
+	return std::vector<FragmentTimeIndexEntry>();
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::FragmentDataset::readEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	TLOG(TLVL_WARNING) << "readEvent is not supported by this Dataset plugin, unable to read event " << seqID;
+	return std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>();
+}
+
+artdaq::Fragments artdaq::hdf5::FragmentDataset::readTimeRange(uint64_t begin, uint64_t end, FragmentTimeRangeFilter const& filter)
+{
+	TLOG(TLVL_TRACE) << "readTimeRange BEGIN [" << begin << ", " << end << ")";
+	artdaq::Fragments output;
+
+	std::map<artdaq::Fragment::sequence_id_t, std::vector<FragmentTimeIndexEntry>> events;
+	for (auto const& entry : getTimeIndex())
+	{
+		if (entry.first_timestamp < end && entry.last_timestamp >= begin && filter.accepts(entry.type, entry.fragment_id))
+		{
+			events[entry.sequence_id].push_back(entry);
+		}
+	}
+	TLOG(TLVL_DEBUG) << "readTimeRange: " << events.size() << " events overlap [" << begin << ", " << end << ")";
+
+	for (auto const& event : events)
+	{
+		auto eventMap = readIndexedFragments(event.first, event.second);
+		for (auto& fragmentTypePair : eventMap)
+		{
+			for (auto& frag : *fragmentTypePair.second)
+			{
+				auto entry = std::find_if(event.second.begin(), event.second.end(), [&](FragmentTimeIndexEntry const& e) { return e.type == frag.type() && e.fragment_id == frag.fragmentID(); });
+				if (entry == event.second.end())
+				{
+					continue;
+				}
+				if (filter.trim_frames && !trimToTimeRange_(frag, *entry, begin, end))
+				{
+					continue;
+				}
+				output.emplace_back(std::move(frag));
+			}
+		}
+	}
+
+	TLOG(TLVL_TRACE) << "readTimeRange END output.size() = " << output.size();
+	return output;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::FragmentDataset::readIndexedFragments(artdaq::Fragment::sequence_id_t seqID, std::vector<FragmentTimeIndexEntry> const& entries)
+{
+	auto output = readEvent(seqID);
+	for (auto it = output.begin(); it != output.end();)
+	{
+		auto& frags = *it->second;
+		frags.erase(std::remove_if(frags.begin(), frags.end(), [&](artdaq::Fragment const& frag) {
+			            return std::none_of(entries.begin(), entries.end(), [&](FragmentTimeIndexEntry const& e) { return e.type == frag.type() && e.fragment_id == frag.fragmentID(); });
+		            }),
+		            frags.end());
+		it = frags.empty() ? output.erase(it) : std::next(it);
+	}
+	return output;
+}
+
+artdaq::hdf5::FragmentTimeIndexEntry artdaq::hdf5::FragmentDataset::makeTimeIndexEntry_(artdaq::Fragment const& frag) const
+{
+	FragmentTimeIndexEntry entry;
+	entry.sequence_id = frag.sequenceID();
+	entry.type = frag.type();
+	entry.fragment_id = frag.fragmentID();
+	entry.first_timestamp = frag.timestamp();
+	entry.last_timestamp = frag.timestamp();
+
+	auto format = frameFormats_.find(frag.type());
+	if (format != frameFormats_.end())
+	{
+		auto frames = frag.dataSize() / format->second.frame_words;
+		if (frames > 0)
+		{
+			auto data = frag.dataBegin();
+			entry.frame_format = format->second;
+			entry.frame_count = frames;
+			entry.first_timestamp = data[format->second.timestamp_word];
+			entry.last_timestamp = data[(frames - 1) * format->second.frame_words + format->second.timestamp_word];
+		}
+		return entry;
+	}
+
+	if (frag.type() == artdaq::Fragment::ContainerFragmentType)
+	{
+		artdaq::ContainerFragment cf(frag);
+		auto blocksBegin = reinterpret_cast<uint8_t const*>(cf.dataBegin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		for (size_t ii = 0; ii < cf.block_count(); ++ii)
+		{
+			auto hdr = reinterpret_cast<artdaq::detail::RawFragmentHeader const*>(blocksBegin + cf.fragmentIndex(ii));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			entry.first_timestamp = std::min<uint64_t>(entry.first_timestamp, hdr->timestamp);
+			entry.last_timestamp = std::max<uint64_t>(entry.last_timestamp, hdr->timestamp);
+		}
+	}
+	return entry;
+}
+
+bool artdaq::hdf5::FragmentDataset::trimToTimeRange_(artdaq::Fragment& frag, FragmentTimeIndexEntry const& entry, uint64_t begin, uint64_t end)
+{
+	auto frameWords = entry.frame_format.frame_words;
+	if (frameWords == 0)
+	{
+		return true;
+	}
+
+	auto frames = frag.dataSize() / frameWords;
+	auto data = frag.dataBegin();
+	size_t firstFrame = frames;
+	size_t lastFrame = 0;
+	for (size_t ii = 0; ii < frames; ++ii)
+	{
+		auto timestamp = data[ii * frameWords + entry.frame_format.timestamp_word];
+		if (timestamp >= begin && timestamp < end)
+		{
+			if (firstFrame == frames) firstFrame = ii;
+			lastFrame = ii;
+		}
+	}
+	if (firstFrame == frames)
+	{
+		return false;
+	}
+
+	auto keepWords = (lastFrame - firstFrame + 1) * frameWords;
+	TLOG(TLVL_DEBUG + 5) << "trimToTimeRange_: Keeping frames " << firstFrame << " to " << lastFrame << " of " << frames << " in Fragment " << frag.fragmentID() << " of event " << frag.sequenceID();
+	if (firstFrame > 0)
+	{
+		std::memmove(data, data + firstFrame * frameWords, keepWords * sizeof(artdaq::RawDataType));
+	}
+	frag.resize(keepWords);
+	return true;
+}
+
+std::unique_ptr<artdaq::Fragments> artdaq::hdf5::FragmentDataset::makeFragments_(artdaq::Fragment::type_t type)
+{
+	auto output = std::make_unique<artdaq::Fragments>();
+	auto it = maxFragmentCounts_.find(type);
+	if (it != maxFragmentCounts_.end())
+	{
+		output->reserve(it->second);
+	}
+	return output;
+}
+
+std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::FragmentDataset::readNextEventByInstanceName()
+{
+	std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> output;
+
+	auto eventMap = readNextEvent();
+	for (auto& fragmentTypePair : eventMap)
+	{
+		if (fragmentTypePair.second->empty())
+		{
+			continue;
+		}
+
+		if (fragmentTypePair.first != artdaq::Fragment::ContainerFragmentType)
+		{
+			// All Fragments of a non-Container type share an instance name, so the vector is moved as a whole
+			auto const& label = getInstanceName_(fragmentTypePair.second->front());
+			auto& labelFragments = output[label];
+			if (!labelFragments)
+			{
+				labelFragments = std::move(fragmentTypePair.second);
+			}
+			else
+			{
+				labelFragments->insert(labelFragments->end(), std::make_move_iterator(fragmentTypePair.second->begin()), std::make_move_iterator(fragmentTypePair.second->end()));
+			}
+			continue;
+		}
+
+		for (auto& frag : *fragmentTypePair.second)
+		{
+			auto& labelFragments = output[getInstanceName_(frag)];
+			if (!labelFragments)
+			{
+				labelFragments = makeFragments_(frag.type());
+			}
+			labelFragments->emplace_back(std::move(frag));
+		}
+	}
+
+	return output;
+}
+
+void artdaq::hdf5::FragmentDataset::recordFragmentCounts_(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> const& event)
+{
+	for (auto const& type : event)
+	{
+		recordFragmentCount_(type.first, type.second->size());
+	}
+}
+
+void artdaq::hdf5::FragmentDataset::recordFragmentCounts_(std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> const& event)
+{
+	for (auto const& label : event)
+	{
+		if (!label.second->empty())
+		{
+			recordFragmentCount_(label.second->front().type(), label.second->size());
+		}
+	}
+}
+
+void artdaq::hdf5::FragmentDataset::recordFragmentCount_(artdaq::Fragment::type_t type, size_t count)
+{
+	auto& maxCount = maxFragmentCounts_[type];
+	if (count > maxCount)
+	{
+		TLOG(TLVL_DEBUG + 5) << "recordFragmentCount_: Expecting up to " << count << " Fragments of type " << static_cast<int>(type) << " per event";
+		maxCount = count;
+	}
+}
+
+std::string const& artdaq::hdf5::FragmentDataset::getInstanceName_(artdaq::Fragment const& frag)
+{
+	uint16_t key = frag.type();
+	if (frag.type() == artdaq::Fragment::ContainerFragmentType)
+	{
+		artdaq::ContainerFragment cf(frag);
+		key = static_cast<uint16_t>((static_cast<uint16_t>(frag.type()) << 8) | cf.fragment_type());
+	}
+
+	auto it = instanceNameCache_.find(key);
+	if (it == instanceNameCache_.end())
+	{
+		auto instance_name_result = nameHelper_->GetInstanceNameForFragment(frag);
+		if (!instance_name_result.first)
+		{
+			TLOG(TLVL_WARNING) << "getInstanceName_: The product instance name mapping for fragment type \"" << static_cast<int>(frag.type())
+			                   << "\" is not known. Fragments of this type will be stored with an instance name of \"" << instance_name_result.second << "\".";
+		}
+		it = instanceNameCache_.emplace(key, instance_name_result.second).first;
+	}
+	return it->second;
+}
+
+std::string const& artdaq::hdf5::FragmentDataset::getInstanceNameForType_(artdaq::Fragment::type_t type)
+{
+	uint16_t key = type;
+	auto it = instanceNameCache_.find(key);
+	if (it == instanceNameCache_.end())
+	{
+		auto instance_name_result = nameHelper_->GetInstanceNameForType(type);
+		if (!instance_name_result.first)
+		{
+			TLOG(TLVL_WARNING) << "getInstanceNameForType_: The product instance name mapping for fragment type \"" << static_cast<int>(type)
+			                   << "\" is not known. Fragments of this type will be stored with an instance name of \"" << instance_name_result.second << "\".";
+		}
+		it = instanceNameCache_.emplace(key, instance_name_result.second).first;
+	}
+	return it->second;
+}
+
+void artdaq::hdf5::FragmentDataset::verifyChecksum_(artdaq::Fragment const& frag, uint32_t stored)
+{
+	recordChecksum_(frag.fragmentHeader(), stored, fragmentChecksum(frag));
+}
+
+void artdaq::hdf5::FragmentDataset::verifyChecksum_(artdaq::RawDataType const* words, uint32_t stored)
+{
+	artdaq::detail::RawFragmentHeader hdr;
+	memcpy(&hdr, words, sizeof(hdr));
+	recordChecksum_(hdr, stored, fragmentChecksum(words));
+}
+
+void artdaq::hdf5::FragmentDataset::recordChecksum_(artdaq::detail::RawFragmentHeader const& hdr, uint32_t stored, uint32_t computed)
+{
+	checksumsVerified_++;
+	if (stored == computed) return;
+
+	FragmentChecksumError error;
+	error.sequence_id = hdr.sequence_id;
+	error.type = hdr.type;
+	error.fragment_id = hdr.fragment_id;
+	error.stored = stored;
+	error.computed = computed;
+
+	std::ostringstream msg;
+	msg << "Checksum mismatch for Fragment " << error.fragment_id << " (type " << static_cast<int>(error.type) << ") of event " << error.sequence_id
+	    << ": stored 0x" << std::hex << stored << ", computed 0x" << computed;
+	if (checksumErrorsFatal_)
+	{
+		throw cet::exception("FragmentDataset") << msg.str();
+	}
+	TLOG(TLVL_ERROR) << msg.str();
+	checksumErrors_.push_back(error);
+}
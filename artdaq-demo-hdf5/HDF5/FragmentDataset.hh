@@ -4,10 +4,16 @@
 #include "artdaq-core/Data/Fragment.hh"
 #include "artdaq-core/Data/RawEvent.hh"
 #include "artdaq-core/Plugins/FragmentNameHelper.hh"
+#include "artdaq-demo-hdf5/HDF5/FragmentChecksum.hh"
+#include "artdaq-demo-hdf5/HDF5/TimingHistogram.hh"
 #include "cetlib/compiler_macros.h"
 #include "fhiclcpp/ParameterSet.h"
 
+#include <array>
+#include <map>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 namespace artdaq {
 namespace hdf5 {
@@ -21,6 +27,115 @@ enum class FragmentDatasetMode : uint8_t
 	Write = 1  ///< This FragmentDataset is writing to a file
 };
 
+/**
+ * @brief Operations timed by the FragmentDataset instrumentation
+ */
+enum class FragmentDatasetOperation : uint8_t
+{
+	InsertOne = 0,    ///< Writing one Fragment (including ContainerFragment handling)
+	InsertHeader,     ///< Writing one RawEventHeader
+	ReadNextEvent,    ///< Reading one event
+	GetEventHeader,   ///< Reading one RawEventHeader
+	WriteFragment,    ///< Writing the dataset(s) of one Fragment
+	ReadFragment,     ///< Reading the dataset(s) of one Fragment
+	CreateGroup,      ///< Creating an HDF5 group
+	CreateDataset,    ///< Creating an HDF5 dataset
+	WriteAttributes,  ///< Writing the attributes of an HDF5 object
+	ReadAttributes,   ///< Reading the attributes of an HDF5 object
+	WritePayload,     ///< Writing Fragment payload data
+	ReadPayload,      ///< Reading Fragment payload data
+	CopyFragment,     ///< Copying Fragment data in memory
+	Resize,           ///< Extending an existing HDF5 dataset
+	Count             ///< Number of timed operations (not an operation)
+};
+
+/**
+ * @brief Get a printable name for a FragmentDatasetOperation
+ * @param op Operation
+ * @return Name of the operation
+ */
+std::string FragmentDatasetOperationName(FragmentDatasetOperation op);
+
+/**
+ * @brief Number of Fragments and bytes of a single Fragment type within an event
+ */
+struct FragmentTypeSummary
+{
+	size_t count{0};  ///< Number of Fragments of this type in the event
+	size_t bytes{0};  ///< Total size of the Fragments of this type, in bytes (header + payload)
+};
+
+/**
+ * @brief Header-level description of an event, as produced by FragmentDataset::scanEvents
+ */
+struct FragmentDatasetEventSummary
+{
+	artdaq::Fragment::sequence_id_t sequence_id{artdaq::Fragment::InvalidSequenceID};  ///< Sequence ID of the event
+	uint32_t run_id{0};                                                                 ///< Run number of the event
+	uint32_t subrun_id{0};                                                              ///< Subrun number of the event
+	uint32_t event_id{0};                                                               ///< Event number of the event
+	uint64_t timestamp{0};                                                              ///< Timestamp from the RawEventHeader
+	bool is_complete{false};                                                            ///< Whether the event was marked complete
+	bool has_header{false};                                                             ///< Whether a RawEventHeader was found for this event
+	std::map<artdaq::Fragment::type_t, FragmentTypeSummary> fragment_types;             ///< Per-type Fragment counts and sizes
+};
+
+/**
+ * @brief Payload layout of a Fragment type made of fixed-size, timestamped frames (e.g. WIB frames)
+ */
+struct FragmentFrameFormat
+{
+	size_t frame_words{0};     ///< Size of each frame, in words. Frames start at the beginning of the Fragment data (after the metadata)
+	size_t timestamp_word{0};  ///< Offset of the frame timestamp within each frame, in words
+};
+
+/**
+ * @brief Time range covered by one Fragment, as recorded in a Dataset's time index
+ */
+struct FragmentTimeIndexEntry
+{
+	artdaq::Fragment::sequence_id_t sequence_id{artdaq::Fragment::InvalidSequenceID};  ///< Sequence ID of the Fragment
+	artdaq::Fragment::type_t type{artdaq::Fragment::InvalidFragmentType};              ///< Type of the Fragment
+	artdaq::Fragment::fragment_id_t fragment_id{artdaq::Fragment::InvalidFragmentID};  ///< Fragment ID of the Fragment
+	uint64_t first_timestamp{0};                                                        ///< Earliest timestamp in the Fragment (first frame, or lowest header timestamp)
+	uint64_t last_timestamp{0};                                                         ///< Latest timestamp in the Fragment (last frame, or highest header timestamp)
+	FragmentFrameFormat frame_format;                                                   ///< Frame layout of the payload (frame_words is 0 if not known)
+	uint64_t frame_count{0};                                                            ///< Number of complete frames in the payload
+};
+
+/**
+ * @brief Selects the Fragments returned by FragmentDataset::readTimeRange
+ */
+struct FragmentTimeRangeFilter
+{
+	std::set<artdaq::Fragment::type_t> types;              ///< Fragment types to return (all types if empty)
+	std::set<artdaq::Fragment::fragment_id_t> fragment_ids;  ///< Fragment IDs to return (all IDs if empty)
+	bool trim_frames{true};                                ///< Whether Fragments with a known frame layout are trimmed to the frames in the range
+
+	/**
+	 * @brief Whether Fragments with the given type and ID pass the filter
+	 * @param type Fragment type
+	 * @param fragment_id Fragment ID
+	 * @return True if the Fragment should be returned
+	 */
+	bool accepts(artdaq::Fragment::type_t type, artdaq::Fragment::fragment_id_t fragment_id) const
+	{
+		return (types.empty() || types.count(type) != 0u) && (fragment_ids.empty() || fragment_ids.count(fragment_id) != 0u);
+	}
+};
+
+/**
+ * @brief A Fragment whose data did not match the checksum stored with it
+ */
+struct FragmentChecksumError
+{
+	artdaq::Fragment::sequence_id_t sequence_id{artdaq::Fragment::InvalidSequenceID};  ///< Sequence ID of the Fragment
+	artdaq::Fragment::type_t type{artdaq::Fragment::InvalidFragmentType};              ///< Type of the Fragment
+	artdaq::Fragment::fragment_id_t fragment_id{artdaq::Fragment::InvalidFragmentID};  ///< Fragment ID of the Fragment
+	uint32_t stored{0};                                                                 ///< Checksum stored in the file
+	uint32_t computed{0};                                                               ///< Checksum of the data read
+};
+
 /**
  * @brief Base class that defines methods for reading and writing to HDF5 files via various implementation plugins
  *
@@ -35,13 +150,20 @@ public:
 	 * @param ps ParameterSet containing configuration for this FragmentDataset
 	 * @param mode String which will be converted to a FragmentDatasetMode. Currently, if this parameter contains "rite", then FragmentDatasetMode::Write will be used, FragmentDatasetMode::Read otherwise.
 	 *
-	 * FragmentDataset takes no Parameters.
+	 * FragmentDataset accepts the following Parameters:
+	 * "frameFormats" (Default: []): List of tables describing Fragment types whose payload is made of fixed-size, timestamped
+	 *   frames, used for the time index: { fragmentType: <type> frameWords: <words per frame> timestampWord: <offset of the
+	 *   frame timestamp in the frame, default 0> }
+	 * "writeChecksums" (Default: false): Store a CRC-32C of each Fragment (see fragmentChecksum) with the Fragment
+	 * "verifyChecksums" (Default: false): Check the stored checksum of each Fragment read (Fragments without one are not checked)
+	 * "checksumErrorsFatal" (Default: true): Throw when a Fragment does not match its checksum. Otherwise the error is
+	 *   logged and recorded (see getChecksumErrors), and the Fragment is returned as read.
 	 */
 	FragmentDataset(fhicl::ParameterSet const& ps, const std::string& mode);
 	/**
-	 * @brief FragmentDataset default virtual destructor
+	 * @brief FragmentDataset virtual destructor, logs the timing report if any operations were timed
 	 */
-	virtual ~FragmentDataset() noexcept = default;
+	virtual ~FragmentDataset() noexcept;
 	/**
 	 * @brief Insert a Fragment into the Dataset (write it to the HDF5 file)
 	 * @param f Fragment to insert
@@ -71,6 +193,16 @@ public:
 	 * This function is pure virtual.
 	 */
 	virtual std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readNextEvent() = 0;
+	/**
+	 * @brief Read the next event from the Dataset (HDF5 file), with Fragments grouped by product instance name
+	 * @returns A Map of product instance names and pointers to Fragments, suitable for putting directly into an art::EventPrincipal
+	 *
+	 * The default implementation calls readNextEvent and moves each type's Fragments under the instance name given by
+	 * the FragmentNameHelper. Instance names are cached per Fragment type (and contained type, for ContainerFragments),
+	 * so the helper is only consulted once per type. Plugins which already know the instance name of the data they
+	 * are reading may override this to avoid the extra pass.
+	 */
+	virtual std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> readNextEventByInstanceName();
 	/**
 	 * @brief Read a RawEventHeader from the Dataset (HDF5 file)
 	 * @param seqID Sequence ID of the RawEventHeader (should be equivalent to event number)
@@ -79,12 +211,184 @@ public:
 	 * This function is pure virtual.
 	 */
 	virtual std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const& seqID) = 0;
+	/**
+	 * @brief Produce a summary of every event in the Dataset without reading Fragment payloads
+	 * @return One FragmentDatasetEventSummary per event, ordered by sequence ID
+	 *
+	 * Implementations should only read header columns and attributes. The default implementation
+	 * logs a warning and returns an empty list, for plugins which do not support scanning.
+	 */
+	virtual std::vector<FragmentDatasetEventSummary> scanEvents();
+	/**
+	 * @brief Get the current size of the file backing the Dataset
+	 * @return Size of the file, in bytes, or 0 if the plugin cannot determine it
+	 */
+	virtual size_t getFileSize() { return 0; }
+	/**
+	 * @brief Get the number of times an existing HDF5 dataset has been extended since the Dataset was opened
+	 * @return Number of dataset extensions, or 0 for plugins which do not extend datasets
+	 */
+	virtual size_t getDatasetExtensionCount() { return 0; }
+	/**
+	 * @brief Read the time index of the Dataset
+	 * @return One FragmentTimeIndexEntry per Fragment written to the Dataset
+	 *
+	 * Per-event time ranges are the minimum first_timestamp and maximum last_timestamp of the event's entries.
+	 * The default implementation logs a warning and returns an empty index, for plugins which do not write one.
+	 */
+	virtual std::vector<FragmentTimeIndexEntry> getTimeIndex();
+	/**
+	 * @brief Read a single event from the Dataset, without changing the position of readNextEvent
+	 * @param seqID Sequence ID of the event to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, empty if the event was not found
+	 *
+	 * The default implementation logs a warning and returns an empty map, for plugins which do not support random access.
+	 */
+	virtual std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readEvent(artdaq::Fragment::sequence_id_t seqID);
+	/**
+	 * @brief Read the Fragments which overlap a time range
+	 * @param begin Start of the time range (inclusive), in Fragment timestamp units
+	 * @param end End of the time range (exclusive), in Fragment timestamp units
+	 * @param filter Selects the Fragment types and IDs to return, and whether to trim framed payloads
+	 * @return Fragments whose time index entry overlaps [begin, end), in sequence ID order
+	 *
+	 * The time index is used to find the overlapping Fragments, which are read with readIndexedFragments. Fragments
+	 * whose type has a known frame layout are trimmed to the frames with timestamps in [begin, end) unless
+	 * filter.trim_frames is false. Trimming happens after the read: the frames outside the range are still read.
+	 */
+	virtual artdaq::Fragments readTimeRange(uint64_t begin, uint64_t end, FragmentTimeRangeFilter const& filter = FragmentTimeRangeFilter());
+	/**
+	 * @brief Read the Fragments of one event which are listed in the time index
+	 * @param seqID Sequence ID of the event to read
+	 * @param entries Time index entries (of event seqID) of the Fragments to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, holding only the Fragments listed in entries
+	 *
+	 * The default implementation reads the whole event with readEvent and drops the Fragments which are not listed,
+	 * so the time index only limits the events which are read. Plugins which can read single Fragments override it.
+	 */
+	virtual std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readIndexedFragments(artdaq::Fragment::sequence_id_t seqID, std::vector<FragmentTimeIndexEntry> const& entries);
+	/**
+	 * @brief Get the timing histogram for an operation
+	 * @param op Operation to get timing for
+	 * @return TimingHistogram filled by the plugin (empty if the plugin does not time this operation, or if ARTDAQ_DEMO_HDF5_TIMING is 0)
+	 */
+	TimingHistogram const& getTimingHistogram(FragmentDatasetOperation op) const { return timingHistograms_[static_cast<size_t>(op)]; }
+	/**
+	 * @brief Format the timing histograms of all operations which have been recorded
+	 * @return One line per operation with its summary statistics
+	 *
+	 * This report is also logged when the FragmentDataset is destroyed.
+	 */
+	std::string timingReport() const;
+	/**
+	 * @brief Get the Fragments which failed checksum verification (when checksumErrorsFatal is false)
+	 * @return Checksum errors, in the order they were found
+	 */
+	std::vector<FragmentChecksumError> const& getChecksumErrors() const { return checksumErrors_; }
+	/**
+	 * @brief Get the number of Fragments whose checksum has been verified
+	 * @return Number of Fragments checked, including those which failed
+	 */
+	size_t getChecksumsVerified() const { return checksumsVerified_; }
 
 protected:
-	FragmentDatasetMode mode_;                                ///< Mode of this FragmentDataset, either FragmentDatasetMode::Write or FragmentDatasetMode::Read
+	/**
+	 * @brief Get the timing histogram for an operation, for use with ARTDAQ_HDF5_SCOPED_TIMER
+	 * @param op Operation being timed
+	 * @return TimingHistogram to record into
+	 */
+	TimingHistogram& timing_(FragmentDatasetOperation op) { return timingHistograms_[static_cast<size_t>(op)]; }
+
+	/**
+	 * @brief Create an empty Fragments vector for an event being read
+	 * @param type Fragment type which will be stored in the vector
+	 * @return Fragments vector with capacity reserved for the largest number of Fragments of this type seen in a previous event
+	 *
+	 * The Fragments vectors are handed to art, so their storage cannot be recycled; reserving them avoids regrowing the vector while an event is read.
+	 */
+	std::unique_ptr<artdaq::Fragments> makeFragments_(artdaq::Fragment::type_t type);
+	/**
+	 * @brief Update the per-type Fragment count statistics used by makeFragments_
+	 * @param event Event which has just been read
+	 */
+	void recordFragmentCounts_(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> const& event);
+	/**
+	 * @brief Update the per-type Fragment count statistics used by makeFragments_
+	 * @param event Event which has just been read, grouped by instance name
+	 */
+	void recordFragmentCounts_(std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> const& event);
+	/**
+	 * @brief Get the product instance name for a Fragment, using a per-type cache
+	 * @param frag Fragment to look up
+	 * @return Instance name from the FragmentNameHelper
+	 */
+	std::string const& getInstanceName_(artdaq::Fragment const& frag);
+	/**
+	 * @brief Get the product instance name for a Fragment type, using the same cache as getInstanceName_
+	 * @param type Fragment type to look up
+	 * @return Instance name from the FragmentNameHelper
+	 */
+	std::string const& getInstanceNameForType_(artdaq::Fragment::type_t type);
+	/**
+	 * @brief Compute the time index entry of a Fragment being written
+	 * @param frag Fragment to index
+	 * @return Time index entry, using the configured frame layout for the Fragment's type if there is one
+	 *
+	 * For ContainerFragments without a frame layout, the range covers the timestamps of the Container and its blocks.
+	 */
+	FragmentTimeIndexEntry makeTimeIndexEntry_(artdaq::Fragment const& frag) const;
+	/**
+	 * @brief Trim a framed Fragment to the frames which fall in a time range
+	 * @param frag Fragment to trim (in place)
+	 * @param entry Time index entry of the Fragment, giving its frame layout
+	 * @param begin Start of the time range (inclusive)
+	 * @param end End of the time range (exclusive)
+	 * @return False if no frame of the Fragment falls in the range. Fragments without a frame layout are left unchanged.
+	 */
+	static bool trimToTimeRange_(artdaq::Fragment& frag, FragmentTimeIndexEntry const& entry, uint64_t begin, uint64_t end);
+	/**
+	 * @brief Whether the plugin should store a checksum with each Fragment it writes
+	 * @return Value of the "writeChecksums" parameter
+	 */
+	bool checksumsEnabled_() const { return writeChecksums_; }
+	/**
+	 * @brief Whether the plugin should check the stored checksum of each Fragment it reads
+	 * @return Value of the "verifyChecksums" parameter
+	 */
+	bool verifyingChecksums_() const { return verifyChecksums_; }
+	/**
+	 * @brief Check a Fragment which has been read against its stored checksum
+	 * @param frag Fragment read
+	 * @param stored Checksum stored with the Fragment
+	 *
+	 * Throws a cet::exception on mismatch if checksumErrorsFatal is set, otherwise logs and records the error.
+	 */
+	void verifyChecksum_(artdaq::Fragment const& frag, uint32_t stored);
+	/**
+	 * @brief Check a Fragment stored in a buffer (header followed by data) against its stored checksum
+	 * @param words Fragment, starting with its RawFragmentHeader
+	 * @param stored Checksum stored with the Fragment
+	 */
+	void verifyChecksum_(artdaq::RawDataType const* words, uint32_t stored);
+
+	FragmentDatasetMode mode_;                               ///< Mode of this FragmentDataset, either FragmentDatasetMode::Write or FragmentDatasetMode::Read
 	std::shared_ptr<artdaq::FragmentNameHelper> nameHelper_;  ///< FragmentNameHelper used to translate between Fragment Type and string instance names
 
 private:
+	std::array<TimingHistogram, static_cast<size_t>(FragmentDatasetOperation::Count)> timingHistograms_;
+	std::unordered_map<artdaq::Fragment::type_t, size_t> maxFragmentCounts_;
+	std::unordered_map<uint16_t, std::string> instanceNameCache_;
+	std::unordered_map<artdaq::Fragment::type_t, FragmentFrameFormat> frameFormats_;
+	bool writeChecksums_;
+	bool verifyChecksums_;
+	bool checksumErrorsFatal_;
+	size_t checksumsVerified_{0};
+	std::vector<FragmentChecksumError> checksumErrors_;
+
+	void recordChecksum_(artdaq::detail::RawFragmentHeader const& hdr, uint32_t stored, uint32_t computed);
+
+	void recordFragmentCount_(artdaq::Fragment::type_t type, size_t count);
+
 	FragmentDataset(FragmentDataset const&) = delete;
 	FragmentDataset(FragmentDataset&&) = delete;
 	FragmentDataset& operator=(FragmentDataset const&) = delete;
@@ -0,0 +1,210 @@
+#ifndef artdaq_demo_hdf5_HDF5_TimingHistogram_hh
+#define artdaq_demo_hdf5_HDF5_TimingHistogram_hh 1
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Compile-time switch for the dataset timing instrumentation
+ *
+ * When set to 0, ARTDAQ_HDF5_SCOPED_TIMER expands to nothing and the timed expressions are never evaluated.
+ */
+#ifndef ARTDAQ_DEMO_HDF5_TIMING
+#define ARTDAQ_DEMO_HDF5_TIMING 1
+#endif
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Log-linear histogram of operation durations
+ *
+ * Durations (in nanoseconds) below 16 ns each get their own bin. Above that, each power of two is split into four
+ * linear sub-bins, so the relative bin width is at most 25% over the full 64-bit range. Recording a value is a few
+ * integer operations; the histogram is not thread-safe and should be filled from a single thread.
+ */
+class TimingHistogram
+{
+public:
+	static constexpr size_t LinearBins = 16;                              ///< Number of single-nanosecond bins
+	static constexpr size_t SubBins = 4;                                  ///< Number of linear sub-bins per power of two
+	static constexpr size_t BinCount = LinearBins + (64 - 4) * SubBins;  ///< Total number of bins
+
+	/**
+	 * @brief Record one duration
+	 * @param ns Duration, in nanoseconds
+	 */
+	void record(uint64_t ns)
+	{
+		bins_[binFor(ns)]++;
+		count_++;
+		sum_ns_ += ns;
+		if (ns < min_ns_) min_ns_ = ns;
+		if (ns > max_ns_) max_ns_ = ns;
+	}
+
+	/**
+	 * @brief Get the number of recorded durations
+	 * @return Number of durations recorded
+	 */
+	uint64_t count() const { return count_; }
+	/**
+	 * @brief Get the sum of all recorded durations
+	 * @return Total recorded time, in seconds
+	 */
+	double total() const { return static_cast<double>(sum_ns_) * 1e-9; }
+	/**
+	 * @brief Get the mean recorded duration
+	 * @return Mean duration, in seconds, or 0 if nothing was recorded
+	 */
+	double mean() const { return count_ > 0 ? total() / static_cast<double>(count_) : 0.0; }
+	/**
+	 * @brief Get the smallest recorded duration
+	 * @return Minimum duration, in seconds, or 0 if nothing was recorded
+	 */
+	double min() const { return count_ > 0 ? static_cast<double>(min_ns_) * 1e-9 : 0.0; }
+	/**
+	 * @brief Get the largest recorded duration
+	 * @return Maximum duration, in seconds
+	 */
+	double max() const { return static_cast<double>(max_ns_) * 1e-9; }
+
+	/**
+	 * @brief Estimate a quantile of the recorded durations
+	 * @param q Quantile to estimate, between 0 and 1
+	 * @return Midpoint of the bin containing the quantile, in seconds (clamped to the observed min and max)
+	 */
+	double quantile(double q) const
+	{
+		if (count_ == 0) return 0.0;
+		auto target = static_cast<uint64_t>(q * static_cast<double>(count_ - 1));
+		uint64_t seen = 0;
+		for (size_t bin = 0; bin < BinCount; ++bin)
+		{
+			seen += bins_[bin];
+			if (seen > target)
+			{
+				auto mid = binLow(bin) + (binHigh(bin) - binLow(bin)) / 2;
+				if (mid < min_ns_) mid = min_ns_;
+				if (mid > max_ns_) mid = max_ns_;
+				return static_cast<double>(mid) * 1e-9;
+			}
+		}
+		return max();
+	}
+
+	/**
+	 * @brief Get the raw bin contents
+	 * @return Array of bin counts; bin i covers [binLow(i), binHigh(i)] nanoseconds
+	 */
+	std::array<uint64_t, BinCount> const& bins() const { return bins_; }
+
+	/**
+	 * @brief Get the lower edge of a bin
+	 * @param bin Bin index
+	 * @return Smallest duration (ns) recorded in this bin
+	 */
+	static uint64_t binLow(size_t bin)
+	{
+		if (bin < LinearBins) return bin;
+		auto exponent = (bin - LinearBins) / SubBins + 4;
+		auto sub = (bin - LinearBins) % SubBins;
+		return (uint64_t{1} << exponent) + sub * (uint64_t{1} << (exponent - 2));
+	}
+	/**
+	 * @brief Get the upper edge of a bin
+	 * @param bin Bin index
+	 * @return Largest duration (ns) recorded in this bin
+	 */
+	static uint64_t binHigh(size_t bin)
+	{
+		if (bin + 1 >= BinCount) return std::numeric_limits<uint64_t>::max();
+		return binLow(bin + 1) - 1;
+	}
+
+	/**
+	 * @brief Format a one-line summary of the histogram
+	 * @return String containing count, total, mean, min, p50, p90, p99 and max
+	 */
+	std::string summary() const
+	{
+		std::ostringstream o;
+		o << "count=" << count_ << " total=" << total() << " s mean=" << mean() * 1e6 << " us min=" << min() * 1e6
+		  << " us p50=" << quantile(0.5) * 1e6 << " us p90=" << quantile(0.9) * 1e6 << " us p99=" << quantile(0.99) * 1e6
+		  << " us max=" << max() * 1e6 << " us";
+		return o.str();
+	}
+
+private:
+	static size_t binFor(uint64_t ns)
+	{
+		if (ns < LinearBins) return ns;
+		auto exponent = static_cast<size_t>(63 - __builtin_clzll(ns));
+		auto sub = static_cast<size_t>((ns >> (exponent - 2)) & (SubBins - 1));
+		return LinearBins + (exponent - 4) * SubBins + sub;
+	}
+
+	std::array<uint64_t, BinCount> bins_{};
+	uint64_t count_{0};
+	uint64_t sum_ns_{0};
+	uint64_t min_ns_{std::numeric_limits<uint64_t>::max()};
+	uint64_t max_ns_{0};
+};
+
+/**
+ * @brief RAII timer which records the lifetime of its scope into a TimingHistogram
+ */
+class ScopedTimer
+{
+public:
+	/**
+	 * @brief ScopedTimer Constructor, starts the timer
+	 * @param hist Histogram to record into when this ScopedTimer is destroyed
+	 */
+	explicit ScopedTimer(TimingHistogram& hist)
+	    : hist_(hist)
+	    , start_(std::chrono::steady_clock::now())
+	{}
+	/**
+	 * @brief ScopedTimer Destructor, records the elapsed time
+	 */
+	~ScopedTimer()
+	{
+		hist_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count()));
+	}
+
+private:
+	ScopedTimer(ScopedTimer const&) = delete;
+	ScopedTimer(ScopedTimer&&) = delete;
+	ScopedTimer& operator=(ScopedTimer const&) = delete;
+	ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+	TimingHistogram& hist_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+/** \cond */
+#define ARTDAQ_HDF5_TIMER_CONCAT_(a, b) a##b
+#define ARTDAQ_HDF5_TIMER_NAME_(line) ARTDAQ_HDF5_TIMER_CONCAT_(artdaq_hdf5_scoped_timer_, line)
+/** \endcond */
+
+/**
+ * @brief Time the remainder of the enclosing scope into the given TimingHistogram (no-op when ARTDAQ_DEMO_HDF5_TIMING is 0)
+ */
+#if ARTDAQ_DEMO_HDF5_TIMING
+#define ARTDAQ_HDF5_SCOPED_TIMER(hist) artdaq::hdf5::ScopedTimer ARTDAQ_HDF5_TIMER_NAME_(__LINE__)(hist)
+#else
+#define ARTDAQ_HDF5_SCOPED_TIMER(hist) \
+	do                                 \
+	{                                  \
+	} while (0)
+#endif
+
+#endif  // artdaq_demo_hdf5_HDF5_TimingHistogram_hh
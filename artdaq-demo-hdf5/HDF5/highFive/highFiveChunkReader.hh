@@ -0,0 +1,338 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveChunkReader_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveChunkReader_hh 1
+
+#include "tracemf.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5DataSet.hpp>
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveWorkerPool.hh"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Reads selections of deflate-compressed, chunked 2-D datasets with parallel decompression
+ *
+ * H5Dread decompresses every chunk serially on the calling thread. This reader instead plans the chunks covered by
+ * the queued selections, fetches each chunk once, still compressed, with H5Dread_chunk on the calling thread, and
+ * inflates the chunks on a HighFiveWorkerPool. A chunk which lies entirely inside one selection, and maps to a
+ * contiguous part of its destination, is inflated directly into the destination; other chunks are inflated into a
+ * scratch buffer and the overlapping parts copied out. Selections of consecutive rows which are also consecutive in
+ * their destination are merged when they are queued, so that a Fragment spanning several rows counts as one selection.
+ * The last chunk read from each dataset is kept inflated, so that a later execute() continuing in the same chunk (e.g.
+ * reading the next event of a table) does not fetch and inflate it again. Only datasets whose sole filter is deflate
+ * are supported (see supports()); other datasets should be read with HighFive as usual.
+ */
+class HighFiveChunkReader
+{
+public:
+	/**
+	 * @brief HighFiveChunkReader Constructor
+	 * @param threads Number of decompression threads
+	 */
+	explicit HighFiveChunkReader(size_t threads)
+	    : pool_(threads)
+	{}
+
+	/**
+	 * @brief Whether a dataset can be read with a HighFiveChunkReader
+	 * @param dataset Dataset to check
+	 * @return True if the dataset is two-dimensional, chunked, and compressed with deflate only
+	 */
+	static bool supports(HighFive::DataSet const& dataset)
+	{
+		if (dataset.getDimensions().size() != 2) return false;
+
+		bool supported = false;
+		hid_t dcpl = H5Dget_create_plist(dataset.getId());
+		if (dcpl < 0) return false;
+		if (H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_nfilters(dcpl) == 1)
+		{
+			unsigned flags;
+			size_t cd_nelmts = 0;
+			unsigned filter_config;
+			supported = H5Pget_filter2(dcpl, 0, &flags, &cd_nelmts, nullptr, 0, nullptr, &filter_config) == H5Z_FILTER_DEFLATE;
+		}
+		H5Pclose(dcpl);
+		return supported;
+	}
+
+	/**
+	 * @brief Queue the read of a selection
+	 * @param dataset Dataset to read (must be supported, see supports())
+	 * @param row First row of the selection
+	 * @param rows Number of rows in the selection
+	 * @param col First column of the selection
+	 * @param cols Number of columns in the selection
+	 * @param dest Destination, which receives the selection in row-major order and must stay valid until execute() returns
+	 */
+	void add(HighFive::DataSet const& dataset, size_t row, size_t rows, size_t col, size_t cols, void* dest)
+	{
+		if (rows == 0 || cols == 0) return;
+		auto& plan = plans_[dataset.getId()];
+		if (plan.selections.empty())
+		{
+			plan.dataset = std::make_unique<HighFive::DataSet>(dataset);
+			plan.geometry = geometry_(dataset);
+		}
+		else
+		{
+			auto& last = plan.selections.back();
+			if (last.col == col && last.cols == cols && last.row + last.rows == row && last.dest + last.rows * cols * plan.geometry.element_size == dest)
+			{
+				last.rows += rows;
+				return;
+			}
+		}
+		plan.selections.push_back(Selection{row, rows, col, cols, static_cast<uint8_t*>(dest)});
+	}
+
+	/**
+	 * @brief Read all queued selections, and wait for their decompression to finish
+	 *
+	 * Throws a HighFive::DataSetException if a chunk cannot be read or inflated. The queue is empty afterwards.
+	 */
+	void execute()
+	{
+		auto plans = std::move(plans_);
+		plans_.clear();
+		try
+		{
+			for (auto& plan : plans)
+			{
+				readChunks_(*plan.second.dataset, plan.second.geometry, plan.second.selections);
+			}
+		}
+		catch (...)
+		{
+			// Chunks which were already queued write into the destinations, so they must finish before the error is reported
+			try
+			{
+				pool_.wait();
+			}
+			catch (...)
+			{
+			}
+			cache_.clear();
+			throw;
+		}
+		try
+		{
+			pool_.wait();
+		}
+		catch (std::exception const& ex)
+		{
+			// A kept chunk may not have been inflated completely
+			cache_.clear();
+			HighFive::HDF5ErrMapper::ToException<HighFive::DataSetException>(std::string("HighFiveChunkReader: ") + ex.what());
+		}
+	}
+
+private:
+	struct Selection
+	{
+		size_t row;
+		size_t rows;
+		size_t col;
+		size_t cols;
+		uint8_t* dest;
+	};
+	struct Geometry
+	{
+		hsize_t chunk_rows;
+		hsize_t chunk_cols;
+		size_t element_size;
+	};
+	struct Plan
+	{
+		std::unique_ptr<HighFive::DataSet> dataset;
+		Geometry geometry;
+		std::vector<Selection> selections;
+	};
+	/// The last chunk read from a dataset, kept inflated for the next execute()
+	struct CachedChunk
+	{
+		std::unique_ptr<HighFive::DataSet> dataset;  ///< Keeps the dataset open, so that its id is not reused
+		std::pair<hsize_t, hsize_t> coord;
+		std::shared_ptr<std::vector<uint8_t>> data;
+	};
+
+	void readChunks_(HighFive::DataSet const& dataset, Geometry const& geometry, std::vector<Selection> const& selections)
+	{
+		// Each chunk is fetched once, even when it is shared by several selections
+		std::map<std::pair<hsize_t, hsize_t>, std::vector<Selection>> chunks;
+		for (auto const& sel : selections)
+		{
+			for (hsize_t cr = sel.row / geometry.chunk_rows; cr * geometry.chunk_rows < sel.row + sel.rows; ++cr)
+			{
+				for (hsize_t cc = sel.col / geometry.chunk_cols; cc * geometry.chunk_cols < sel.col + sel.cols; ++cc)
+				{
+					chunks[std::make_pair(cr, cc)].push_back(sel);
+				}
+			}
+		}
+		TLOG(TLVL_DEBUG + 5, "HighFiveChunkReader") << "Reading " << chunks.size() << " chunks for " << selections.size() << " selections";
+
+		auto id = dataset.getId();
+		auto& cached = cache_[id];
+		auto lastChunk = chunks.rbegin()->first;
+		// The last chunk is only kept if its final rows were not read, i.e. if a sequential reader will continue in it
+		hsize_t lastRowRead = 0;
+		for (auto const& sel : chunks.rbegin()->second) lastRowRead = std::max<hsize_t>(lastRowRead, sel.row + sel.rows);
+		auto keepLast = lastRowRead < (lastChunk.first + 1) * geometry.chunk_rows;
+		std::shared_ptr<std::vector<uint8_t>> keep;
+		for (auto& chunk : chunks)
+		{
+			hsize_t offset[2] = {chunk.first.first * geometry.chunk_rows, chunk.first.second * geometry.chunk_cols};
+			if (cached.data && cached.coord == chunk.first)
+			{
+				TLOG(TLVL_DEBUG + 6, "HighFiveChunkReader") << "Reusing the inflated chunk at row " << offset[0];
+				pool_.submit([geometry, offset0 = offset[0], offset1 = offset[1], data = cached.data, sels = std::move(chunk.second)] {
+					copyOut_(geometry, offset0, offset1, data->data(), sels);
+				});
+				continue;
+			}
+
+			unsigned filter_mask = 0;
+			haddr_t address = HADDR_UNDEF;
+			hsize_t size = 0;
+			check_(H5Dget_chunk_info_by_coord(id, offset, &filter_mask, &address, &size), "H5Dget_chunk_info_by_coord");
+
+			std::shared_ptr<std::vector<uint8_t>> raw;
+			if (address != HADDR_UNDEF && size > 0)
+			{
+				raw = std::make_shared<std::vector<uint8_t>>(size);
+				uint32_t filters = 0;
+				check_(H5Dread_chunk(id, H5P_DEFAULT, offset, &filters, raw->data()), "H5Dread_chunk");
+				filter_mask = filters;
+			}
+
+			std::shared_ptr<std::vector<uint8_t>> chunkKeep;
+			if (keepLast && chunk.first == lastChunk)
+			{
+				chunkKeep = std::make_shared<std::vector<uint8_t>>(geometry.chunk_rows * geometry.chunk_cols * geometry.element_size);
+				keep = chunkKeep;
+			}
+			pool_.submit([geometry, offset0 = offset[0], offset1 = offset[1], filter_mask, raw, chunkKeep, sels = std::move(chunk.second)] {
+				inflateChunk_(geometry, offset0, offset1, filter_mask, raw.get(), chunkKeep.get(), sels);
+			});
+		}
+
+		if (keep)
+		{
+			cached.dataset = std::make_unique<HighFive::DataSet>(dataset);
+			cached.coord = lastChunk;
+			cached.data = std::move(keep);
+		}
+	}
+
+	static void inflateChunk_(Geometry const& geometry, hsize_t chunk_row, hsize_t chunk_col, unsigned filter_mask, std::vector<uint8_t> const* raw, std::vector<uint8_t>* keep, std::vector<Selection> const& selections)
+	{
+		auto rowBytes = geometry.chunk_cols * geometry.element_size;
+		auto chunkBytes = geometry.chunk_rows * rowBytes;
+
+		// A chunk covering whole destination rows of a single selection is inflated in place, unless it is kept
+		uint8_t* target = keep != nullptr ? keep->data() : nullptr;
+		if (target == nullptr && selections.size() == 1)
+		{
+			auto const& sel = selections.front();
+			if (sel.col == chunk_col && sel.cols == geometry.chunk_cols && sel.row <= chunk_row && chunk_row + geometry.chunk_rows <= sel.row + sel.rows)
+			{
+				target = sel.dest + (chunk_row - sel.row) * rowBytes;
+			}
+		}
+		std::vector<uint8_t> scratch;
+		auto inPlace = target != nullptr && keep == nullptr;
+		if (target == nullptr)
+		{
+			scratch.resize(chunkBytes);
+			target = scratch.data();
+		}
+
+		if (raw == nullptr)
+		{
+			// Chunks which were never written read back as the (zero) fill value
+			std::memset(target, 0, chunkBytes);
+		}
+		else if ((filter_mask & 1u) != 0)
+		{
+			if (raw->size() != chunkBytes) throw std::runtime_error("Unfiltered chunk has unexpected size " + std::to_string(raw->size()));
+			std::memcpy(target, raw->data(), chunkBytes);
+		}
+		else
+		{
+			uLongf length = chunkBytes;
+			auto status = uncompress(target, &length, raw->data(), raw->size());
+			if (status != Z_OK || length != chunkBytes)
+			{
+				throw std::runtime_error("Inflating chunk at row " + std::to_string(chunk_row) + " failed (zlib status " + std::to_string(status) + ", " + std::to_string(length) + " bytes)");
+			}
+		}
+
+		if (!inPlace) copyOut_(geometry, chunk_row, chunk_col, target, selections);
+	}
+
+	static void copyOut_(Geometry const& geometry, hsize_t chunk_row, hsize_t chunk_col, uint8_t const* chunk, std::vector<Selection> const& selections)
+	{
+		auto rowBytes = geometry.chunk_cols * geometry.element_size;
+		for (auto const& sel : selections)
+		{
+			auto rowBegin = std::max<hsize_t>(sel.row, chunk_row);
+			auto rowEnd = std::min<hsize_t>(sel.row + sel.rows, chunk_row + geometry.chunk_rows);
+			auto colBegin = std::max<hsize_t>(sel.col, chunk_col);
+			auto colEnd = std::min<hsize_t>(sel.col + sel.cols, chunk_col + geometry.chunk_cols);
+			auto copyBytes = (colEnd - colBegin) * geometry.element_size;
+			for (auto row = rowBegin; row < rowEnd; ++row)
+			{
+				std::memcpy(sel.dest + ((row - sel.row) * sel.cols + (colBegin - sel.col)) * geometry.element_size,
+				            chunk + (row - chunk_row) * rowBytes + (colBegin - chunk_col) * geometry.element_size,
+				            copyBytes);
+			}
+		}
+	}
+
+	static Geometry geometry_(HighFive::DataSet const& dataset)
+	{
+		Geometry geometry{0, 0, 0};
+		hid_t dcpl = H5Dget_create_plist(dataset.getId());
+		check_(dcpl, "H5Dget_create_plist");
+		hsize_t chunk[2] = {0, 0};
+		auto rank = H5Pget_chunk(dcpl, 2, chunk);
+		H5Pclose(dcpl);
+		check_(rank == 2 ? 0 : -1, "H5Pget_chunk");
+		geometry.chunk_rows = chunk[0];
+		geometry.chunk_cols = chunk[1];
+
+		hid_t type = H5Dget_type(dataset.getId());
+		check_(type, "H5Dget_type");
+		geometry.element_size = H5Tget_size(type);
+		H5Tclose(type);
+		return geometry;
+	}
+
+	static void check_(int64_t status, char const* call)
+	{
+		if (status < 0)
+		{
+			HighFive::HDF5ErrMapper::ToException<HighFive::DataSetException>(std::string("HighFiveChunkReader: ") + call + " failed");
+		}
+	}
+
+	HighFiveWorkerPool pool_;
+	std::map<hid_t, Plan> plans_;
+	std::map<hid_t, CachedChunk> cache_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveChunkReader_hh
@@ -0,0 +1,331 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveChunkWriter_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveChunkWriter_hh 1
+
+#include "tracemf.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5DataSet.hpp>
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveWorkerPool.hh"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Appends rows to a deflate-compressed, chunked 2-D dataset with parallel compression
+ *
+ * H5Dwrite runs the filter pipeline serially on the calling thread. This writer instead collects whole chunks in
+ * memory, compresses them on a HighFiveWorkerPool, and commits the compressed chunks with H5Dwrite_chunk from the
+ * thread owning the writer, so that the file is identical in layout to one written through H5Dwrite and readable by
+ * any HDF5 tool. A chunk which does not shrink is stored unfiltered (deflate is an optional filter). The dataset is
+ * extended a whole chunk at a time, and unused rows of the last chunk are zero-filled. As with HighFiveDatasetHelper,
+ * flush() trims the extent to the rows appended and stores their number in the "rowCount" attribute. Chunk buffers are
+ * handed to the compression jobs and reused once their chunk is committed, so that chunks are not copied.
+ * Only datasets whose sole filter is deflate, and whose chunks span the full row width, are supported (see supports()).
+ */
+class HighFiveChunkWriter
+{
+public:
+	/**
+	 * @brief HighFiveChunkWriter Constructor
+	 * @param dataset Dataset to append to (must be supported, see supports()); rows already in it are kept
+	 * @param pool Worker pool to compress chunks on (must outlive this HighFiveChunkWriter)
+	 * @param max_pending_chunks Number of chunks which may be waiting for compression before write() blocks
+	 */
+	HighFiveChunkWriter(HighFive::DataSet const& dataset, HighFiveWorkerPool& pool, size_t max_pending_chunks)
+	    : dataset_(dataset)
+	    , pool_(pool)
+	    , max_pending_chunks_(max_pending_chunks > 0 ? max_pending_chunks : 1)
+	    , level_(deflateLevel_(dataset))
+	    , rows_(HighFiveDatasetHelper::rowCount(dataset))
+	    , extent_(dataset.getDimensions()[0])
+	    , resize_count_(0)
+	{
+		hid_t dcpl = H5Dget_create_plist(dataset_.getId());
+		check_(dcpl, "H5Dget_create_plist");
+		hsize_t chunk[2] = {0, 0};
+		auto rank = H5Pget_chunk(dcpl, 2, chunk);
+		H5Pclose(dcpl);
+		check_(rank == 2 && level_ >= 0 ? 0 : -1, "H5Pget_chunk");
+		chunk_rows_ = chunk[0];
+		columns_ = chunk[1];
+
+		hid_t type = H5Dget_type(dataset_.getId());
+		check_(type, "H5Dget_type");
+		row_bytes_ = H5Tget_size(type) * columns_;
+		H5Tclose(type);
+
+		// Appending to a partially-filled chunk rewrites it, so it is started with the rows it already holds
+		buffer_.resize(chunk_rows_ * row_bytes_);
+		auto rowsInChunk = rows_ % chunk_rows_;
+		if (rowsInChunk > 0)
+		{
+			dataset_.select({rows_ - rowsInChunk, 0}, {rowsInChunk, columns_}).read(buffer_.data());
+		}
+	}
+
+	/**
+	 * @brief HighFiveChunkWriter Destructor, commits any rows not yet written
+	 */
+	~HighFiveChunkWriter() noexcept
+	{
+		try
+		{
+			flush();
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG(TLVL_ERROR, "HighFiveChunkWriter") << "Error writing the last chunk of the dataset: " << ex.what();
+		}
+	}
+
+	/**
+	 * @brief Whether a dataset can be written with a HighFiveChunkWriter
+	 * @param dataset Dataset to check
+	 * @return True if the dataset is two-dimensional, chunked over whole rows, and compressed with deflate only
+	 */
+	static bool supports(HighFive::DataSet const& dataset)
+	{
+		auto dims = dataset.getDimensions();
+		if (dims.size() != 2 || deflateLevel_(dataset) < 0) return false;
+
+		hid_t dcpl = H5Dget_create_plist(dataset.getId());
+		if (dcpl < 0) return false;
+		hsize_t chunk[2] = {0, 0};
+		auto rank = H5Pget_chunk(dcpl, 2, chunk);
+		H5Pclose(dcpl);
+		return rank == 2 && chunk[1] == dims[1];
+	}
+
+	/**
+	 * @brief Append data to the dataset
+	 * @param data Values to append, in row-major order
+	 * @param elements Number of values in data. The last row is zero-filled if elements is not a multiple of the row width.
+	 */
+	void write(void const* data, size_t elements)
+	{
+		auto bytes = elements * row_bytes_ / columns_;
+		auto src = static_cast<uint8_t const*>(data);
+		while (bytes > 0)
+		{
+			auto offset = (rows_ % chunk_rows_) * row_bytes_ + partial_bytes_;
+			auto copyBytes = std::min(bytes, buffer_.size() - offset);
+			std::memcpy(buffer_.data() + offset, src, copyBytes);
+			src += copyBytes;
+			bytes -= copyBytes;
+
+			partial_bytes_ += copyBytes;
+			rows_ += partial_bytes_ / row_bytes_;
+			partial_bytes_ %= row_bytes_;
+			if (rows_ % chunk_rows_ == 0 && partial_bytes_ == 0)
+			{
+				submit_(false);
+			}
+		}
+		if (partial_bytes_ > 0)
+		{
+			std::memset(buffer_.data() + (rows_ % chunk_rows_) * row_bytes_ + partial_bytes_, 0, row_bytes_ - partial_bytes_);
+			partial_bytes_ = 0;
+			rows_++;
+			if (rows_ % chunk_rows_ == 0) submit_(false);
+		}
+	}
+
+	/**
+	 * @brief Commit all rows appended so far, including a partially-filled last chunk, and wait for compression to finish
+	 *
+	 * The extent is then trimmed to the rows appended, and the "rowCount" attribute is updated. Later rows are added to
+	 * the partially-filled chunk, which is then written again.
+	 */
+	void flush()
+	{
+		if (rows_ % chunk_rows_ != 0)
+		{
+			submit_(true);
+		}
+		while (!pending_.empty())
+		{
+			commit_();
+		}
+		if (!written_) return;
+		written_ = false;
+
+		if (extent_ != rows_)
+		{
+			extent_ = rows_;
+			dataset_.resize({extent_, columns_});
+		}
+		HighFiveDatasetHelper::writeRowCount(dataset_, rows_);
+	}
+
+	/**
+	 * @brief Get the number of rows appended (including rows the dataset already held)
+	 * @return Number of rows
+	 */
+	size_t getRowCount() const { return rows_; }
+	/**
+	 * @brief Get the number of times the dataset has been extended
+	 * @return The number of resize operations performed on the dataset
+	 */
+	size_t getResizeCount() const { return resize_count_; }
+
+private:
+	HighFiveChunkWriter(HighFiveChunkWriter const&) = delete;
+	HighFiveChunkWriter(HighFiveChunkWriter&&) = delete;
+	HighFiveChunkWriter& operator=(HighFiveChunkWriter const&) = delete;
+	HighFiveChunkWriter& operator=(HighFiveChunkWriter&&) = delete;
+
+	struct CompressedChunk
+	{
+		std::vector<uint8_t> raw;   ///< Uncompressed chunk, returned to the buffer pool when committed
+		std::vector<uint8_t> data;  ///< Compressed chunk (its buffer is also pooled)
+		bool filtered;              ///< Whether data holds the compressed chunk; otherwise raw is stored unfiltered
+	};
+	struct PendingChunk
+	{
+		hsize_t row;
+		std::future<CompressedChunk> chunk;
+	};
+
+	std::vector<uint8_t> takeBuffer_(std::vector<std::vector<uint8_t>>& pool)
+	{
+		if (pool.empty()) return std::vector<uint8_t>();
+		auto buffer = std::move(pool.back());
+		pool.pop_back();
+		return buffer;
+	}
+
+	void submit_(bool partial)
+	{
+		// The filled buffer is handed to the job, and the chunk continues in a pooled buffer
+		auto raw = takeBuffer_(raw_pool_);
+		raw.resize(buffer_.size());
+		std::swap(raw, buffer_);
+		if (partial)
+		{
+			// Later rows are added to this chunk, so it continues with the rows it holds (only at flush)
+			std::memcpy(buffer_.data(), raw.data(), buffer_.size());
+		}
+		else
+		{
+			// The next chunk starts empty, so that its unused rows are zero-filled
+			std::memset(buffer_.data(), 0, buffer_.size());
+		}
+		written_ = true;
+		auto row = ((rows_ - 1) / chunk_rows_) * chunk_rows_;
+		auto task = std::make_shared<std::packaged_task<CompressedChunk()>>(
+		    [raw = std::move(raw), out = takeBuffer_(data_pool_), level = level_]() mutable { return compress_(std::move(raw), std::move(out), level); });
+		pending_.push_back(PendingChunk{row, task->get_future()});
+		pool_.submit([task] { (*task)(); });
+
+		while (pending_.size() > max_pending_chunks_)
+		{
+			commit_();
+		}
+	}
+
+	void commit_()
+	{
+		auto pending = std::move(pending_.front());
+		pending_.pop_front();
+		CompressedChunk chunk;
+		try
+		{
+			chunk = pending.chunk.get();
+		}
+		catch (std::exception const& ex)
+		{
+			HighFive::HDF5ErrMapper::ToException<HighFive::DataSetException>(std::string("HighFiveChunkWriter: ") + ex.what());
+		}
+
+		if (extent_ < pending.row + chunk_rows_)
+		{
+			extent_ = pending.row + chunk_rows_;
+			dataset_.resize({extent_, columns_});
+			resize_count_++;
+		}
+		hsize_t offset[2] = {pending.row, 0};
+		// Bit 0 of the filter mask marks the (only) filter, deflate, as skipped for this chunk
+		auto const& stored = chunk.filtered ? chunk.data : chunk.raw;
+		check_(H5Dwrite_chunk(dataset_.getId(), H5P_DEFAULT, chunk.filtered ? 0u : 1u, offset, stored.size(), stored.data()), "H5Dwrite_chunk");
+		TLOG(TLVL_DEBUG + 5, "HighFiveChunkWriter") << "Wrote chunk at row " << pending.row << ", " << stored.size() << " bytes";
+
+		raw_pool_.push_back(std::move(chunk.raw));
+		data_pool_.push_back(std::move(chunk.data));
+	}
+
+	static CompressedChunk compress_(std::vector<uint8_t>&& raw, std::vector<uint8_t>&& out, int level)
+	{
+		CompressedChunk output;
+		output.raw = std::move(raw);
+		output.data = std::move(out);
+		uLongf length = compressBound(output.raw.size());
+		output.data.resize(length);
+		auto status = compress2(output.data.data(), &length, output.raw.data(), output.raw.size(), level);
+		if (status != Z_OK) throw std::runtime_error("Deflating chunk failed (zlib status " + std::to_string(status) + ")");
+
+		// A chunk which does not shrink is stored unfiltered, from raw
+		output.filtered = length < output.raw.size();
+		if (output.filtered) output.data.resize(length);
+		return output;
+	}
+
+	static int deflateLevel_(HighFive::DataSet const& dataset)
+	{
+		int level = -1;
+		hid_t dcpl = H5Dget_create_plist(dataset.getId());
+		if (dcpl < 0) return level;
+		if (H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_nfilters(dcpl) == 1)
+		{
+			unsigned flags;
+			unsigned cd_values[1] = {0};
+			size_t cd_nelmts = 1;
+			unsigned filter_config;
+			if (H5Pget_filter2(dcpl, 0, &flags, &cd_nelmts, cd_values, 0, nullptr, &filter_config) == H5Z_FILTER_DEFLATE)
+			{
+				level = static_cast<int>(cd_values[0]);
+			}
+		}
+		H5Pclose(dcpl);
+		return level;
+	}
+
+	static void check_(int64_t status, char const* call)
+	{
+		if (status < 0)
+		{
+			HighFive::HDF5ErrMapper::ToException<HighFive::DataSetException>(std::string("HighFiveChunkWriter: ") + call + " failed");
+		}
+	}
+
+	HighFive::DataSet dataset_;
+	HighFiveWorkerPool& pool_;
+	size_t max_pending_chunks_;
+	int level_;
+	size_t chunk_rows_;
+	size_t columns_;
+	size_t row_bytes_;
+	size_t rows_;
+	size_t extent_;
+	size_t resize_count_;
+	size_t partial_bytes_{0};
+	bool written_{false};  ///< Whether chunks were committed since the last flush
+	std::vector<uint8_t> buffer_;
+	std::vector<std::vector<uint8_t>> raw_pool_;   ///< Chunk buffers of committed chunks, for reuse
+	std::vector<std::vector<uint8_t>> data_pool_;  ///< Compression output buffers of committed chunks, for reuse
+	std::deque<PendingChunk> pending_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveChunkWriter_hh
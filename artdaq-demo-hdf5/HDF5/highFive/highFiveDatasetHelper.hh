@@ -2,6 +2,11 @@
 #define artdaq_demo_hdf5_HDF5_highFive_highFiveDatasetHelper_hh 1
 
 #include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5DataSet.hpp>
+#include "artdaq-demo-hdf5/HDF5/TimingHistogram.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
 
 namespace artdaq {
 namespace hdf5 {
@@ -10,6 +15,11 @@ namespace hdf5 {
  * @brief Helper class for HighFiveNtupleDataset
  *
  * This class represents a column in an Ntuple-formatted group of datasets
+ *
+ * When writing, the extent of the dataset is grown ahead of the rows written (by one chunk, or geometrically, see
+ * setExtentGrowth). When the helper is closed (or destroyed), the extent is trimmed to the rows written and the row
+ * count is stored in the "rowCount" attribute of the dataset. Readers use that attribute when it is present, so that
+ * extents padded by a writer which did not close the file are not read as data.
  */
 class HighFiveDatasetHelper
 {
@@ -21,9 +31,13 @@ public:
 	 */
 	HighFiveDatasetHelper(HighFive::DataSet const& dataset, size_t chunk_size = 128)
 	    : dataset_(dataset)
-	    , current_row_(0)
+	    , current_row_(rowCount(dataset))
 	    , current_size_(dataset.getDimensions()[0])
 	    , chunk_size_(chunk_size)
+	    , growth_factor_(1.0)
+	    , resize_count_(0)
+	    , resize_timing_(nullptr)
+	    , written_(false)
 	{
 		// Zero-size chunks are not allowed
 		if (chunk_size_ == 0)
@@ -32,6 +46,76 @@ public:
 		}
 	}
 
+	/**
+	 * @brief HighFiveDatasetHelper Destructor, closes the column (see close())
+	 */
+	~HighFiveDatasetHelper() noexcept
+	{
+		try
+		{
+			close();
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG_ERROR("HighFiveDatasetHelper") << "Error trimming dataset: " << ex.what();
+		}
+	}
+
+	/**
+	 * @brief Trim the extent of a written column to the rows written, and store the row count in the "rowCount" attribute
+	 *
+	 * Does nothing if no rows were written through this helper. Writing after close() grows the dataset again.
+	 */
+	void close()
+	{
+		if (!written_) return;
+		written_ = false;
+
+		TLOG(TLVL_TRACE) << "HighFiveDatasetHelper::close: Trimming dataset from " << current_size_ << " to " << current_row_ << " rows";
+		if (current_size_ != current_row_)
+		{
+			dataset_.resize({current_row_, dataset_.getDimensions()[1]});
+			current_size_ = current_row_;
+		}
+		writeRowCount(dataset_, current_row_);
+	}
+
+	/**
+	 * @brief Store the number of valid rows of a dataset in its "rowCount" attribute
+	 * @param dataset Dataset to annotate
+	 * @param rows Number of valid rows
+	 *
+	 * Used by writers which manage the extent of a dataset themselves, so that readers see the same contract as for
+	 * datasets written through a HighFiveDatasetHelper.
+	 */
+	static void writeRowCount(HighFive::DataSet& dataset, size_t rows)
+	{
+		uint64_t value = rows;
+		if (dataset.hasAttribute(RowCountAttribute))
+		{
+			dataset.getAttribute(RowCountAttribute).write(value);
+		}
+		else
+		{
+			dataset.createAttribute(RowCountAttribute, value);
+		}
+	}
+
+	/**
+	 * @brief Get the number of valid rows of a dataset
+	 * @param dataset Dataset to check
+	 * @return The "rowCount" attribute, if present and within the extent, otherwise the extent of the dataset
+	 */
+	static size_t rowCount(HighFive::DataSet const& dataset)
+	{
+		size_t extent = dataset.getDimensions()[0];
+		if (!dataset.hasAttribute(RowCountAttribute)) return extent;
+
+		uint64_t rows = 0;
+		dataset.getAttribute(RowCountAttribute).read(rows);
+		return std::min<size_t>(rows, extent);
+	}
+
 	/**
 	 * @brief Write a value to the column, resizing if necessary
 	 * @param data Value to write
@@ -40,6 +124,7 @@ public:
 	void write(T const& data)
 	{
 		if (current_row_ >= current_size_) resize();
+		written_ = true;
 
 		dataset_.select({current_row_, 0}, {1, 1}).write(data);
 		current_row_++;
@@ -54,6 +139,7 @@ public:
 	void write(T const& data, size_t width)
 	{
 		if (current_row_ >= current_size_) resize();
+		written_ = true;
 
 		dataset_.select({current_row_, 0}, {1, width}).write(data);
 		current_row_++;
@@ -67,9 +153,9 @@ public:
 	template<typename T>
 	std::vector<T> read(size_t row)
 	{
-		if (row >= current_size_)
+		if (row >= current_row_)
 		{
-			TLOG_ERROR("HighFiveDatasetHelper") << "Requested row " << row << " is outside the bounds of this dataset! dataset sz=" << current_size_;
+			TLOG_ERROR("HighFiveDatasetHelper") << "Requested row " << row << " is outside the bounds of this dataset! dataset sz=" << current_row_;
 			return std::vector<T>();
 		}
 
@@ -78,6 +164,26 @@ public:
 		return readBuf;
 	}
 
+	/**
+	 * @brief Read the leading values of a row of the column into a caller-provided buffer
+	 * @param row Row to read
+	 * @param buf Buffer to read into, which must hold at least width values
+	 * @param width Number of values to read from the start of the row
+	 * @return Whether the row was read
+	 */
+	template<typename T>
+	bool read(size_t row, T* buf, size_t width)
+	{
+		if (row >= current_row_)
+		{
+			TLOG_ERROR("HighFiveDatasetHelper") << "Requested row " << row << " is outside the bounds of this dataset! dataset sz=" << current_row_;
+			return false;
+		}
+
+		dataset_.select({row, 0}, {1, width}).read(buf);
+		return true;
+	}
+
 	/**
 	 * @brief Read a single value from the column
 	 * @param row Row to read
@@ -92,23 +198,73 @@ public:
 		return T();
 	}
 
+	/**
+	 * @brief Read the first value of every row of the column in a single operation
+	 * @return Vector containing one value per row of the column
+	 */
+	template<typename T>
+	std::vector<T> readColumn()
+	{
+		std::vector<T> readBuf;
+		if (current_row_ == 0) return readBuf;
+
+		dataset_.select({0, 0}, {current_row_, 1}).read(readBuf);
+		return readBuf;
+	}
+
 	/**
 	 * @brief Get the number of rows in the column
-	 * @return The number of rows in the column
+	 * @return The number of rows written, or for an existing dataset, its row count (see rowCount)
 	 */
-	size_t getDatasetSize() { return current_size_; }
+	size_t getDatasetSize() { return current_row_; }
 	/**
 	 * @brief Get the number of entries in each row
 	 * @return The number of entries in each row
 	 */
 	size_t getRowSize() { return dataset_.getDimensions()[1]; }
+	/**
+	 * @brief Get the underlying dataset
+	 * @return The HighFive::DataSet of the column
+	 */
+	HighFive::DataSet const& getDataset() const { return dataset_; }
+	/**
+	 * @brief Get the number of times the column has been extended
+	 * @return The number of resize operations performed on the dataset
+	 */
+	size_t getResizeCount() { return resize_count_; }
+	/**
+	 * @brief Record the duration of each resize operation in the given histogram
+	 * @param hist TimingHistogram to record into (must outlive this HighFiveDatasetHelper)
+	 */
+	void setResizeTiming(TimingHistogram& hist) { resize_timing_ = &hist; }
+	/**
+	 * @brief Set how the extent of the column grows when it is full
+	 * @param factor 1 grows the dataset by about one chunk at a time. Larger values grow it to factor times its current
+	 *   extent (rounded up to whole chunks), so that the number of resize operations grows only logarithmically with
+	 *   the number of rows. The extent is trimmed when the helper is closed.
+	 */
+	void setExtentGrowth(double factor) { growth_factor_ = std::max(factor, 1.0); }
 
 private:
 	void resize()
 	{
-		TLOG(TLVL_TRACE) << "HighFiveDatasetHelper::resize: Growing dataset by one chunk";
+		TLOG(TLVL_TRACE) << "HighFiveDatasetHelper::resize: Growing dataset from " << current_size_ << " rows";
+#if ARTDAQ_DEMO_HDF5_TIMING
+		std::optional<ScopedTimer> timer;
+		if (resize_timing_ != nullptr) timer.emplace(*resize_timing_);
+#endif
+		if (growth_factor_ > 1.0)
+		{
+			// Geometric growth, to a whole number of chunks and by at least one chunk
+			auto target = static_cast<size_t>(std::ceil(current_size_ * growth_factor_));
+			target = std::max(target, current_size_ + chunk_size_);
+			target = ((target + chunk_size_ - 1) / chunk_size_) * chunk_size_;
+
+			dataset_.resize({target, dataset_.getDimensions()[1]});
+			current_size_ = target;
+		}
 		// Ideally, grow by one chunk at a time
-		if (current_size_ % chunk_size_ == 0)
+		else if (current_size_ % chunk_size_ == 0)
 		{
 			dataset_.resize({current_size_ + chunk_size_, dataset_.getDimensions()[1]});
 			current_size_ += chunk_size_;
@@ -124,13 +280,20 @@ private:
 			dataset_.resize({current_size_ + size_add, dataset_.getDimensions()[1]});
 			current_size_ += size_add;
 		}
+		resize_count_++;
 	}
 
 private:
+	static constexpr char const* RowCountAttribute = "rowCount";
+
 	HighFive::DataSet dataset_;
 	size_t current_row_;
 	size_t current_size_;
 	size_t chunk_size_;
+	double growth_factor_;
+	size_t resize_count_;
+	TimingHistogram* resize_timing_;
+	bool written_;
 };
 }  // namespace hdf5
 }  // namespace artdaq
@@ -0,0 +1,137 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveEventHeaderTable_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveEventHeaderTable_hh 1
+
+#include "tracemf.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5DataType.hpp>
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+#include "artdaq-core/Data/RawEvent.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief In-memory HDF5 datatype of a RawEventHeader
+ * @return CompoundType with the RawEventHeader member offsets and size
+ */
+inline HighFive::CompoundType eventHeaderDataType()
+{
+	static_assert(sizeof(bool) == sizeof(uint8_t), "is_complete is stored as a uint8_t");
+	return HighFive::CompoundType({{"run_id", HighFive::AtomicType<uint32_t>(), offsetof(artdaq::detail::RawEventHeader, run_id)},
+	                               {"subrun_id", HighFive::AtomicType<uint32_t>(), offsetof(artdaq::detail::RawEventHeader, subrun_id)},
+	                               {"event_id", HighFive::AtomicType<uint32_t>(), offsetof(artdaq::detail::RawEventHeader, event_id)},
+	                               {"sequenceID", HighFive::AtomicType<uint64_t>(), offsetof(artdaq::detail::RawEventHeader, sequence_id)},
+	                               {"timestamp", HighFive::AtomicType<uint64_t>(), offsetof(artdaq::detail::RawEventHeader, timestamp)},
+	                               {"is_complete", HighFive::AtomicType<uint8_t>(), offsetof(artdaq::detail::RawEventHeader, is_complete)}},
+	                              sizeof(artdaq::detail::RawEventHeader));
+}
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+HIGHFIVE_REGISTER_TYPE(artdaq::detail::RawEventHeader, artdaq::hdf5::eventHeaderDataType)
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Compound-typed RawEventHeader table used by HighFiveNtupleDataset
+ *
+ * Each event header is one record of the "records" dataset in the EventHeaders group, with the members run_id,
+ * subrun_id, event_id, sequenceID, timestamp and is_complete (the names of the per-field columns used by older files).
+ * Writing a header is a single dataset write, and readers load the whole table with one read and look headers up in
+ * memory. Unused records at the end of the table are zero-filled, and are recognized by their zero sequence ID.
+ */
+class HighFiveEventHeaderTable
+{
+public:
+	/**
+	 * @brief Create the header table of a file being written
+	 * @param group EventHeaders group to create the "records" dataset in
+	 * @param chunk_size Number of records per chunk
+	 * @param props Dataset creation properties (e.g. from HighFiveFileProfile), chunking is added to them
+	 * @return HighFiveEventHeaderTable for writing
+	 */
+	static std::unique_ptr<HighFiveEventHeaderTable> create(HighFive::Group& group, size_t chunk_size, HighFive::DataSetCreateProps props)
+	{
+		if (chunk_size == 0) chunk_size = 128;
+		props.add(HighFive::Chunking(std::vector<hsize_t>{chunk_size, 1}));
+
+		// The file type is packed, so that the padding of RawEventHeader is not stored
+		auto fileType = eventHeaderDataType();
+		H5Tpack(fileType.getId());
+		auto dataset = group.createDataSet(datasetName(), HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1}), fileType, props);
+		return std::unique_ptr<HighFiveEventHeaderTable>(new HighFiveEventHeaderTable(std::make_unique<HighFiveDatasetHelper>(dataset, chunk_size)));
+	}
+
+	/**
+	 * @brief Check whether a group holds a header table
+	 * @param group EventHeaders group of the file
+	 * @return Whether the "records" dataset exists (files with per-field header columns do not have it)
+	 */
+	static bool exists(HighFive::Group const& group) { return group.exist(datasetName()); }
+
+	/**
+	 * @brief Read the header table of a file in a single operation
+	 * @param group EventHeaders group to read the "records" dataset from
+	 * @return All headers in the table, in the order they were written
+	 */
+	static std::vector<artdaq::detail::RawEventHeader> read(HighFive::Group const& group)
+	{
+		auto dataset = group.getDataSet(datasetName());
+		auto rows = HighFiveDatasetHelper::rowCount(dataset);
+		std::vector<artdaq::detail::RawEventHeader> table(rows, artdaq::detail::RawEventHeader(0, 0, 0, 0, 0));
+		if (!table.empty()) dataset.select({0, 0}, {rows, 1}).read(table.data());
+
+		table.erase(std::remove_if(table.begin(), table.end(), [](artdaq::detail::RawEventHeader const& hdr) { return hdr.sequence_id == 0; }), table.end());
+		TLOG(TLVL_DEBUG, "HighFiveEventHeaderTable") << "Read " << table.size() << " event headers";
+		return table;
+	}
+
+	/**
+	 * @brief Append a header to the table
+	 * @param hdr RawEventHeader to append
+	 */
+	void write(artdaq::detail::RawEventHeader const& hdr) { table_->write(&hdr, 1); }
+
+	/**
+	 * @brief Get the number of times the header table has been extended
+	 * @return The number of resize operations performed on the dataset
+	 */
+	size_t getResizeCount() { return table_->getResizeCount(); }
+	/**
+	 * @brief Record the duration of each resize operation in the given histogram
+	 * @param hist TimingHistogram to record into (must outlive this HighFiveEventHeaderTable)
+	 */
+	void setResizeTiming(TimingHistogram& hist) { table_->setResizeTiming(hist); }
+	/**
+	 * @brief Set how the extent of the header table grows when it is full
+	 * @param factor Growth factor, see HighFiveDatasetHelper::setExtentGrowth
+	 */
+	void setExtentGrowth(double factor) { table_->setExtentGrowth(factor); }
+
+	/**
+	 * @brief Name of the header table dataset
+	 * @return "records"
+	 */
+	static std::string datasetName() { return "records"; }
+
+private:
+	explicit HighFiveEventHeaderTable(std::unique_ptr<HighFiveDatasetHelper> table)
+	    : table_(std::move(table))
+	{}
+
+	std::unique_ptr<HighFiveDatasetHelper> table_;
+};
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveEventHeaderTable_hh
@@ -0,0 +1,462 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveFileProfile_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveFileProfile_hh 1
+
+#include "tracemf.h"
+
+#include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveUringDriver.hh"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief HDF5 file creation, file access and dataset creation settings shared by the HighFive plugins
+ *
+ * The profile is read from the "fileProfile" table of the plugin's ParameterSet. A preset supplies the defaults, and any
+ * of the individual parameters may be given to override it:
+ * "preset" (Default: "default"): "default" leaves every setting at the HDF5 library default. "daq_write" is tuned for
+ *   writing many small objects: new-style (compact/dense) groups, 1 MiB paged file-space aggregation with a 16 MiB page
+ *   buffer, 1 MiB metadata and small-data blocks, a larger metadata cache, no fill values, and doubling table extents. "analysis_read" uses a
+ *   64 MiB page buffer (when the file was written with paged aggregation) and a large metadata cache.
+ * "libverLow", "libverHigh" (Default: ""): Library version bounds for the objects written ("earliest", "v18", "v110", "v112", "latest").
+ *   A lower bound of "v18" or later is needed for compact/dense link storage in groups.
+ * "pageSize" (Default: 0): File space page size, in bytes. Non-zero values select the paged aggregation file space strategy for new files.
+ * "persistFreeSpace" (Default: false): Whether free-space managers are saved in the file (paged aggregation only)
+ * "freeSpaceThreshold" (Default: 1): Smallest free-space section tracked, in bytes (paged aggregation only)
+ * "pageBufferSize" (Default: 0): Size of the page buffer, in bytes. Only used for files with paged aggregation.
+ * "metaBlockSize" (Default: 0): Size of the blocks used to aggregate metadata allocations, in bytes (0 = library default)
+ * "smallDataBlockSize" (Default: 0): Size of the blocks used to aggregate small raw data allocations, in bytes (0 = library default)
+ * "metadataCacheInitialSize", "metadataCacheMinSize", "metadataCacheMaxSize" (Default: 0): Metadata cache sizes, in bytes (0 = library default)
+ * "fillTime" (Default: ""): When fill values are written to new datasets ("never", "alloc", "ifset")
+ * "allocTime" (Default: ""): When storage is allocated for new datasets ("early", "late", "incremental")
+ * "deflateLevel" (Default: 0): gzip compression level (1-9) for chunked datasets, 0 disables compression. Contiguous
+ *   datasets cannot be filtered and are always written uncompressed.
+ * "driver" (Default: ""): HDF5 file driver. "" uses the library default (sec2), "sec2" selects it explicitly,
+ *   "io_uring" selects the io_uring driver (see uringDriverId), which keeps many writes in flight from one thread, and
+ *   "core" builds the file in memory and writes it to disk in large sequential writes (see HighFiveCoreSpill).
+ * "uringQueueDepth" (Default: 64): Maximum number of requests in flight with the io_uring driver
+ * "uringWriteBufferSize" (Default: 1048576): Adjacent writes are coalesced into requests of up to this size, in bytes (io_uring driver)
+ * "uringReadaheadSize" (Default: 4194304): Readahead window for small reads, in bytes, 0 disables readahead (io_uring driver)
+ * "coreIncrement" (Default: 67108864): Size by which the in-memory file image grows, in bytes (core driver)
+ * "coreBackingStore" (Default: true): Whether the image is written to fileName; false keeps the file in memory only (core driver)
+ * "coreWriteTrackingPageSize" (Default: 0): With 0, the whole image is written when the file is flushed or closed. Otherwise
+ *   only the pages (of this size, in bytes) modified since the previous flush are written (core driver)
+ * "coreSpillSize" (Default: 0): When the image has grown by this many bytes since the previous flush, the plugin
+ *   flushes the file, writing the modified pages to fileName. The image grows in coreIncrement steps, so the spill size
+ *   is effectively rounded up to a multiple of it. 0 writes everything at close (core driver)
+ * "extentGrowthFactor" (Default: 1.0): How the tables written through HighFiveDatasetHelper grow when they are full.
+ *   1 adds about one chunk per resize; larger values grow the extent by this factor, and it is trimmed to the rows
+ *   written when the file is closed (see HighFiveDatasetHelper::setExtentGrowth)
+ */
+class HighFiveFileProfile
+{
+public:
+	/**
+	 * @brief HighFiveFileProfile Constructor
+	 * @param ps ParameterSet of the plugin, which may contain a "fileProfile" table
+	 */
+	explicit HighFiveFileProfile(fhicl::ParameterSet const& ps)
+	{
+		auto profile = ps.get<fhicl::ParameterSet>("fileProfile", fhicl::ParameterSet());
+		preset_ = profile.get<std::string>("preset", "default");
+
+		if (preset_ == "daq_write")
+		{
+			libverLow_ = "v110";
+			libverHigh_ = "latest";
+			pageSize_ = 1024 * 1024;
+			pageBufferSize_ = 16 * 1024 * 1024;
+			metaBlockSize_ = 1024 * 1024;
+			smallDataBlockSize_ = 1024 * 1024;
+			mdcInitialSize_ = 16 * 1024 * 1024;
+			mdcMinSize_ = 4 * 1024 * 1024;
+			mdcMaxSize_ = 64 * 1024 * 1024;
+			fillTime_ = "never";
+			allocTime_ = "late";
+			extentGrowthFactor_ = 2.0;
+		}
+		else if (preset_ == "analysis_read")
+		{
+			pageBufferSize_ = 64 * 1024 * 1024;
+			mdcInitialSize_ = 32 * 1024 * 1024;
+			mdcMinSize_ = 8 * 1024 * 1024;
+			mdcMaxSize_ = 128 * 1024 * 1024;
+		}
+		else if (preset_ != "default")
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Unknown fileProfile preset " << preset_ << ", using \"default\"";
+			preset_ = "default";
+		}
+
+		libverLow_ = profile.get<std::string>("libverLow", libverLow_);
+		libverHigh_ = profile.get<std::string>("libverHigh", libverHigh_);
+		pageSize_ = profile.get<hsize_t>("pageSize", pageSize_);
+		persistFreeSpace_ = profile.get<bool>("persistFreeSpace", persistFreeSpace_);
+		freeSpaceThreshold_ = profile.get<hsize_t>("freeSpaceThreshold", freeSpaceThreshold_);
+		pageBufferSize_ = profile.get<size_t>("pageBufferSize", pageBufferSize_);
+		metaBlockSize_ = profile.get<hsize_t>("metaBlockSize", metaBlockSize_);
+		smallDataBlockSize_ = profile.get<hsize_t>("smallDataBlockSize", smallDataBlockSize_);
+		mdcInitialSize_ = profile.get<size_t>("metadataCacheInitialSize", mdcInitialSize_);
+		mdcMinSize_ = profile.get<size_t>("metadataCacheMinSize", mdcMinSize_);
+		mdcMaxSize_ = profile.get<size_t>("metadataCacheMaxSize", mdcMaxSize_);
+		fillTime_ = profile.get<std::string>("fillTime", fillTime_);
+		allocTime_ = profile.get<std::string>("allocTime", allocTime_);
+		deflateLevel_ = profile.get<unsigned>("deflateLevel", deflateLevel_);
+		driver_ = profile.get<std::string>("driver", driver_);
+		uringConfig_.queueDepth = profile.get<unsigned>("uringQueueDepth", uringConfig_.queueDepth);
+		uringConfig_.writeBufferSize = profile.get<size_t>("uringWriteBufferSize", uringConfig_.writeBufferSize);
+		uringConfig_.readaheadSize = profile.get<size_t>("uringReadaheadSize", uringConfig_.readaheadSize);
+		coreIncrement_ = profile.get<size_t>("coreIncrement", coreIncrement_);
+		coreBackingStore_ = profile.get<bool>("coreBackingStore", coreBackingStore_);
+		coreWriteTrackingPageSize_ = profile.get<size_t>("coreWriteTrackingPageSize", coreWriteTrackingPageSize_);
+		coreSpillSize_ = profile.get<hsize_t>("coreSpillSize", coreSpillSize_);
+		extentGrowthFactor_ = profile.get<double>("extentGrowthFactor", extentGrowthFactor_);
+		if (!driver_.empty() && driver_ != "sec2" && driver_ != "io_uring" && driver_ != "core")
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Unknown driver " << driver_ << ", using the library default";
+			driver_ = "";
+		}
+		if (uringConfig_.queueDepth == 0 || uringConfig_.queueDepth > 4096)
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "uringQueueDepth " << uringConfig_.queueDepth << " is out of range, using 64";
+			uringConfig_.queueDepth = 64;
+		}
+		if (driver_ == "core")
+		{
+			if (coreIncrement_ == 0)
+			{
+				TLOG(TLVL_WARNING, "HighFiveFileProfile") << "coreIncrement must be non-zero, using 64 MiB";
+				coreIncrement_ = 64 * 1024 * 1024;
+			}
+			if (coreSpillSize_ > 0 && !coreBackingStore_)
+			{
+				TLOG(TLVL_WARNING, "HighFiveFileProfile") << "coreSpillSize is set, but coreBackingStore is false; the file is kept in memory only";
+				coreSpillSize_ = 0;
+			}
+			if (coreSpillSize_ > 0 && coreWriteTrackingPageSize_ == 0)
+			{
+				// Without write tracking, each spill would rewrite the whole image
+				TLOG(TLVL_WARNING, "HighFiveFileProfile") << "coreSpillSize is set without coreWriteTrackingPageSize, using 1 MiB pages";
+				coreWriteTrackingPageSize_ = 1024 * 1024;
+			}
+			if (pageSize_ > 0 && !coreBackingStore_)
+			{
+				// The file is created and reopened to set up paged aggregation, which needs it on disk
+				TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Paged aggregation needs coreBackingStore, disabling pageSize";
+				pageSize_ = 0;
+			}
+		}
+		if (!(extentGrowthFactor_ >= 1.0))
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "extentGrowthFactor " << extentGrowthFactor_ << " must be at least 1, using 1";
+			extentGrowthFactor_ = 1.0;
+		}
+		if (deflateLevel_ > 9)
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "deflateLevel " << deflateLevel_ << " is out of range, using 9";
+			deflateLevel_ = 9;
+		}
+
+		if (pageSize_ > 0 && pageBufferSize_ > 0 && pageBufferSize_ % pageSize_ != 0)
+		{
+			auto rounded = ((pageBufferSize_ + pageSize_ - 1) / pageSize_) * pageSize_;
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "pageBufferSize " << pageBufferSize_ << " is not a multiple of pageSize " << pageSize_ << ", using " << rounded;
+			pageBufferSize_ = rounded;
+		}
+	}
+
+	/**
+	 * @brief Open an HDF5 file using this profile
+	 * @param fileName Name of the file
+	 * @param mode FragmentDatasetMode::Read opens an existing file read-only, FragmentDatasetMode::Write creates (truncates) the file
+	 * @return Handle to the opened file
+	 *
+	 * HighFive 2.2 cannot pass a file creation property list, so when paged aggregation is requested the file is
+	 * first created and closed through the C API, then reopened; the file space settings are persistent in the file.
+	 */
+	std::unique_ptr<HighFive::File> openFile(std::string const& fileName, FragmentDatasetMode mode) const
+	{
+		TLOG(TLVL_DEBUG, "HighFiveFileProfile") << "Opening " << fileName << " with fileProfile preset " << preset_;
+		if (mode == FragmentDatasetMode::Read)
+		{
+			HighFive::FileAccessProps fapl;
+			fapl.add(AccessProperties{*this, pageBufferSize_ > 0 && isPaged_(fileName)});
+			return std::make_unique<HighFive::File>(fileName, HighFive::File::ReadOnly, fapl);
+		}
+
+		HighFive::FileAccessProps fapl;
+		fapl.add(AccessProperties{*this, pageSize_ > 0});
+		if (pageSize_ > 0)
+		{
+			hid_t fcpl = H5Pcreate(H5P_FILE_CREATE);
+			herr_t status = H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, persistFreeSpace_, freeSpaceThreshold_);
+			if (status >= 0) status = H5Pset_file_space_page_size(fcpl, pageSize_);
+			hid_t fid = status >= 0 ? H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, fcpl, fapl.getId()) : -1;
+			H5Pclose(fcpl);
+			check_(fid, "Creating file with paged aggregation");
+			H5Fclose(fid);
+			return std::make_unique<HighFive::File>(fileName, HighFive::File::ReadWrite, fapl);
+		}
+		return std::make_unique<HighFive::File>(fileName, HighFive::File::OpenOrCreate | HighFive::File::Truncate, fapl);
+	}
+
+	/**
+	 * @brief Add the dataset creation settings (fill time, allocation time, compression) of this profile to a property list
+	 * @param props DataSetCreateProps used to create the plugin's datasets. Chunking must already have been added for compression to be applied.
+	 */
+	void applyTo(HighFive::DataSetCreateProps& props) const
+	{
+		if (fillTime_.empty() && allocTime_.empty() && deflateLevel_ == 0) return;
+		props.add(DatasetProperties{*this});
+	}
+
+	/**
+	 * @brief Get the name of the preset this profile is based on
+	 * @return Preset name
+	 */
+	std::string const& preset() const { return preset_; }
+
+	/**
+	 * @brief Get the spill size for files opened with the core driver
+	 * @return Bytes added to the in-memory image after which the file is flushed (0 if the file is only written at close)
+	 */
+	hsize_t coreSpillSize() const { return driver_ == "core" ? coreSpillSize_ : 0; }
+
+	/**
+	 * @brief Get the growth factor of tables written through HighFiveDatasetHelper
+	 * @return Factor by which full tables are extended (1 for one chunk at a time)
+	 */
+	double extentGrowthFactor() const { return extentGrowthFactor_; }
+
+private:
+	struct AccessProperties
+	{
+		HighFiveFileProfile const& profile;
+		bool usePageBuffer;
+
+		void apply(hid_t fapl) const { profile.applyAccess_(fapl, usePageBuffer); }
+	};
+
+	struct DatasetProperties
+	{
+		HighFiveFileProfile const& profile;
+
+		void apply(hid_t dcpl) const { profile.applyDataset_(dcpl); }
+	};
+
+	static void check_(int64_t status, char const* call)
+	{
+		if (status < 0)
+		{
+			HighFive::HDF5ErrMapper::ToException<HighFive::PropertyException>(std::string("HighFiveFileProfile: ") + call + " failed");
+		}
+	}
+
+	static H5F_libver_t libver_(std::string const& name)
+	{
+		if (name == "earliest") return H5F_LIBVER_EARLIEST;
+		if (name == "v18") return H5F_LIBVER_V18;
+		if (name == "v110") return H5F_LIBVER_V110;
+		if (name == "v112") return H5F_LIBVER_V112;
+		if (name != "latest")
+		{
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Unknown library version " << name << ", using \"latest\"";
+		}
+		return H5F_LIBVER_LATEST;
+	}
+
+	bool isPaged_(std::string const& fileName) const
+	{
+		bool paged = false;
+		hid_t fid = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+		if (fid < 0) return false;  // The HighFive::File constructor reports the error
+		hid_t fcpl = H5Fget_create_plist(fid);
+		H5F_fspace_strategy_t strategy;
+		hbool_t persist;
+		hsize_t threshold;
+		if (H5Pget_file_space_strategy(fcpl, &strategy, &persist, &threshold) >= 0)
+		{
+			paged = strategy == H5F_FSPACE_STRATEGY_PAGE;
+		}
+		H5Pclose(fcpl);
+		H5Fclose(fid);
+		if (!paged)
+		{
+			TLOG(TLVL_DEBUG, "HighFiveFileProfile") << fileName << " was not written with paged aggregation, not using a page buffer";
+		}
+		return paged;
+	}
+
+	void applyAccess_(hid_t fapl, bool usePageBuffer) const
+	{
+		if (driver_ == "sec2")
+		{
+			check_(H5Pset_fapl_sec2(fapl), "H5Pset_fapl_sec2");
+		}
+		else if (driver_ == "io_uring")
+		{
+			check_(setUringDriver(fapl, uringConfig_), "setUringDriver");
+		}
+		else if (driver_ == "core")
+		{
+			check_(H5Pset_fapl_core(fapl, coreIncrement_, coreBackingStore_), "H5Pset_fapl_core");
+			if (coreWriteTrackingPageSize_ > 0)
+			{
+				check_(H5Pset_core_write_tracking(fapl, true, coreWriteTrackingPageSize_), "H5Pset_core_write_tracking");
+			}
+		}
+		if (!libverLow_.empty() || !libverHigh_.empty())
+		{
+			check_(H5Pset_libver_bounds(fapl, libver_(libverLow_.empty() ? "earliest" : libverLow_), libver_(libverHigh_.empty() ? "latest" : libverHigh_)), "H5Pset_libver_bounds");
+		}
+		if (usePageBuffer && pageBufferSize_ > 0)
+		{
+			check_(H5Pset_page_buffer_size(fapl, pageBufferSize_, 0, 0), "H5Pset_page_buffer_size");
+		}
+		if (metaBlockSize_ > 0)
+		{
+			check_(H5Pset_meta_block_size(fapl, metaBlockSize_), "H5Pset_meta_block_size");
+		}
+		if (smallDataBlockSize_ > 0)
+		{
+			check_(H5Pset_small_data_block_size(fapl, smallDataBlockSize_), "H5Pset_small_data_block_size");
+		}
+		if (mdcInitialSize_ > 0 || mdcMinSize_ > 0 || mdcMaxSize_ > 0)
+		{
+			H5AC_cache_config_t config;
+			config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+			check_(H5Pget_mdc_config(fapl, &config), "H5Pget_mdc_config");
+			if (mdcMaxSize_ > 0) config.max_size = mdcMaxSize_;
+			if (mdcMinSize_ > 0) config.min_size = mdcMinSize_;
+			if (mdcInitialSize_ > 0)
+			{
+				config.set_initial_size = true;
+				config.initial_size = mdcInitialSize_;
+			}
+			// The library requires min_size <= initial_size <= max_size
+			config.max_size = std::max({config.max_size, config.min_size, config.initial_size});
+			config.min_size = std::min(config.min_size, config.initial_size);
+			check_(H5Pset_mdc_config(fapl, &config), "H5Pset_mdc_config");
+		}
+	}
+
+	void applyDataset_(hid_t dcpl) const
+	{
+		if (fillTime_ == "never")
+			check_(H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER), "H5Pset_fill_time");
+		else if (fillTime_ == "alloc")
+			check_(H5Pset_fill_time(dcpl, H5D_FILL_TIME_ALLOC), "H5Pset_fill_time");
+		else if (fillTime_ == "ifset")
+			check_(H5Pset_fill_time(dcpl, H5D_FILL_TIME_IFSET), "H5Pset_fill_time");
+		else if (!fillTime_.empty())
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Unknown fillTime " << fillTime_ << ", ignoring";
+
+		if (allocTime_ == "early")
+			check_(H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY), "H5Pset_alloc_time");
+		else if (allocTime_ == "late")
+			check_(H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_LATE), "H5Pset_alloc_time");
+		else if (allocTime_ == "incremental")
+			check_(H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_INCR), "H5Pset_alloc_time");
+		else if (!allocTime_.empty())
+			TLOG(TLVL_WARNING, "HighFiveFileProfile") << "Unknown allocTime " << allocTime_ << ", ignoring";
+
+		if (deflateLevel_ > 0 && H5Pget_layout(dcpl) == H5D_CHUNKED)
+		{
+			check_(H5Pset_deflate(dcpl, deflateLevel_), "H5Pset_deflate");
+		}
+	}
+
+	std::string preset_;
+	std::string libverLow_;
+	std::string libverHigh_;
+	hsize_t pageSize_{0};
+	bool persistFreeSpace_{false};
+	hsize_t freeSpaceThreshold_{1};
+	size_t pageBufferSize_{0};
+	hsize_t metaBlockSize_{0};
+	hsize_t smallDataBlockSize_{0};
+	size_t mdcInitialSize_{0};
+	size_t mdcMinSize_{0};
+	size_t mdcMaxSize_{0};
+	std::string fillTime_;
+	std::string allocTime_;
+	unsigned deflateLevel_{0};
+	std::string driver_;
+	UringDriverConfig uringConfig_;
+	size_t coreIncrement_{64 * 1024 * 1024};
+	bool coreBackingStore_{true};
+	size_t coreWriteTrackingPageSize_{0};
+	hsize_t coreSpillSize_{0};
+	double extentGrowthFactor_{1.0};
+};
+/**
+ * @brief Flushes a file opened with the core driver each time its image has grown by the profile's coreSpillSize
+ *
+ * With the core driver, HDF5 builds the whole file in memory. Flushing it writes the pages modified since the previous
+ * flush (with coreWriteTrackingPageSize) to the backing file in large sequential writes, so that the data is on disk
+ * long before the file is closed. The memory of the image is only released when the file is closed, so the file size
+ * should be limited by rotating files.
+ */
+class HighFiveCoreSpill
+{
+public:
+	HighFiveCoreSpill() = default;
+	/**
+	 * @brief HighFiveCoreSpill Constructor
+	 * @param file File to flush; must outlive this object
+	 * @param spillSize Growth of the image after which the file is flushed, in bytes (0 disables flushing)
+	 */
+	HighFiveCoreSpill(HighFive::File& file, hsize_t spillSize)
+	    : file_(&file), spillSize_(spillSize) {}
+
+	/**
+	 * @brief Flush the file if its image has grown by the spill size since the previous flush (call once per event)
+	 */
+	void check()
+	{
+		if (file_ == nullptr || spillSize_ == 0) return;
+		// The core driver reports the size of its memory image, which grows in coreIncrement steps
+		hsize_t size = 0;
+		if (H5Fget_filesize(file_->getId(), &size) < 0 || size < spilled_ + spillSize_) return;
+
+		TLOG(TLVL_DEBUG, "HighFiveCoreSpill") << "Flushing in-memory file image at " << size << " bytes (" << size - spilled_ << " bytes since the previous flush)";
+		if (H5Fflush(file_->getId(), H5F_SCOPE_LOCAL) < 0)
+		{
+			TLOG(TLVL_ERROR, "HighFiveCoreSpill") << "Flushing the in-memory file image failed";
+		}
+		spilled_ = size;
+	}
+
+private:
+	HighFive::File* file_{nullptr};
+	hsize_t spillSize_{0};
+	hsize_t spilled_{0};
+};
+
+/**
+ * @brief Get the size of an open HDF5 file (implements FragmentDataset::getFileSize for the HighFive plugins)
+ * @param file File to query, may be nullptr
+ * @return Size of the file, in bytes, or 0 if it cannot be determined
+ */
+inline size_t getHDF5FileSize(HighFive::File const* file)
+{
+	hsize_t size = 0;
+	if (file == nullptr || H5Fget_filesize(file->getId(), &size) < 0)
+	{
+		TLOG(TLVL_WARNING, "HighFiveFileProfile") << "getFileSize: Unable to determine size of HDF5 file";
+		return 0;
+	}
+	return size;
+}
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveFileProfile_hh
@@ -0,0 +1,128 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveGroupRegistry_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveGroupRegistry_hh 1
+
+#include "tracemf.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Registry of the groups created by a HighFive writer, and of the dataset names used within them
+ *
+ * Groups are identified by their path relative to the file root (e.g. "12" for an event group, "12/TPC" for a type
+ * group). Group handles are opened or created the first time a path is requested and reused afterwards, and dataset
+ * names are made unique with per-group counters, so the write path does not need to query the file for objects it
+ * created itself (the file is only checked once per event group, and for subgroups of groups which already existed
+ * in the file). Only the groups of the most recent events are kept; if an evicted event is written to again, its
+ * groups are reopened and name uniqueness falls back to checking the file.
+ */
+class HighFiveGroupRegistry
+{
+public:
+	/**
+	 * @brief HighFiveGroupRegistry Constructor
+	 * @param file File in which groups will be created (must outlive the registry)
+	 * @param max_open_events Number of event (top-level) groups to keep handles for
+	 */
+	explicit HighFiveGroupRegistry(HighFive::File& file, size_t max_open_events = 4)
+	    : file_(file)
+	    , max_open_events_(max_open_events == 0 ? 1 : max_open_events)
+	{}
+
+	/**
+	 * @brief Get a group, opening or creating it (and its parents) if this is the first request for it
+	 * @param path Path of the group, relative to the file root
+	 * @return Handle to the group, valid until the group's event is evicted from the registry
+	 */
+	HighFive::Group& getGroup(std::string const& path)
+	{
+		auto it = entries_.find(path);
+		if (it != entries_.end())
+		{
+			return it->second.group;
+		}
+
+		auto slash = path.rfind('/');
+		if (slash == std::string::npos)
+		{
+			openEvent_(path);
+			bool exists = file_.exist(path);
+			auto group = exists ? file_.getGroup(path) : file_.createGroup(path);
+			return entries_.emplace(path, Entry{group, exists, {}}).first->second.group;
+		}
+
+		auto parentPath = path.substr(0, slash);
+		getGroup(parentPath);
+		auto& parent = entries_.at(parentPath);
+		auto name = path.substr(slash + 1);
+		bool exists = parent.preexisting && parent.group.exist(name);
+		auto group = exists ? parent.group.getGroup(name) : parent.group.createGroup(name);
+		return entries_.emplace(path, Entry{group, exists, {}}).first->second.group;
+	}
+
+	/**
+	 * @brief Get a name which is not yet used within a group
+	 * @param path Path of the group, relative to the file root
+	 * @param base Base name for the object
+	 * @param format Callable taking (base, index) and returning a candidate name; index counts up from 0 for each base
+	 * @return Name which is unique within the group
+	 */
+	template<typename NameFormatter>
+	std::string uniqueName(std::string const& path, std::string const& base, NameFormatter format)
+	{
+		getGroup(path);
+		auto& entry = entries_.at(path);
+		auto& counter = entry.counters[base];
+		auto name = format(base, counter++);
+		while (entry.preexisting && entry.group.exist(name))
+		{
+			name = format(base, counter++);
+		}
+		return name;
+	}
+
+private:
+	struct Entry
+	{
+		HighFive::Group group;
+		bool preexisting;
+		std::unordered_map<std::string, size_t> counters;
+	};
+
+	void openEvent_(std::string const& event)
+	{
+		open_events_.push_back(event);
+		while (open_events_.size() > max_open_events_)
+		{
+			auto const& evicted = open_events_.front();
+			TLOG(TLVL_TRACE, "HighFiveGroupRegistry") << "Evicting groups of event " << evicted;
+			for (auto it = entries_.begin(); it != entries_.end();)
+			{
+				if (it->first == evicted || it->first.compare(0, evicted.size() + 1, evicted + "/") == 0)
+				{
+					it = entries_.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+			open_events_.pop_front();
+		}
+	}
+
+	HighFive::File& file_;
+	size_t max_open_events_;
+	std::deque<std::string> open_events_;
+	std::unordered_map<std::string, Entry> entries_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveGroupRegistry_hh
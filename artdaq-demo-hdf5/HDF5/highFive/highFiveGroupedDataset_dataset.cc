@@ -9,12 +9,23 @@
 #define TLVL_READFRAGMENT 12
 #define TLVL_READFRAGMENT_V 13
 #define TLVL_GETEVENTHEADER 14
+#define TLVL_SCANEVENTS 15
 
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <unordered_map>
-#include "artdaq-core/Data/ContainerFragmentLoader.hh"
+#include "artdaq-core/Data/ContainerFragment.hh"
 #include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
 #include "artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveFileProfile.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveGroupRegistry.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveTimeIndex.hh"
 
 namespace artdaq {
 namespace hdf5 {
@@ -34,6 +45,20 @@ public:
 	 * HighFiveGroupedDataset accepts the following Parameters:
 	 * "fileName" (REQUIRED): File name to use
 	 * "mode" (Default: "write"): Mode string to use for this FragmentDataset
+	 * "containerWriteMode" (Default: "blocks"): How ContainerFragments are written. "blocks" writes each contained Fragment
+	 *   as its own dataset. "packed" writes the whole ContainerFragment as a single "payload" dataset, with a "block_index"
+	 *   dataset holding the end offset (in bytes) of each block. Both layouts can always be read.
+	 * "openEventGroups" (Default: 4): Number of event groups for which open group handles and dataset names are cached while writing.
+	 *   Fragments for an event which is no longer cached are still written correctly, at the cost of querying the file again.
+	 * "fileProfile" (Default: {}): HDF5 file and dataset property settings, see HighFiveFileProfile. The "daq_write" preset is recommended for this format.
+	 * "eventsPerBatch" (Default: 1): Number of consecutive events written to each group. When greater than 1, events are
+	 *   accumulated in memory and written to a "Batch_<first sequence ID>" group, in which all Fragments of the same type
+	 *   and Fragment ID are concatenated into one dataset, described by a per-type "index" table. This reduces the number
+	 *   of HDF5 objects for high-rate, small-event data. Batched files are read back one event at a time, as usual.
+	 * "writeTimeIndex" (Default: true): Whether to write the "time_index" dataset (see HighFiveTimeIndex) used by readTimeRange
+	 *
+	 * With writeChecksums (see FragmentDataset), each Fragment dataset gets a "checksum" attribute, and each type group
+	 * of a batch group a "checksums" table with one row per "index" row.
 	 */
 	HighFiveGroupedDataset(fhicl::ParameterSet const& ps);
 	/**
@@ -66,12 +91,48 @@ public:
 	 * @returns A Map of Fragment::type_t and pointers to Fragments, suitable for ArtdaqInput
 	 */
 	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readNextEvent() override;
+	/**
+	 * @brief Read the next event from the Dataset (HDF5 file), with Fragments grouped by product instance name
+	 * @returns A Map of product instance names and pointers to Fragments
+	 *
+	 * The Fragment type groups in this file format are named with the instance name of the Fragments they contain, so
+	 * Fragments are placed directly under that name. ContainerFragments are looked up in the FragmentNameHelper (once per type).
+	 */
+	std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> readNextEventByInstanceName() override;
 	/**
 	 * @brief Read a RawEventHeader from the Dataset (HDF5 file)
 	 * @param seqID Sequence ID of the RawEventHeader (should be equivalent to event number)
 	 * @return Pointer to a RawEventHeader if a match was found in the Dataset, nullptr otherwise
 	 */
 	std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const& seqID) override;
+	/**
+	 * @brief Get the current size of the HDF5 file
+	 * @return Size of the file, in bytes, as reported by H5Fget_filesize
+	 */
+	size_t getFileSize() override;
+	/**
+	 * @brief Produce a summary of every event in the Dataset without reading Fragment payloads
+	 * @return One FragmentDatasetEventSummary per event, ordered by sequence ID
+	 *
+	 * The summary is built from the attributes of the event groups and Fragment datasets. For ContainerFragments,
+	 * the byte count is the sum of the contained Fragments.
+	 */
+	std::vector<FragmentDatasetEventSummary> scanEvents() override;
+	/**
+	 * @brief Read the time index of the file
+	 * @return One FragmentTimeIndexEntry per Fragment, read from the "time_index" dataset when first requested
+	 */
+	std::vector<FragmentTimeIndexEntry> getTimeIndex() override;
+	/**
+	 * @brief Read a single event from the file, without changing the position of readNextEvent
+	 * @param seqID Sequence ID of the event to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, empty if the event was not found
+	 *
+	 * Events in batch groups are found through a map from sequence ID to batch group, built from all batch headers on
+	 * first use. The most recently read batch is kept in memory, so that reading several events of the same batch (e.g.
+	 * in readTimeRange) only reads it once.
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readEvent(artdaq::Fragment::sequence_id_t seqID) override;
 
 private:
 	HighFiveGroupedDataset(HighFiveGroupedDataset const&) = delete;
@@ -80,27 +141,124 @@ private:
 	HighFiveGroupedDataset& operator=(HighFiveGroupedDataset&&) = delete;
 
 	std::unique_ptr<HighFive::File> file_;
+	HighFiveCoreSpill coreSpill_;
+	std::unique_ptr<HighFiveGroupRegistry> registry_;
 	size_t eventIndex_;
 	HighFive::DataSetCreateProps fragmentCProps_;
 	HighFive::DataSetAccessProps fragmentAProps_;
+	bool packContainers_;
+	size_t eventsPerBatch_;
+
+	/// Columns of the "event_headers" table of a batch group
+	enum BatchHeaderColumn : size_t
+	{
+		BH_SequenceID,
+		BH_RunID,
+		BH_SubrunID,
+		BH_EventID,
+		BH_Timestamp,
+		BH_IsComplete,
+		BH_HasHeader,
+		BatchHeaderColumns
+	};
+	/// Columns of the "index" table of a type group within a batch group
+	enum BatchIndexColumn : size_t
+	{
+		BI_FragmentID,
+		BI_EventIndex,
+		BI_Type,
+		BI_Offset,
+		BI_Length,
+		BatchIndexColumns
+	};
+	using BatchHeaderRow = std::array<uint64_t, BatchHeaderColumns>;
+
+	/// Fragments of one type accumulated for the current batch
+	struct BatchTypeBuffer
+	{
+		std::map<artdaq::Fragment::fragment_id_t, std::vector<artdaq::RawDataType>> data;  ///< Concatenated Fragments (header included), per Fragment ID
+		std::vector<uint64_t> index;                                                       ///< Flattened "index" table
+		std::vector<uint32_t> checksums;                                                   ///< "checksums" table, one row per index row (if writeChecksums is set)
+	};
+	/// Events accumulated by the writer when eventsPerBatch > 1
+	struct PendingBatch
+	{
+		std::vector<uint64_t> headers;                                                ///< Flattened "event_headers" table, one row per event in arrival order
+		std::unordered_map<artdaq::Fragment::sequence_id_t, size_t> eventIndex;      ///< Row of each event in the headers table
+		std::map<std::string, BatchTypeBuffer> types;                                 ///< Fragment data, per type group name
+	};
+	/// One event unpacked from a batch group by the reader
+	struct BatchedEvent
+	{
+		std::vector<std::pair<std::string, artdaq::Fragment>> fragments;  ///< Fragments, with the name of the type group they were stored in
+	};
+	PendingBatch pendingBatch_;
+	std::deque<BatchedEvent> batchedEvents_;
+	std::unordered_map<artdaq::Fragment::sequence_id_t, BatchHeaderRow> batchHeaders_;
+	std::string cachedBatchName_;
+	std::unique_ptr<std::unordered_map<artdaq::Fragment::sequence_id_t, std::string>> batchOfEvent_;  ///< Batch group of each batched event, built on first use
+	std::deque<BatchedEvent> cachedBatch_;
+
+	std::unique_ptr<HighFiveTimeIndex> timeIndex_;
+	std::unique_ptr<std::vector<FragmentTimeIndexEntry>> timeIndexEntries_;
+
+	/**
+	 * Returns the Fragments vector that a Fragment read from the given type group should be placed in. The last
+	 * argument is the assembled Fragment for ContainerFragments, and nullptr for Fragments which are about to be read.
+	 */
+	using FragmentSink = std::function<artdaq::Fragments&(std::string const& type_group_name, artdaq::Fragment::type_t type, artdaq::Fragment const* container)>;
 
-	void writeFragment_(HighFive::Group& group, artdaq::Fragment const& frag);
-	artdaq::FragmentPtr readFragment_(HighFive::DataSet const& dataset);
+	void readNextEvent_(FragmentSink const& sink);
+	void readEventGroup_(HighFive::Group const& event_group, FragmentSink const& sink);
+	size_t batchEventIndex_(artdaq::Fragment::sequence_id_t seqID);
+	void insertBatched_(artdaq::Fragment const& frag);
+	void flushBatch_();
+	void readBatch_(HighFive::Group const& batch_group, std::deque<BatchedEvent>& events);
+	std::string findBatchGroup_(artdaq::Fragment::sequence_id_t seqID);
+	void loadBatchMap_();
+	std::vector<uint64_t> readBatchHeaders_(HighFive::Group const& batch_group);
+	std::vector<uint64_t> readBatchIndex_(HighFive::Group const& type_group);
+	void scanBatch_(HighFive::Group const& batch_group, std::vector<FragmentDatasetEventSummary>& output);
+	void writeFragment_(std::string const& groupPath, artdaq::Fragment const& frag);
+	void writeContainerBlock_(std::string const& groupPath, artdaq::RawDataType const* block);
+	HighFive::DataSet writeFragmentData_(HighFive::Group& group, std::string const& datasetName, artdaq::detail::RawFragmentHeader const& hdr, artdaq::RawDataType const* data, size_t dataWords);
+	void writePackedContainer_(HighFive::Group& containerGroup, artdaq::Fragment const& frag, artdaq::ContainerFragment const& cf);
+	std::string uniqueDatasetName_(std::string const& groupPath, artdaq::Fragment::fragment_id_t fragID);
+	void readFragment_(HighFive::DataSet const& dataset, artdaq::Fragments& output);
+	artdaq::detail::RawFragmentHeader readFragmentHeader_(HighFive::DataSet const& dataset, size_t& fragSize);
+	artdaq::Fragment readContainerBlocks_(HighFive::Group const& container_group);
 };
 }  // namespace hdf5
 }  // namespace artdaq
 
 artdaq::hdf5::HighFiveGroupedDataset::HighFiveGroupedDataset(fhicl::ParameterSet const& ps)
-    : FragmentDataset(ps, ps.get<std::string>("mode", "write")), file_(nullptr), eventIndex_(0)
+    : FragmentDataset(ps, ps.get<std::string>("mode", "write")), file_(nullptr), registry_(nullptr), eventIndex_(0), packContainers_(false), eventsPerBatch_(ps.get<size_t>("eventsPerBatch", 1))
 {
 	TLOG(TLVL_DEBUG) << "HighFiveGroupedDataset CONSTRUCTOR BEGIN";
-	if (mode_ == FragmentDatasetMode::Read)
+	auto containerWriteMode = ps.get<std::string>("containerWriteMode", "blocks");
+	if (containerWriteMode == "packed")
 	{
-		file_ = std::make_unique<HighFive::File>(ps.get<std::string>("fileName"), HighFive::File::ReadOnly);
+		packContainers_ = true;
 	}
-	else
+	else if (containerWriteMode != "blocks")
 	{
-		file_ = std::make_unique<HighFive::File>(ps.get<std::string>("fileName"), HighFive::File::OpenOrCreate | HighFive::File::Truncate);
+		TLOG(TLVL_WARNING) << "Unknown containerWriteMode " << containerWriteMode << ", using \"blocks\"";
+	}
+	HighFiveFileProfile fileProfile(ps);
+	file_ = fileProfile.openFile(ps.get<std::string>("fileName"), mode_);
+	if (mode_ == FragmentDatasetMode::Write)
+	{
+		fileProfile.applyTo(fragmentCProps_);
+		coreSpill_ = HighFiveCoreSpill(*file_, fileProfile.coreSpillSize());
+		registry_ = std::make_unique<HighFiveGroupRegistry>(*file_, ps.get<size_t>("openEventGroups", 4));
+		if (ps.get<bool>("writeTimeIndex", true))
+		{
+			HighFive::DataSetCreateProps timeIndexCProps;
+			fileProfile.applyTo(timeIndexCProps);
+			timeIndex_ = HighFiveTimeIndex::create(*file_, 128, timeIndexCProps);
+			timeIndex_->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+			timeIndex_->setExtentGrowth(fileProfile.extentGrowthFactor());
+		}
 	}
 
 	TLOG(TLVL_DEBUG) << "HighFiveGroupedDataset CONSTRUCTOR END";
@@ -109,18 +267,35 @@ artdaq::hdf5::HighFiveGroupedDataset::HighFiveGroupedDataset(fhicl::ParameterSet
 artdaq::hdf5::HighFiveGroupedDataset::~HighFiveGroupedDataset() noexcept
 {
 	TLOG(TLVL_DEBUG) << "~HighFiveGroupedDataset Begin/End ";
+	if (mode_ == FragmentDatasetMode::Write && eventsPerBatch_ > 1)
+	{
+		try
+		{
+			flushBatch_();
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG(TLVL_ERROR) << "~HighFiveGroupedDataset: Error writing final batch of " << pendingBatch_.eventIndex.size() << " events: " << ex.what();
+		}
+	}
 	//	file_->flush();
 }
 
 void artdaq::hdf5::HighFiveGroupedDataset::insertOne(artdaq::Fragment const& frag)
 {
 	TLOG(TLVL_TRACE) << "insertOne BEGIN";
-	if (!file_->exist(std::to_string(frag.sequenceID())))
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertOne));
+	if (timeIndex_)
+	{
+		timeIndex_->write(makeTimeIndexEntry_(frag));
+	}
+	if (eventsPerBatch_ > 1)
 	{
-		TLOG(TLVL_INSERTONE) << "insertOne: Creating group for sequence ID " << frag.sequenceID();
-		file_->createGroup(std::to_string(frag.sequenceID()));
+		insertBatched_(frag);
+		TLOG(TLVL_TRACE) << "insertOne END";
+		return;
 	}
-	auto eventGroup = file_->getGroup(std::to_string(frag.sequenceID()));
+	auto eventPath = std::to_string(frag.sequenceID());
 
 	if (frag.type() == Fragment::ContainerFragmentType)
 	{
@@ -129,65 +304,54 @@ void artdaq::hdf5::HighFiveGroupedDataset::insertOne(artdaq::Fragment const& fra
 		if (cf.block_count() > 0)
 		{
 			TLOG(TLVL_INSERTONE) << "insertOne: Getting Fragment type name";
-			auto fragPtr = cf.at(0);
-			auto typeName = nameHelper_->GetInstanceNameForFragment(*fragPtr).second;
+			auto typePath = eventPath + "/" + getInstanceNameForType_(cf.fragment_type());
 
-			if (!eventGroup.exist(typeName))
+			TLOG(TLVL_INSERTONE) << "insertOne: Creating group and setting attributes";
+			auto containerPath = typePath + "/Container_" + std::to_string(frag.fragmentID());
+			auto& containerGroup = [&]() -> HighFive::Group& {
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+				return registry_->getGroup(containerPath);
+			}();
 			{
-				TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-				eventGroup.createGroup(typeName);
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
+				containerGroup.createAttribute("version", frag.version());
+				containerGroup.createAttribute("type", frag.type());
+				containerGroup.createAttribute("sequence_id", frag.sequenceID());
+				containerGroup.createAttribute("fragment_id", frag.fragmentID());
+				containerGroup.createAttribute("timestamp", frag.timestamp());
+
+				containerGroup.createAttribute("container_block_count", cf.block_count());
+				containerGroup.createAttribute("container_fragment_type", cf.fragment_type());
+				containerGroup.createAttribute("container_version", cf.metadata()->version);
+				containerGroup.createAttribute("container_missing_data", cf.missing_data());
 			}
 
-			TLOG(TLVL_INSERTONE) << "insertOne: Creating group and setting attributes";
-			auto typeGroup = eventGroup.getGroup(typeName);
-			auto containerGroup = typeGroup.createGroup("Container_" + std::to_string(frag.fragmentID()));
-			containerGroup.createAttribute("version", frag.version());
-			containerGroup.createAttribute("type", frag.type());
-			containerGroup.createAttribute("sequence_id", frag.sequenceID());
-			containerGroup.createAttribute("fragment_id", frag.fragmentID());
-			containerGroup.createAttribute("timestamp", frag.timestamp());
-
-			containerGroup.createAttribute("container_block_count", cf.block_count());
-			containerGroup.createAttribute("container_fragment_type", cf.fragment_type());
-			containerGroup.createAttribute("container_version", cf.metadata()->version);
-			containerGroup.createAttribute("container_missing_data", cf.missing_data());
-
-			TLOG(TLVL_INSERTONE) << "insertOne: Writing Container contained Fragments";
-			for (size_t ii = 0; ii < cf.block_count(); ++ii)
+			if (packContainers_)
 			{
-				if (ii != 0)
+				TLOG(TLVL_INSERTONE) << "insertOne: Writing packed Container payload";
+				writePackedContainer_(containerGroup, frag, cf);
+			}
+			else
+			{
+				TLOG(TLVL_INSERTONE) << "insertOne: Writing Container contained Fragments";
+				// Blocks are written directly from the Container's buffer, without materializing a Fragment for each
+				auto blocksBegin = reinterpret_cast<uint8_t const*>(cf.dataBegin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+				for (size_t ii = 0; ii < cf.block_count(); ++ii)
 				{
-					fragPtr = cf.at(ii);
+					writeContainerBlock_(containerPath, reinterpret_cast<artdaq::RawDataType const*>(blocksBegin + cf.fragmentIndex(ii)));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
 				}
-				writeFragment_(containerGroup, *fragPtr);
 			}
 		}
 		else
 		{
 			TLOG(TLVL_INSERTONE) << "insertOne: Writing Empty Container Fragment as standard Fragment";
-			auto typeName = nameHelper_->GetInstanceNameForFragment(frag).second;
-			if (!eventGroup.exist(typeName))
-			{
-				TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-				eventGroup.createGroup(typeName);
-			}
-			auto typeGroup = eventGroup.getGroup(typeName);
-
-			writeFragment_(typeGroup, frag);
+			writeFragment_(eventPath + "/" + getInstanceName_(frag), frag);
 		}
 	}
 	else
 	{
 		TLOG(TLVL_INSERTONE) << "insertOne: Writing non-Container Fragment";
-		auto typeName = nameHelper_->GetInstanceNameForFragment(frag).second;
-		if (!eventGroup.exist(typeName))
-		{
-			TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-			eventGroup.createGroup(typeName);
-		}
-		auto typeGroup = eventGroup.getGroup(typeName);
-
-		writeFragment_(typeGroup, frag);
+		writeFragment_(eventPath + "/" + getInstanceName_(frag), frag);
 	}
 	TLOG(TLVL_TRACE) << "insertOne END";
 }
@@ -202,12 +366,27 @@ void artdaq::hdf5::HighFiveGroupedDataset::insertMany(artdaq::Fragments const& f
 void artdaq::hdf5::HighFiveGroupedDataset::insertHeader(artdaq::detail::RawEventHeader const& hdr)
 {
 	TLOG(TLVL_TRACE) << "insertHeader BEGIN";
-	if (!file_->exist(std::to_string(hdr.sequence_id)))
+	coreSpill_.check();
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertHeader));
+	if (eventsPerBatch_ > 1)
 	{
-		TLOG(TLVL_INSERTHEADER) << "insertHeader: Creating group for event " << hdr.sequence_id;
-		file_->createGroup(std::to_string(hdr.sequence_id));
+		TLOG(TLVL_INSERTHEADER) << "insertHeader: Adding header for event " << hdr.sequence_id << " to batch";
+		auto row = pendingBatch_.headers.begin() + batchEventIndex_(hdr.sequence_id) * BatchHeaderColumns;
+		row[BH_RunID] = hdr.run_id;
+		row[BH_SubrunID] = hdr.subrun_id;
+		row[BH_EventID] = hdr.event_id;
+		row[BH_Timestamp] = hdr.timestamp;
+		row[BH_IsComplete] = hdr.is_complete ? 1 : 0;
+		row[BH_HasHeader] = 1;
+		TLOG(TLVL_TRACE) << "insertHeader END";
+		return;
 	}
-	auto eventGroup = file_->getGroup(std::to_string(hdr.sequence_id));
+	TLOG(TLVL_INSERTHEADER) << "insertHeader: Getting group for event " << hdr.sequence_id;
+	auto& eventGroup = [&]() -> HighFive::Group& {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+		return registry_->getGroup(std::to_string(hdr.sequence_id));
+	}();
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
 	eventGroup.createAttribute("run_id", hdr.run_id);
 	eventGroup.createAttribute("subrun_id", hdr.subrun_id);
 	eventGroup.createAttribute("event_id", hdr.event_id);
@@ -221,115 +400,170 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 	TLOG(TLVL_DEBUG) << "readNextEvent BEGIN";
 	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
 
-	TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Finding next event group in file";
-	auto groupNames = file_->listObjectNames();
-	while (eventIndex_ < groupNames.size() && file_->getObjectType(groupNames[eventIndex_]) != HighFive::ObjectType::Group)
+	readNextEvent_([&](std::string const& /*type_group_name*/, artdaq::Fragment::type_t type, artdaq::Fragment const* /*container*/) -> artdaq::Fragments& {
+		if (output.count(type) == 0u)
+		{
+			output[type] = makeFragments_(type);
+		}
+		return *output[type];
+	});
+
+	recordFragmentCounts_(output);
+
+	TLOG(TLVL_DEBUG)
+	    << "readNextEvent END output.size() = " << output.size();
+	return output;
+}
+
+std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveGroupedDataset::readNextEventByInstanceName()
+{
+	TLOG(TLVL_DEBUG) << "readNextEventByInstanceName BEGIN";
+	std::unordered_map<std::string, std::unique_ptr<artdaq::Fragments>> output;
+
+	readNextEvent_([&](std::string const& type_group_name, artdaq::Fragment::type_t type, artdaq::Fragment const* container) -> artdaq::Fragments& {
+		auto const& label = container != nullptr ? getInstanceName_(*container) : type_group_name;
+		if (output.count(label) == 0u)
+		{
+			output[label] = makeFragments_(type);
+		}
+		return *output[label];
+	});
+
+	recordFragmentCounts_(output);
+
+	TLOG(TLVL_DEBUG)
+	    << "readNextEventByInstanceName END output.size() = " << output.size();
+	return output;
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::readNextEvent_(FragmentSink const& sink)
+{
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
+	if (batchedEvents_.empty())
 	{
-		eventIndex_++;
+		TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Finding next event group in file";
+		auto groupNames = file_->listObjectNames();
+		while (eventIndex_ < groupNames.size() && file_->getObjectType(groupNames[eventIndex_]) != HighFive::ObjectType::Group)
+		{
+			eventIndex_++;
+		}
+
+		if (groupNames.size() <= eventIndex_)
+		{
+			TLOG(TLVL_INFO) << "readNextEvent: No more events in file!";
+			++eventIndex_;
+			return;
+		}
+
+		TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Getting event group " << groupNames[eventIndex_];
+		auto event_group = file_->getGroup(groupNames[eventIndex_]);
+		if (!event_group.hasAttribute("batch_event_count"))
+		{
+			readEventGroup_(event_group, sink);
+			++eventIndex_;
+			return;
+		}
+		readBatch_(event_group, batchedEvents_);
 	}
 
-	if (groupNames.size() <= eventIndex_)
+	if (!batchedEvents_.empty())
 	{
-		TLOG(TLVL_INFO) << "readNextEvent: No more events in file!";
+		TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Returning event from batch, " << batchedEvents_.size() - 1 << " events remaining in batch";
+		for (auto& entry : batchedEvents_.front().fragments)
+		{
+			auto& frag = entry.second;
+			auto container = frag.type() == artdaq::Fragment::ContainerFragmentType ? &frag : nullptr;
+			sink(entry.first, frag.type(), container).emplace_back(std::move(frag));
+		}
+		batchedEvents_.pop_front();
 	}
-	else
+	if (batchedEvents_.empty())
 	{
-		TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Getting event group " << groupNames[eventIndex_];
-		auto event_group = file_->getGroup(groupNames[eventIndex_]);
-		auto fragment_type_names = event_group.listObjectNames();
+		++eventIndex_;
+	}
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::readEventGroup_(HighFive::Group const& event_group, FragmentSink const& sink)
+{
+	TLOG(TLVL_TRACE) << "readEventGroup_ BEGIN";
+	auto fragment_type_names = event_group.listObjectNames();
 
-		for (auto& fragment_type : fragment_type_names)
+	for (auto& fragment_type : fragment_type_names)
+	{
+		if (event_group.getObjectType(fragment_type) != HighFive::ObjectType::Group)
 		{
-			if (event_group.getObjectType(fragment_type) != HighFive::ObjectType::Group)
-			{
-				continue;
-			}
-			TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading Fragment type " << fragment_type;
-			auto type_group = event_group.getGroup(fragment_type);
-			auto fragment_names = type_group.listObjectNames();
+			continue;
+		}
+		TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading Fragment type " << fragment_type;
+		auto type_group = event_group.getGroup(fragment_type);
+		auto fragment_names = type_group.listObjectNames();
 
-			for (auto& fragment_name : fragment_names)
+		for (auto& fragment_name : fragment_names)
+		{
+			TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading Fragment " << fragment_name;
+			auto node_type = type_group.getObjectType(fragment_name);
+			if (node_type == HighFive::ObjectType::Group)
 			{
-				TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading Fragment " << fragment_name;
-				auto node_type = type_group.getObjectType(fragment_name);
-				if (node_type == HighFive::ObjectType::Group)
+				TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Fragment " << fragment_name << " is a Container";
+				auto container_group = type_group.getGroup(fragment_name);
+				if (container_group.hasAttribute("container_layout"))
 				{
-					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Fragment " << fragment_name << " is a Container";
-					auto container_group = type_group.getGroup(fragment_name);
-					Fragment::type_t type;
-					container_group.getAttribute("type").read<Fragment::type_t>(type);
-					Fragment::sequence_id_t seqID;
-					container_group.getAttribute("sequence_id").read(seqID);
-					Fragment::timestamp_t timestamp;
-					container_group.getAttribute("timestamp").read(timestamp);
-					Fragment::fragment_id_t fragID;
-					container_group.getAttribute("fragment_id").read(fragID);
-					if (output.count(type) == 0u)
+					std::string layout;
+					container_group.getAttribute("container_layout").read(layout);
+					if (layout == "packed")
 					{
-						output[type] = std::make_unique<Fragments>();
-					}
-					output[type]->emplace_back(seqID, fragID);
-					output[type]->back().setTimestamp(timestamp);
-					output[type]->back().setSystemType(type);
-
-					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Creating ContainerFragmentLoader for reading Container Fragments";
-					ContainerFragmentLoader cfl(output[type]->back());
-
-					Fragment::type_t container_fragment_type;
-					int missing_data;
-					container_group.getAttribute("container_fragment_type").read(container_fragment_type);
-					container_group.getAttribute("container_missing_data").read(missing_data);
-
-					cfl.set_fragment_type(container_fragment_type);
-					cfl.set_missing_data(missing_data != 0);
-
-					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading ContainerFragment Fragments";
-					auto fragments = container_group.listObjectNames();
-					for (auto& fragname : fragments)
-					{
-						if (container_group.getObjectType(fragname) != HighFive::ObjectType::Dataset)
-						{
-							continue;
-						}
-						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
-						auto frag = readFragment_(container_group.getDataSet(fragname, fragmentAProps_));
-						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
-
-						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling addFragment BEGIN";
-						cfl.addFragment(frag);
-						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: addFragment END";
+						TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading packed Container payload";
+						artdaq::Fragments packedBuffer;
+						readFragment_(container_group.getDataSet("payload", fragmentAProps_), packedBuffer);
+						auto& containerFrag = packedBuffer.back();
+						sink(fragment_type, containerFrag.type(), &containerFrag).emplace_back(std::move(containerFrag));
+						continue;
 					}
 				}
-				else if (node_type == HighFive::ObjectType::Dataset)
-				{
-					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
-					auto frag = readFragment_(type_group.getDataSet(fragment_name, fragmentAProps_));
-					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
+				TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading ContainerFragment Fragments";
+				auto containerFrag = readContainerBlocks_(container_group);
+				sink(fragment_type, containerFrag.type(), &containerFrag).emplace_back(std::move(containerFrag));
+			}
+			else if (node_type == HighFive::ObjectType::Dataset)
+			{
+				auto dataset = type_group.getDataSet(fragment_name, fragmentAProps_);
+				Fragment::type_t type;
+				dataset.getAttribute("type").read(type);
 
-					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Adding Fragment to output";
-					if (output.count(frag->type()) == 0u)
-					{
-						output[frag->type()] = std::make_unique<artdaq::Fragments>();
-					}
-					output[frag->type()]->push_back(*frag.release());
-				}
+				TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
+				readFragment_(dataset, sink(fragment_type, type, nullptr));
+				TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
 			}
 		}
 	}
-	++eventIndex_;
-
-	TLOG(TLVL_DEBUG)
-	    << "readNextEvent END output.size() = " << output.size();
-	return output;
+	TLOG(TLVL_TRACE) << "readEventGroup_ END";
 }
 
 std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveGroupedDataset::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
 {
 	TLOG(TLVL_TRACE) << "GetEventHeader BEGIN seqID=" << seqID;
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::GetEventHeader));
 	if (!file_->exist(std::to_string(seqID)))
 	{
-		TLOG(TLVL_ERROR) << "Sequence ID " << seqID << " not found in input file!";
-		return nullptr;
+		auto batchHeader = batchHeaders_.find(seqID);
+		if (batchHeader == batchHeaders_.end() && !batchOfEvent_)
+		{
+			TLOG(TLVL_GETEVENTHEADER) << "Sequence ID " << seqID << " not in a batch which has been read, reading all batch headers";
+			loadBatchMap_();
+			batchHeader = batchHeaders_.find(seqID);
+		}
+		if (batchHeader == batchHeaders_.end() || batchHeader->second[BH_HasHeader] == 0)
+		{
+			TLOG(TLVL_ERROR) << "Sequence ID " << seqID << " not found in input file!";
+			return nullptr;
+		}
+
+		auto const& row = batchHeader->second;
+		TLOG(TLVL_GETEVENTHEADER) << "Creating EventHeader from batch with runID " << row[BH_RunID] << ", subrunID " << row[BH_SubrunID] << ", eventID " << row[BH_EventID] << " (seqID " << seqID << ")";
+		artdaq::detail::RawEventHeader hdr(static_cast<uint32_t>(row[BH_RunID]), static_cast<uint32_t>(row[BH_SubrunID]), static_cast<uint32_t>(row[BH_EventID]), seqID, row[BH_Timestamp]);
+		hdr.is_complete = row[BH_IsComplete] != 0;
+		TLOG(TLVL_TRACE) << "GetEventHeader END";
+		return std::make_unique<artdaq::detail::RawEventHeader>(hdr);
 	}
 	auto seqIDGroup = file_->getGroup(std::to_string(seqID));
 
@@ -348,57 +582,235 @@ std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveGroupedDat
 	return std::make_unique<artdaq::detail::RawEventHeader>(hdr);
 }
 
-void artdaq::hdf5::HighFiveGroupedDataset::writeFragment_(HighFive::Group& group, artdaq::Fragment const& frag)
+std::vector<artdaq::hdf5::FragmentDatasetEventSummary> artdaq::hdf5::HighFiveGroupedDataset::scanEvents()
+{
+	TLOG(TLVL_TRACE) << "scanEvents BEGIN";
+	std::vector<FragmentDatasetEventSummary> output;
+
+	auto storedFragmentBytes = [](HighFive::DataSet const& dataset) {
+		size_t fragSize;
+		dataset.getAttribute("fragment_data_size").read(fragSize);
+		return (fragSize + artdaq::detail::RawFragmentHeader::num_words()) * sizeof(artdaq::RawDataType);
+	};
+
+	auto groupNames = file_->listObjectNames();
+	for (auto& groupName : groupNames)
+	{
+		if (file_->getObjectType(groupName) != HighFive::ObjectType::Group)
+		{
+			continue;
+		}
+		TLOG(TLVL_SCANEVENTS) << "scanEvents: Scanning event group " << groupName;
+		auto event_group = file_->getGroup(groupName);
+		if (event_group.hasAttribute("batch_event_count"))
+		{
+			scanBatch_(event_group, output);
+			continue;
+		}
+
+		FragmentDatasetEventSummary evt;
+		evt.sequence_id = std::stoull(groupName);
+		if (event_group.hasAttribute("run_id"))
+		{
+			event_group.getAttribute("run_id").read(evt.run_id);
+			event_group.getAttribute("subrun_id").read(evt.subrun_id);
+			event_group.getAttribute("event_id").read(evt.event_id);
+			event_group.getAttribute("timestamp").read(evt.timestamp);
+			event_group.getAttribute("is_complete").read(evt.is_complete);
+			evt.has_header = true;
+		}
+
+		for (auto& fragment_type : event_group.listObjectNames())
+		{
+			if (event_group.getObjectType(fragment_type) != HighFive::ObjectType::Group)
+			{
+				continue;
+			}
+			auto type_group = event_group.getGroup(fragment_type);
+
+			for (auto& fragment_name : type_group.listObjectNames())
+			{
+				auto node_type = type_group.getObjectType(fragment_name);
+				if (node_type == HighFive::ObjectType::Group)
+				{
+					auto container_group = type_group.getGroup(fragment_name);
+					Fragment::type_t type;
+					container_group.getAttribute("type").read(type);
+
+					auto& typeSummary = evt.fragment_types[type];
+					typeSummary.count++;
+					for (auto& fragname : container_group.listObjectNames())
+					{
+						if (container_group.getObjectType(fragname) != HighFive::ObjectType::Dataset || fragname == "block_index")
+						{
+							continue;
+						}
+						typeSummary.bytes += storedFragmentBytes(container_group.getDataSet(fragname));
+					}
+				}
+				else if (node_type == HighFive::ObjectType::Dataset)
+				{
+					auto dataset = type_group.getDataSet(fragment_name);
+					Fragment::type_t type;
+					dataset.getAttribute("type").read(type);
+
+					auto& typeSummary = evt.fragment_types[type];
+					typeSummary.count++;
+					typeSummary.bytes += storedFragmentBytes(dataset);
+				}
+			}
+		}
+		output.push_back(std::move(evt));
+	}
+
+	std::sort(output.begin(), output.end(), [](FragmentDatasetEventSummary const& a, FragmentDatasetEventSummary const& b) { return a.sequence_id < b.sequence_id; });
+
+	TLOG(TLVL_TRACE) << "scanEvents END output.size() = " << output.size();
+	return output;
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::writeFragment_(std::string const& groupPath, artdaq::Fragment const& frag)
 {
 	TLOG(TLVL_TRACE) << "writeFragment_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteFragment));
+
+	auto datasetName = uniqueDatasetName_(groupPath, frag.fragmentID());
+	writeFragmentData_(registry_->getGroup(groupPath), datasetName, frag.fragmentHeader(), frag.headerBegin() + frag.headerSizeWords(), frag.size() - frag.headerSizeWords());
+	TLOG(TLVL_TRACE) << "writeFragment_ END";
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::writeContainerBlock_(std::string const& groupPath, artdaq::RawDataType const* block)
+{
+	TLOG(TLVL_TRACE) << "writeContainerBlock_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteFragment));
+
+	artdaq::detail::RawFragmentHeader hdr;
+	memcpy(&hdr, block, sizeof(hdr));
+	auto headerWords = artdaq::detail::RawFragmentHeader::num_words();
+	auto datasetName = uniqueDatasetName_(groupPath, hdr.fragment_id);
+	writeFragmentData_(registry_->getGroup(groupPath), datasetName, hdr, block + headerWords, hdr.word_count - headerWords);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	TLOG(TLVL_TRACE) << "writeContainerBlock_ END";
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::writePackedContainer_(HighFive::Group& containerGroup, artdaq::Fragment const& frag, artdaq::ContainerFragment const& cf)
+{
+	TLOG(TLVL_TRACE) << "writePackedContainer_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteFragment));
+
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
+		containerGroup.createAttribute("container_layout", std::string("packed"));
+	}
+
+	// The payload dataset holds the Container's metadata and payload, exactly as they are laid out in memory
+	writeFragmentData_(containerGroup, "payload", frag.fragmentHeader(), frag.headerBegin() + frag.headerSizeWords(), frag.size() - frag.headerSizeWords());
 
-	auto datasetNameBase = "Fragment_" + std::to_string(frag.fragmentID());
-	auto datasetName = datasetNameBase + ";1";
-	int counter = 2;
-	while (group.exist(datasetName))
+	TLOG(TLVL_WRITEFRAGMENT) << "writePackedContainer_: Writing block index";
+	std::vector<uint64_t> blockIndex(cf.block_count());
+	for (size_t ii = 0; ii < cf.block_count(); ++ii)
 	{
-		TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Duplicate Fragment ID " << frag.fragmentID() << " detected. If this is a ContainerFragment, this is expected, otherwise check configuration!";
-		datasetName = datasetNameBase + ";" + std::to_string(counter);
-		counter++;
+		blockIndex[ii] = cf.fragmentIndex(ii) + cf.fragSize(ii);
 	}
+	auto indexDset = [&] {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+		return containerGroup.createDataSet<uint64_t>("block_index", HighFive::DataSpace({blockIndex.size(), 1}));
+	}();
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+	indexDset.write(blockIndex.data());
+	TLOG(TLVL_TRACE) << "writePackedContainer_ END";
+}
 
+std::string artdaq::hdf5::HighFiveGroupedDataset::uniqueDatasetName_(std::string const& groupPath, artdaq::Fragment::fragment_id_t fragID)
+{
+	return registry_->uniqueName(groupPath, "Fragment_" + std::to_string(fragID), [&](std::string const& base, size_t index) {
+		if (index > 0)
+		{
+			TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Duplicate Fragment ID " << fragID << " detected. If this is a ContainerFragment, this is expected, otherwise check configuration!";
+		}
+		return base + ";" + std::to_string(index + 1);
+	});
+}
+
+HighFive::DataSet artdaq::hdf5::HighFiveGroupedDataset::writeFragmentData_(HighFive::Group& group, std::string const& datasetName, artdaq::detail::RawFragmentHeader const& hdr, artdaq::RawDataType const* data, size_t dataWords)
+{
 	TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Creating DataSpace";
-	HighFive::DataSpace fragmentSpace = HighFive::DataSpace({frag.size() - frag.headerSizeWords(), 1});
-	auto fragDset = group.createDataSet<RawDataType>(datasetName, fragmentSpace, fragmentCProps_, fragmentAProps_);
+	HighFive::DataSpace fragmentSpace = HighFive::DataSpace({dataWords, 1});
+	auto fragDset = [&] {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+		return group.createDataSet<RawDataType>(datasetName, fragmentSpace, fragmentCProps_, fragmentAProps_);
+	}();
 
 	TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Creating Attributes from Fragment Header";
-	auto fragHdr = frag.fragmentHeader();
-	fragDset.createAttribute("word_count", fragHdr.word_count);
-	fragDset.createAttribute("fragment_data_size", frag.size() - frag.headerSizeWords());
-	fragDset.createAttribute("version", fragHdr.version);
-	fragDset.createAttribute("type", fragHdr.type);
-	fragDset.createAttribute("metadata_word_count", fragHdr.metadata_word_count);
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
+		fragDset.createAttribute("word_count", hdr.word_count);
+		fragDset.createAttribute("fragment_data_size", dataWords);
+		fragDset.createAttribute("version", hdr.version);
+		fragDset.createAttribute("type", hdr.type);
+		fragDset.createAttribute("metadata_word_count", hdr.metadata_word_count);
+
+		fragDset.createAttribute("sequence_id", hdr.sequence_id);
+		fragDset.createAttribute("fragment_id", hdr.fragment_id);
 
-	fragDset.createAttribute("sequence_id", fragHdr.sequence_id);
-	fragDset.createAttribute("fragment_id", fragHdr.fragment_id);
+		fragDset.createAttribute("timestamp", hdr.timestamp);
 
-	fragDset.createAttribute("timestamp", fragHdr.timestamp);
+		fragDset.createAttribute("valid", hdr.valid);
+		fragDset.createAttribute("complete", hdr.complete);
+		fragDset.createAttribute("atime_ns", hdr.atime_ns);
+		fragDset.createAttribute("atime_s", hdr.atime_s);
 
-	fragDset.createAttribute("valid", fragHdr.valid);
-	fragDset.createAttribute("complete", fragHdr.complete);
-	fragDset.createAttribute("atime_ns", fragHdr.atime_ns);
-	fragDset.createAttribute("atime_s", fragHdr.atime_s);
+		if (checksumsEnabled_())
+		{
+			fragDset.createAttribute("checksum", fragmentChecksum(hdr, data, dataWords));
+		}
+	}
 
 	TLOG(TLVL_WRITEFRAGMENT_V) << "writeFragment_: Writing Fragment payload START";
-	fragDset.write(frag.headerBegin() + frag.headerSizeWords());
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+		fragDset.write(data);
+	}
 	TLOG(TLVL_WRITEFRAGMENT_V) << "writeFragment_: Writing Fragment payload DONE";
-	TLOG(TLVL_TRACE) << "writeFragment_ END";
+	return fragDset;
 }
 
-artdaq::FragmentPtr artdaq::hdf5::HighFiveGroupedDataset::readFragment_(HighFive::DataSet const& dataset)
+void artdaq::hdf5::HighFiveGroupedDataset::readFragment_(HighFive::DataSet const& dataset, artdaq::Fragments& output)
 {
 	TLOG(TLVL_TRACE) << "readFragment_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadFragment));
 	size_t fragSize;
+	auto fragHdr = readFragmentHeader_(dataset, fragSize);
+
+	// Construct the Fragment in place in the output vector, so that its payload is never copied
+	output.emplace_back(fragSize);
+	auto& frag = output.back();
+
+	TLOG(TLVL_READFRAGMENT) << "readFragment_: Copying header into Fragment";
+	memcpy(frag.headerAddress(), &fragHdr, sizeof(fragHdr));
+
+	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment BEGIN";
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+		dataset.read(frag.headerAddress() + frag.headerSizeWords());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment END";
+
+	if (verifyingChecksums_() && dataset.hasAttribute("checksum"))
+	{
+		uint32_t checksum;
+		dataset.getAttribute("checksum").read(checksum);
+		verifyChecksum_(frag, checksum);
+	}
+
+	TLOG(TLVL_TRACE) << "readFragment_ END";
+}
+
+artdaq::detail::RawFragmentHeader artdaq::hdf5::HighFiveGroupedDataset::readFragmentHeader_(HighFive::DataSet const& dataset, size_t& fragSize)
+{
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
 	dataset.getAttribute("fragment_data_size").read(fragSize);
 	TLOG(TLVL_READFRAGMENT) << "readFragment_: Fragment size " << fragSize << ", dataset size " << dataset.getDimensions()[0];
 
-	artdaq::FragmentPtr frag(new Fragment(fragSize));
-
 	artdaq::Fragment::type_t type;
 	size_t metadata_size;
 	artdaq::Fragment::sequence_id_t seqID;
@@ -420,7 +832,9 @@ artdaq::FragmentPtr artdaq::hdf5::HighFiveGroupedDataset::readFragment_(HighFive
 	dataset.getAttribute("atime_ns").read(atime_ns);
 	dataset.getAttribute("atime_s").read(atime_s);
 
-	auto fragHdr = frag->fragmentHeader();
+	artdaq::detail::RawFragmentHeader fragHdr{};
+	fragHdr.word_count = artdaq::detail::RawFragmentHeader::num_words() + fragSize;
+	fragHdr.version = artdaq::detail::RawFragmentHeader::CurrentVersion;
 	fragHdr.type = type;
 	fragHdr.metadata_word_count = metadata_size;
 
@@ -433,16 +847,406 @@ artdaq::FragmentPtr artdaq::hdf5::HighFiveGroupedDataset::readFragment_(HighFive
 	fragHdr.complete = complete;
 	fragHdr.atime_ns = atime_ns;
 	fragHdr.atime_s = atime_s;
+	return fragHdr;
+}
 
-	TLOG(TLVL_READFRAGMENT) << "readFragment_: Copying header into Fragment";
-	memcpy(frag->headerAddress(), &fragHdr, sizeof(fragHdr));
+artdaq::Fragment artdaq::hdf5::HighFiveGroupedDataset::readContainerBlocks_(HighFive::Group const& container_group)
+{
+	TLOG(TLVL_TRACE) << "readContainerBlocks_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadFragment));
 
-	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment BEGIN";
-	dataset.read(frag->headerAddress() + frag->headerSizeWords());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment END";
+	Fragment::type_t type;
+	Fragment::sequence_id_t seqID;
+	Fragment::timestamp_t timestamp;
+	Fragment::fragment_id_t fragID;
+	Fragment::type_t container_fragment_type;
+	int missing_data;
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+		container_group.getAttribute("type").read<Fragment::type_t>(type);
+		container_group.getAttribute("sequence_id").read(seqID);
+		container_group.getAttribute("timestamp").read(timestamp);
+		container_group.getAttribute("fragment_id").read(fragID);
+		container_group.getAttribute("container_fragment_type").read(container_fragment_type);
+		container_group.getAttribute("container_missing_data").read(missing_data);
+	}
 
-	TLOG(TLVL_TRACE) << "readFragment_ END";
-	return frag;
+	// Read every block's header first, so that the Container can be allocated once at its final size
+	std::vector<HighFive::DataSet> blockDatasets;
+	std::vector<artdaq::detail::RawFragmentHeader> blockHeaders;
+	size_t blockBytes = 0;
+	for (auto& fragname : container_group.listObjectNames())
+	{
+		if (container_group.getObjectType(fragname) != HighFive::ObjectType::Dataset)
+		{
+			continue;
+		}
+		blockDatasets.push_back(container_group.getDataSet(fragname, fragmentAProps_));
+		size_t fragSize;
+		blockHeaders.push_back(readFragmentHeader_(blockDatasets.back(), fragSize));
+		blockBytes += blockHeaders.back().word_count * sizeof(artdaq::RawDataType);
+	}
+
+	// The index holds the end offset of each block, followed by the Container magic word
+	auto blockCount = blockHeaders.size();
+	auto indexWords = ((blockCount + 1) * sizeof(size_t) + sizeof(artdaq::RawDataType) - 1) / sizeof(artdaq::RawDataType);
+
+	ContainerFragment::Metadata metadata{};
+	metadata.block_count = blockCount;
+	metadata.fragment_type = container_fragment_type;
+	metadata.version = ContainerFragment::CURRENT_VERSION;
+	metadata.missing_data = missing_data != 0;
+	metadata.has_index = true;
+	metadata.index_offset = blockBytes;
+
+	TLOG(TLVL_READNEXTEVENT) << "readContainerBlocks_: Allocating Container with " << blockCount << " blocks, " << blockBytes << " bytes of block data";
+	artdaq::Fragment containerFrag(blockBytes / sizeof(artdaq::RawDataType) + indexWords, seqID, fragID, type, metadata, timestamp);
+
+	auto blocksBegin = containerFrag.dataBeginBytes();
+	std::vector<size_t> index(blockCount + 1);
+	size_t offset = 0;
+	for (size_t ii = 0; ii < blockCount; ++ii)
+	{
+		TLOG(TLVL_READNEXTEVENT_V) << "readContainerBlocks_: Reading block " << ii << " at offset " << offset;
+		memcpy(blocksBegin + offset, &blockHeaders[ii], sizeof(artdaq::detail::RawFragmentHeader));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		{
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+			blockDatasets[ii].read(reinterpret_cast<artdaq::RawDataType*>(blocksBegin + offset) + artdaq::detail::RawFragmentHeader::num_words());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+		if (verifyingChecksums_() && blockDatasets[ii].hasAttribute("checksum"))
+		{
+			uint32_t checksum;
+			blockDatasets[ii].getAttribute("checksum").read(checksum);
+			verifyChecksum_(reinterpret_cast<artdaq::RawDataType const*>(blocksBegin + offset), checksum);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+		offset += blockHeaders[ii].word_count * sizeof(artdaq::RawDataType);
+		index[ii] = offset;
+	}
+	index[blockCount] = ContainerFragment::CONTAINER_MAGIC;
+	memcpy(blocksBegin + offset, index.data(), index.size() * sizeof(size_t));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	TLOG(TLVL_TRACE) << "readContainerBlocks_ END";
+	return containerFrag;
+}
+
+size_t artdaq::hdf5::HighFiveGroupedDataset::batchEventIndex_(artdaq::Fragment::sequence_id_t seqID)
+{
+	auto it = pendingBatch_.eventIndex.find(seqID);
+	if (it != pendingBatch_.eventIndex.end())
+	{
+		return it->second;
+	}
+
+	if (pendingBatch_.eventIndex.size() >= eventsPerBatch_)
+	{
+		flushBatch_();
+	}
+	auto index = pendingBatch_.eventIndex.size();
+	TLOG(TLVL_INSERTONE) << "batchEventIndex_: Adding event " << seqID << " to batch as event " << index;
+	pendingBatch_.eventIndex[seqID] = index;
+	pendingBatch_.headers.resize(pendingBatch_.headers.size() + BatchHeaderColumns, 0);
+	pendingBatch_.headers[index * BatchHeaderColumns + BH_SequenceID] = seqID;
+	return index;
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::insertBatched_(artdaq::Fragment const& frag)
+{
+	auto eventIndex = batchEventIndex_(frag.sequenceID());
+	auto& typeBuffer = pendingBatch_.types[getInstanceName_(frag)];
+	auto& data = typeBuffer.data[frag.fragmentID()];
+
+	TLOG(TLVL_INSERTONE) << "insertBatched_: Appending Fragment " << frag.fragmentID() << " of event " << frag.sequenceID() << " at offset " << data.size();
+	typeBuffer.index.insert(typeBuffer.index.end(), {frag.fragmentID(), eventIndex, frag.type(), data.size(), frag.size()});
+	if (checksumsEnabled_())
+	{
+		typeBuffer.checksums.push_back(fragmentChecksum(frag));
+	}
+
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CopyFragment));
+	data.insert(data.end(), frag.headerBegin(), frag.headerBegin() + frag.size());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::flushBatch_()
+{
+	if (pendingBatch_.eventIndex.empty())
+	{
+		return;
+	}
+	TLOG(TLVL_TRACE) << "flushBatch_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteFragment));
+
+	auto eventCount = pendingBatch_.eventIndex.size();
+	auto batchPath = "Batch_" + std::to_string(pendingBatch_.headers[BH_SequenceID]);
+	TLOG(TLVL_WRITEFRAGMENT) << "flushBatch_: Writing " << eventCount << " events to " << batchPath;
+	auto& batchGroup = [&]() -> HighFive::Group& {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+		return registry_->getGroup(batchPath);
+	}();
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
+		batchGroup.createAttribute("batch_event_count", eventCount);
+	}
+	batchOfEvent_.reset();  // Rebuilt with this batch on the next lookup
+
+	auto writeTable = [&](HighFive::Group& group, std::string const& name, std::vector<uint64_t> const& table, size_t columns) {
+		auto dset = [&] {
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+			return group.createDataSet<uint64_t>(name, HighFive::DataSpace({table.size() / columns, columns}));
+		}();
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+		if (!table.empty()) dset.write(table.data());
+	};
+	writeTable(batchGroup, "event_headers", pendingBatch_.headers, BatchHeaderColumns);
+
+	for (auto& type : pendingBatch_.types)
+	{
+		auto& typeGroup = [&]() -> HighFive::Group& {
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+			return registry_->getGroup(batchPath + "/" + type.first);
+		}();
+		for (auto& fragData : type.second.data)
+		{
+			auto fragDset = [&] {
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+				return typeGroup.createDataSet<RawDataType>("Fragment_" + std::to_string(fragData.first), HighFive::DataSpace({fragData.second.size(), 1}), fragmentCProps_, fragmentAProps_);
+			}();
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+			fragDset.write(fragData.second.data());
+		}
+		writeTable(typeGroup, "index", type.second.index, BatchIndexColumns);
+		if (!type.second.checksums.empty())
+		{
+			auto checksumDset = [&] {
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+				return typeGroup.createDataSet<uint32_t>("checksums", HighFive::DataSpace({type.second.checksums.size(), 1}));
+			}();
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+			checksumDset.write(type.second.checksums.data());
+		}
+	}
+
+	pendingBatch_ = PendingBatch();
+	TLOG(TLVL_TRACE) << "flushBatch_ END";
+}
+
+std::vector<uint64_t> artdaq::hdf5::HighFiveGroupedDataset::readBatchHeaders_(HighFive::Group const& batch_group)
+{
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+	auto dset = batch_group.getDataSet("event_headers");
+	std::vector<uint64_t> headers(dset.getDimensions()[0] * BatchHeaderColumns);
+	if (!headers.empty()) dset.read(headers.data());
+
+	for (size_t row = 0; row < headers.size(); row += BatchHeaderColumns)
+	{
+		auto& cached = batchHeaders_[headers[row + BH_SequenceID]];
+		std::copy(headers.begin() + row, headers.begin() + row + BatchHeaderColumns, cached.begin());
+	}
+	return headers;
+}
+
+std::vector<uint64_t> artdaq::hdf5::HighFiveGroupedDataset::readBatchIndex_(HighFive::Group const& type_group)
+{
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+	auto dset = type_group.getDataSet("index");
+	std::vector<uint64_t> index(dset.getDimensions()[0] * BatchIndexColumns);
+	if (!index.empty()) dset.read(index.data());
+	return index;
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::readBatch_(HighFive::Group const& batch_group, std::deque<BatchedEvent>& events)
+{
+	TLOG(TLVL_TRACE) << "readBatch_ BEGIN";
+	auto eventCount = readBatchHeaders_(batch_group).size() / BatchHeaderColumns;
+	TLOG(TLVL_READNEXTEVENT) << "readBatch_: Reading batch of " << eventCount << " events";
+	events.resize(eventCount);
+
+	for (auto& type_name : batch_group.listObjectNames())
+	{
+		if (batch_group.getObjectType(type_name) != HighFive::ObjectType::Group)
+		{
+			continue;
+		}
+		auto type_group = batch_group.getGroup(type_name);
+		auto index = readBatchIndex_(type_group);
+		std::vector<uint32_t> checksums;
+		if (verifyingChecksums_() && type_group.exist("checksums"))
+		{
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+			auto checksumDset = type_group.getDataSet("checksums");
+			checksums.resize(checksumDset.getDimensions()[0]);
+			if (!checksums.empty()) checksumDset.read(checksums.data());
+		}
+
+		// Each concatenated dataset is read once, then the Fragments are copied out of it
+		std::map<artdaq::Fragment::fragment_id_t, std::vector<artdaq::RawDataType>> buffers;
+		for (size_t row = 0; row < index.size(); row += BatchIndexColumns)
+		{
+			auto fragID = static_cast<artdaq::Fragment::fragment_id_t>(index[row + BI_FragmentID]);
+			auto eventIndex = index[row + BI_EventIndex];
+			auto offset = index[row + BI_Offset];
+			auto length = index[row + BI_Length];
+
+			auto bufferIt = buffers.find(fragID);
+			if (bufferIt == buffers.end())
+			{
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+				auto dset = type_group.getDataSet("Fragment_" + std::to_string(fragID), fragmentAProps_);
+				bufferIt = buffers.emplace(fragID, std::vector<artdaq::RawDataType>(dset.getDimensions()[0])).first;
+				dset.read(bufferIt->second.data());
+			}
+			auto const& buffer = bufferIt->second;
+
+			if (eventIndex >= eventCount || length < artdaq::detail::RawFragmentHeader::num_words() || offset + length > buffer.size())
+			{
+				TLOG(TLVL_ERROR) << "readBatch_: Invalid index entry for Fragment " << fragID << " in " << type_name << " (event " << eventIndex << ", offset " << offset << ", length " << length << "), skipping";
+				continue;
+			}
+
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CopyFragment));
+			artdaq::Fragment frag(length - artdaq::detail::RawFragmentHeader::num_words());
+			memcpy(frag.headerAddress(), buffer.data() + offset, length * sizeof(artdaq::RawDataType));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			if (row / BatchIndexColumns < checksums.size())
+			{
+				verifyChecksum_(frag, checksums[row / BatchIndexColumns]);
+			}
+			events[eventIndex].fragments.emplace_back(type_name, std::move(frag));
+		}
+	}
+	TLOG(TLVL_TRACE) << "readBatch_ END";
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::scanBatch_(HighFive::Group const& batch_group, std::vector<FragmentDatasetEventSummary>& output)
+{
+	auto headers = readBatchHeaders_(batch_group);
+	auto firstEvent = output.size();
+	for (size_t row = 0; row < headers.size(); row += BatchHeaderColumns)
+	{
+		FragmentDatasetEventSummary evt;
+		evt.sequence_id = headers[row + BH_SequenceID];
+		evt.has_header = headers[row + BH_HasHeader] != 0;
+		if (evt.has_header)
+		{
+			evt.run_id = static_cast<uint32_t>(headers[row + BH_RunID]);
+			evt.subrun_id = static_cast<uint32_t>(headers[row + BH_SubrunID]);
+			evt.event_id = static_cast<uint32_t>(headers[row + BH_EventID]);
+			evt.timestamp = headers[row + BH_Timestamp];
+			evt.is_complete = headers[row + BH_IsComplete] != 0;
+		}
+		output.push_back(std::move(evt));
+	}
+	auto eventCount = output.size() - firstEvent;
+	TLOG(TLVL_SCANEVENTS) << "scanBatch_: Batch contains " << eventCount << " events";
+
+	for (auto& type_name : batch_group.listObjectNames())
+	{
+		if (batch_group.getObjectType(type_name) != HighFive::ObjectType::Group)
+		{
+			continue;
+		}
+		auto index = readBatchIndex_(batch_group.getGroup(type_name));
+		for (size_t row = 0; row < index.size(); row += BatchIndexColumns)
+		{
+			if (index[row + BI_EventIndex] >= eventCount) continue;
+			auto& typeSummary = output[firstEvent + index[row + BI_EventIndex]].fragment_types[static_cast<artdaq::Fragment::type_t>(index[row + BI_Type])];
+			typeSummary.count++;
+			typeSummary.bytes += index[row + BI_Length] * sizeof(artdaq::RawDataType);
+		}
+	}
+}
+
+std::vector<artdaq::hdf5::FragmentTimeIndexEntry> artdaq::hdf5::HighFiveGroupedDataset::getTimeIndex()
+{
+	if (!timeIndexEntries_)
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+		timeIndexEntries_ = std::make_unique<std::vector<FragmentTimeIndexEntry>>(HighFiveTimeIndex::read(*file_));
+	}
+	return *timeIndexEntries_;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveGroupedDataset::readEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	TLOG(TLVL_DEBUG) << "readEvent BEGIN seqID=" << seqID;
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
+	auto sink = [&](artdaq::Fragment::type_t type) -> artdaq::Fragments& {
+		if (output.count(type) == 0u)
+		{
+			output[type] = makeFragments_(type);
+		}
+		return *output[type];
+	};
+
+	auto groupName = std::to_string(seqID);
+	if (file_->exist(groupName))
+	{
+		readEventGroup_(file_->getGroup(groupName), [&](std::string const& /*type_group_name*/, artdaq::Fragment::type_t type, artdaq::Fragment const* /*container*/) -> artdaq::Fragments& { return sink(type); });
+		TLOG(TLVL_DEBUG) << "readEvent END output.size() = " << output.size();
+		return output;
+	}
+
+	auto batchName = findBatchGroup_(seqID);
+	if (batchName.empty())
+	{
+		TLOG(TLVL_ERROR) << "readEvent: Sequence ID " << seqID << " not found in input file!";
+		return output;
+	}
+	if (batchName != cachedBatchName_)
+	{
+		cachedBatch_.clear();
+		readBatch_(file_->getGroup(batchName), cachedBatch_);
+		cachedBatchName_ = batchName;
+	}
+
+	for (auto const& event : cachedBatch_)
+	{
+		if (event.fragments.empty() || event.fragments.front().second.sequenceID() != seqID)
+		{
+			continue;
+		}
+		for (auto const& entry : event.fragments)
+		{
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CopyFragment));
+			sink(entry.second.type()).push_back(entry.second);
+		}
+		break;
+	}
+
+	TLOG(TLVL_DEBUG) << "readEvent END output.size() = " << output.size();
+	return output;
+}
+
+std::string artdaq::hdf5::HighFiveGroupedDataset::findBatchGroup_(artdaq::Fragment::sequence_id_t seqID)
+{
+	loadBatchMap_();
+	auto it = batchOfEvent_->find(seqID);
+	return it != batchOfEvent_->end() ? it->second : std::string();
+}
+
+void artdaq::hdf5::HighFiveGroupedDataset::loadBatchMap_()
+{
+	if (batchOfEvent_) return;
+
+	TLOG(TLVL_TRACE) << "loadBatchMap_: Reading the headers of every batch group";
+	batchOfEvent_ = std::make_unique<std::unordered_map<artdaq::Fragment::sequence_id_t, std::string>>();
+	for (auto& groupName : file_->listObjectNames())
+	{
+		if (file_->getObjectType(groupName) != HighFive::ObjectType::Group) continue;
+		auto group = file_->getGroup(groupName);
+		if (!group.hasAttribute("batch_event_count")) continue;
+
+		auto headers = readBatchHeaders_(group);
+		for (size_t row = 0; row < headers.size(); row += BatchHeaderColumns)
+		{
+			(*batchOfEvent_)[headers[row + BH_SequenceID]] = groupName;
+		}
+	}
+	TLOG(TLVL_TRACE) << "loadBatchMap_: " << batchOfEvent_->size() << " batched events";
+}
+
+size_t artdaq::hdf5::HighFiveGroupedDataset::getFileSize()
+{
+	return getHDF5FileSize(file_.get());
 }
 
 DEFINE_ARTDAQ_DATASET_PLUGIN(artdaq::hdf5::HighFiveGroupedDataset)
@@ -7,15 +7,28 @@
 #include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
 
 #include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveChunkReader.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveChunkWriter.hh"
 #include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveEventHeaderTable.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveFileProfile.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveTimeIndex.hh"
 
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace artdaq {
 namespace hdf5 {
 
 /**
- * @brief An implementation of FragmentDataset using the HighFive backend to produce files identical to those produced by the hep_hpc backend (FragmentNtuple)
+ * @brief An implementation of FragmentDataset using the HighFive backend to produce files in the Ntuple layout of the hep_hpc backend (FragmentNtuple)
+ *
+ * Fragments are stored in Ntuples of per-field columns as in FragmentNtuple, while event headers are stored in one compound-typed table
+ * (see HighFiveEventHeaderTable). Files with per-field EventHeaders columns can still be read.
  */
 class HighFiveNtupleDataset : public FragmentDataset
 {
@@ -30,6 +43,26 @@ public:
 	 * "payloadChunkSize" (Default: 128): Size of the payload Ntuple's chunks, in rows
 	 * "chunkCacheSizeBytes" (Default: 10 chunks): Size of the chunk cache, in bytes
 	 * "fileName" (REQUIRED): HDF5 file to read/write
+	 * "fileProfile" (Default: {}): HDF5 file and dataset property settings, see HighFiveFileProfile
+	 * "writeTimeIndex" (Default: true): Whether to write the "time_index" dataset (see HighFiveTimeIndex) used by readTimeRange
+	 * "compressionThreads" (Default: 0): When writing, number of threads used to deflate the payload dataset (see
+	 *   HighFiveChunkWriter). Requires fileProfile.deflateLevel; 0 compresses in H5Dwrite, on the calling thread.
+	 * "compressionQueueChunks" (Default: 2 * compressionThreads): Payload chunks which may wait for compression
+	 * "decompressionThreads" (Default: 0): When reading, number of threads used to inflate a deflate-compressed payload
+	 *   dataset (see HighFiveChunkReader). 0 reads through H5Dread, which decompresses on the calling thread.
+	 * "tableMode" (Default: "single"): "single" writes every Fragment to the /Fragments Ntuple. "type" writes one Ntuple
+	 *   per Fragment type (/FragmentTables/Type_<type>), and "instance" one per product instance name
+	 *   (/FragmentTables/<name>), so that each table has a row width, chunk shape and compression suited to its Fragments,
+	 *   and can be read on its own. When reading, the layout is taken from the file, and the tables are merged by sequence ID.
+	 * "fragmentTables" (Default: []): Settings of individual tables in the "type" and "instance" modes. Each entry names
+	 *   its table with "fragmentType" or "instanceName" (matching tableMode), and may set "nWordsPerRow", "payloadChunkSize",
+	 *   "chunkCacheSizeBytes" and "deflateLevel" (overriding fileProfile.deflateLevel). Tables without nWordsPerRow size their
+	 *   rows from the first Fragment written to them (its size plus 1/8, in multiples of 64 words, up to maxWordsPerRow), and
+	 *   without payloadChunkSize their chunks hold as many bytes as payloadChunkSize rows of nWordsPerRow words.
+	 * "maxWordsPerRow" (Default: 1048576): Largest row width chosen from the first Fragment of a table
+	 * "headerChunkSize" (Default: 128): Size of the chunks of the EventHeaders table, in records
+	 *
+	 * With writeChecksums (see FragmentDataset), the Fragment checksum is stored in a "checksum" column, on every row of the Fragment.
 	 */
 	HighFiveNtupleDataset(fhicl::ParameterSet const& ps);
 
@@ -50,13 +83,16 @@ public:
 	 * @brief Insert a RawEventHeader into the Dataset (write it to the HDF5 file)
 	 * @param hdr RawEventHeader to insert
 	 *
-	 * This FragmentDataset plugin uses the "Ntuple" file format, where each RawEventHeader is represented by a row in the EventHeaders Ntuple Group.
+	 * Each RawEventHeader is written as one record of the compound-typed /EventHeaders/records table (see HighFiveEventHeaderTable).
 	 */
 	void insertHeader(detail::RawEventHeader const& hdr) override;
 
 	/**
 	 * @brief Read the next event from the Dataset (HDF5 file)
 	 * @returns A Map of Fragment::type_t and pointers to Fragments, suitable for ArtdaqInput
+	 *
+	 * With several Fragment tables, the next event is the lowest sequence ID not yet read from any table, and its rows are
+	 * read from every table which has them.
 	 */
 	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readNextEvent() override;
 
@@ -64,22 +100,103 @@ public:
 	 * @brief Read a RawEventHeader from the Dataset (HDF5 file)
 	 * @param seqID Sequence ID of the RawEventHeader (should be equivalent to event number)
 	 * @return Pointer to a RawEventHeader if a match was found in the Dataset, nullptr otherwise
+	 *
+	 * The whole header table is read when the first header is requested, and headers are then looked up in memory.
+	 * Files with per-field EventHeaders columns are read the same way, with one bulk read per column.
 	 */
 	std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const&) override;
 
+	/**
+	 * @brief Produce a summary of every event in the Dataset without reading Fragment payloads
+	 * @return One FragmentDatasetEventSummary per event, ordered by sequence ID
+	 *
+	 * The summary is built from the in-memory header table and bulk reads of the sequenceID, type, size and index columns of each Fragments table.
+	 */
+	std::vector<FragmentDatasetEventSummary> scanEvents() override;
+
+	/**
+	 * @brief Get the current size of the HDF5 file
+	 * @return Size of the file, in bytes, as reported by H5Fget_filesize
+	 */
+	size_t getFileSize() override;
+
+	/**
+	 * @brief Get the number of times the Ntuple columns have been extended
+	 * @return Sum of the resize counts of every column in the Fragments tables and of the EventHeaders table
+	 */
+	size_t getDatasetExtensionCount() override;
+	/**
+	 * @brief Read the time index of the file
+	 * @return One FragmentTimeIndexEntry per Fragment, read from the "time_index" dataset when first requested
+	 */
+	std::vector<FragmentTimeIndexEntry> getTimeIndex() override;
+	/**
+	 * @brief Read a single event from the file, without changing the position of readNextEvent
+	 * @param seqID Sequence ID of the event to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, empty if the event was not found
+	 *
+	 * The first row of the event is found with a bulk read of the sequenceID column of each table, which is kept in memory.
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readEvent(artdaq::Fragment::sequence_id_t seqID) override;
+
 private:
 	HighFiveNtupleDataset(HighFiveNtupleDataset const&) = delete;
 	HighFiveNtupleDataset(HighFiveNtupleDataset&&) = delete;
 	HighFiveNtupleDataset& operator=(HighFiveNtupleDataset const&) = delete;
 	HighFiveNtupleDataset& operator=(HighFiveNtupleDataset&&) = delete;
 
+	static constexpr size_t NoTable = std::numeric_limits<size_t>::max();
+	static constexpr size_t TableRowWordsGranularity = 64;
+
+	enum class TableMode
+	{
+		Single,
+		Type,
+		Instance
+	};
+
+	/**
+	 * @brief One Fragments Ntuple: a group of columns with one row per payload row of each Fragment
+	 */
+	struct FragmentTable
+	{
+		std::string name;                                                                  ///< Name of the table's group (empty for /Fragments)
+		std::unordered_map<std::string, std::unique_ptr<HighFiveDatasetHelper>> columns;  ///< Columns of the table, by name
+		size_t wordsPerRow{0};                                                             ///< Payload words per row
+		std::unique_ptr<HighFiveChunkWriter> payloadWriter;                                ///< Writer of the payload column, with compressionThreads
+		bool chunkReadable{false};                                                         ///< Read mode: whether the payload can be read with the HighFiveChunkReader
+		size_t nextRow{0};                                                                 ///< Read mode: first row not yet read by readNextEvent
+		std::vector<uint64_t> sequenceIDs;                                                 ///< Read mode: the sequenceID column, read when first needed
+	};
+
+	FragmentTable& getTable_(artdaq::Fragment const& frag);
+	std::unique_ptr<FragmentTable> createTable_(std::string const& name, artdaq::Fragment const* frag);
+	std::unique_ptr<FragmentTable> openTable_(HighFive::Group const& group, std::string const& name, HighFive::DataSetAccessProps const& payloadAccessProps);
+	std::vector<uint64_t> const& tableSequenceIDs_(FragmentTable& table);
+	void readTableRows_(FragmentTable& table, size_t& row, artdaq::Fragment::sequence_id_t seqID, std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>& output);
+	std::vector<artdaq::detail::RawEventHeader> const& loadEventHeaders_();
+
 	std::unique_ptr<HighFive::File> file_;
-	size_t headerIndex_;
-	size_t fragmentIndex_;
+	HighFiveCoreSpill coreSpill_;
 	size_t nWordsPerRow_;
+	TableMode tableMode_;
+	size_t payloadChunkSize_;
+	size_t maxWordsPerRow_;
+	double extentGrowthFactor_;
+	size_t compressionQueueChunks_;
+	fhicl::ParameterSet ps_;
+	std::map<std::string, fhicl::ParameterSet> tableConfigs_;
+	HighFive::DataSetCreateProps scalarCProps_;
 
-	std::unordered_map<std::string, std::unique_ptr<HighFiveDatasetHelper>> fragment_datasets_;
-	std::unordered_map<std::string, std::unique_ptr<HighFiveDatasetHelper>> event_datasets_;
+	std::unique_ptr<HighFiveEventHeaderTable> headerTable_;
+	std::unique_ptr<std::vector<artdaq::detail::RawEventHeader>> eventHeaders_;  ///< Read mode: the header table sorted by sequence ID, read when first needed
+	std::unique_ptr<HighFiveTimeIndex> timeIndex_;
+	std::unique_ptr<std::vector<FragmentTimeIndexEntry>> timeIndexEntries_;
+	std::unique_ptr<HighFiveChunkReader> chunkReader_;
+	std::unique_ptr<HighFiveWorkerPool> compressionPool_;
+	std::vector<std::unique_ptr<FragmentTable>> tables_;
+	std::unordered_map<std::string, size_t> tableIndex_;
+	std::vector<size_t> typeTables_;
 };
 }  // namespace hdf5
 }  // namespace artdaq
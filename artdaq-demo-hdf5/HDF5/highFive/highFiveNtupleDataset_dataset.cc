@@ -1,76 +1,152 @@
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <memory>
+#include <tuple>
 
 #include "tracemf.h"
 #define TRACE_NAME "HighFiveNtupleDataset"
 
 #include "artdaq-core/Data/ContainerFragment.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveFileProfile.hh"
 #include "artdaq-demo-hdf5/HDF5/highFive/highFiveNtupleDataset.hh"
 
 artdaq::hdf5::HighFiveNtupleDataset::HighFiveNtupleDataset(fhicl::ParameterSet const& ps)
     : FragmentDataset(ps, ps.get<std::string>("mode", "write"))
     , file_(nullptr)
-    , headerIndex_(0)
-    , fragmentIndex_(0)
     , nWordsPerRow_(ps.get<size_t>("nWordsPerRow", 10240))
+    , tableMode_(TableMode::Single)
+    , payloadChunkSize_(ps.get<size_t>("payloadChunkSize", 128))
+    , maxWordsPerRow_(ps.get<size_t>("maxWordsPerRow", 1048576))
+    , extentGrowthFactor_(1.0)
+    , compressionQueueChunks_(0)
+    , ps_(ps)
+    , typeTables_(static_cast<size_t>(std::numeric_limits<artdaq::Fragment::type_t>::max()) + 1, NoTable)
 
 {
 	TLOG(TLVL_DEBUG) << "HighFiveNtupleDataset Constructor BEGIN";
-	auto payloadChunkSize = ps.get<size_t>("payloadChunkSize", 128);
-	HighFive::DataSetAccessProps payloadAccessProps;
-	payloadAccessProps.add(HighFive::Caching(12421, ps.get<size_t>("chunkCacheSizeBytes", sizeof(artdaq::RawDataType) * payloadChunkSize * nWordsPerRow_ * 10), 0.5));
+	if (nWordsPerRow_ == 0) nWordsPerRow_ = 10240;
+	if (payloadChunkSize_ == 0) payloadChunkSize_ = 128;
+	if (maxWordsPerRow_ < TableRowWordsGranularity) maxWordsPerRow_ = TableRowWordsGranularity;
+	HighFiveFileProfile fileProfile(ps);
+
+	auto tableMode = ps.get<std::string>("tableMode", "single");
+	if (tableMode == "type")
+	{
+		tableMode_ = TableMode::Type;
+	}
+	else if (tableMode == "instance")
+	{
+		tableMode_ = TableMode::Instance;
+	}
+	else if (tableMode != "single")
+	{
+		TLOG(TLVL_WARNING) << "HighFiveNtupleDataset: Unknown tableMode " << tableMode << ", using \"single\"";
+	}
+	for (auto const& table : ps.get<std::vector<fhicl::ParameterSet>>("fragmentTables", std::vector<fhicl::ParameterSet>()))
+	{
+		if (tableMode_ == TableMode::Type && table.has_key("fragmentType"))
+		{
+			tableConfigs_["Type_" + std::to_string(table.get<int>("fragmentType"))] = table;
+		}
+		else if (tableMode_ == TableMode::Instance && table.has_key("instanceName"))
+		{
+			tableConfigs_[table.get<std::string>("instanceName")] = table;
+		}
+		else
+		{
+			TLOG(TLVL_WARNING) << "HighFiveNtupleDataset: Ignoring fragmentTables entry without "
+			                   << (tableMode_ == TableMode::Instance ? "instanceName" : "fragmentType") << " (tableMode is " << tableMode << ")";
+		}
+	}
 
 	if (mode_ == FragmentDatasetMode::Read)
 	{
 		TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Opening input file and getting Dataset pointers";
-		file_ = std::make_unique<HighFive::File>(ps.get<std::string>("fileName"), HighFive::File::ReadOnly);
-
-		auto fragmentGroup = file_->getGroup("/Fragments");
-		fragment_datasets_["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("sequenceID"));
-		fragment_datasets_["fragmentID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("fragmentID"));
-		fragment_datasets_["timestamp"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("timestamp"));
-		fragment_datasets_["type"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("type"));
-		fragment_datasets_["size"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("size"));
-		fragment_datasets_["index"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("index"));
-		fragment_datasets_["payload"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("payload", payloadAccessProps));
-		auto headerGroup = file_->getGroup("/EventHeaders");
-		event_datasets_["run_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("run_id"));
-		event_datasets_["subrun_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("subrun_id"));
-		event_datasets_["event_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("event_id"));
-		event_datasets_["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("sequenceID"));
-		event_datasets_["timestamp"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("timestamp"));
-		event_datasets_["is_complete"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.getDataSet("is_complete"));
+		file_ = fileProfile.openFile(ps.get<std::string>("fileName"), mode_);
+
+		HighFive::DataSetAccessProps payloadAccessProps;
+		payloadAccessProps.add(HighFive::Caching(12421, ps.get<size_t>("chunkCacheSizeBytes", sizeof(artdaq::RawDataType) * payloadChunkSize_ * nWordsPerRow_ * 10), 0.5));
+		if (file_->exist("/Fragments"))
+		{
+			tables_.push_back(openTable_(file_->getGroup("/Fragments"), "", payloadAccessProps));
+		}
+		else if (file_->exist("/FragmentTables"))
+		{
+			auto tablesGroup = file_->getGroup("/FragmentTables");
+			for (auto const& name : tablesGroup.listObjectNames())
+			{
+				tables_.push_back(openTable_(tablesGroup.getGroup(name), name, payloadAccessProps));
+			}
+			TLOG(TLVL_DEBUG) << "HighFiveNtupleDataset: Input file has " << tables_.size() << " Fragment tables";
+		}
+		else
+		{
+			TLOG(TLVL_ERROR) << "HighFiveNtupleDataset: Input file has neither /Fragments nor /FragmentTables";
+		}
+		if (!file_->exist("/EventHeaders"))
+		{
+			TLOG(TLVL_WARNING) << "HighFiveNtupleDataset: Input file has no /EventHeaders group, events will have no RawEventHeader";
+		}
+
+		auto decompressionThreads = ps.get<size_t>("decompressionThreads", 0);
+		if (decompressionThreads > 0)
+		{
+			auto readable = std::any_of(tables_.begin(), tables_.end(), [](std::unique_ptr<FragmentTable> const& table) { return table->chunkReadable; });
+			if (readable)
+			{
+				chunkReader_ = std::make_unique<HighFiveChunkReader>(decompressionThreads);
+			}
+			else
+			{
+				TLOG(TLVL_WARNING) << "HighFiveNtupleDataset: decompressionThreads is set, but the payload dataset is not deflate-compressed; reading it serially";
+			}
+		}
 	}
 	else
 	{
 		TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Creating output file";
-		file_ = std::make_unique<HighFive::File>(ps.get<std::string>("fileName"), HighFive::File::OpenOrCreate | HighFive::File::Truncate);
-
-		HighFive::DataSetCreateProps scalar_props;
-		scalar_props.add(HighFive::Chunking(std::vector<hsize_t>{128, 1}));
-		HighFive::DataSetCreateProps vector_props;
-		vector_props.add(HighFive::Chunking(std::vector<hsize_t>{payloadChunkSize, nWordsPerRow_}));
-
-		HighFive::DataSpace scalarSpace = HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1});
-		HighFive::DataSpace vectorSpace = HighFive::DataSpace({0, nWordsPerRow_}, {HighFive::DataSpace::UNLIMITED, nWordsPerRow_});
-
-		TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Creating Fragment datasets";
-		auto fragmentGroup = file_->createGroup("/Fragments");
-		fragment_datasets_["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("sequenceID", scalarSpace, scalar_props));
-		fragment_datasets_["fragmentID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint16_t>("fragmentID", scalarSpace, scalar_props));
-		fragment_datasets_["timestamp"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("timestamp", scalarSpace, scalar_props));
-		fragment_datasets_["type"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint8_t>("type", scalarSpace, scalar_props));
-		fragment_datasets_["size"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("size", scalarSpace, scalar_props));
-		fragment_datasets_["index"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("index", scalarSpace, scalar_props));
-		fragment_datasets_["payload"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<artdaq::RawDataType>("payload", vectorSpace, vector_props, payloadAccessProps), payloadChunkSize);
-
-		TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Creating EventHeader datasets";
+		file_ = fileProfile.openFile(ps.get<std::string>("fileName"), mode_);
+		coreSpill_ = HighFiveCoreSpill(*file_, fileProfile.coreSpillSize());
+		extentGrowthFactor_ = fileProfile.extentGrowthFactor();
+
+		scalarCProps_.add(HighFive::Chunking(std::vector<hsize_t>{128, 1}));
+		fileProfile.applyTo(scalarCProps_);
+
+		auto compressionThreads = ps.get<size_t>("compressionThreads", 0);
+		if (compressionThreads > 0)
+		{
+			compressionPool_ = std::make_unique<HighFiveWorkerPool>(compressionThreads);
+			compressionQueueChunks_ = ps.get<size_t>("compressionQueueChunks", 2 * compressionThreads);
+		}
+
+		if (tableMode_ == TableMode::Single)
+		{
+			TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Creating Fragment datasets";
+			tables_.push_back(createTable_("", nullptr));
+		}
+		else
+		{
+			// Tables are created when the first Fragment for them is written
+			file_->createGroup("/FragmentTables");
+		}
+
+		TLOG(TLVL_TRACE) << "HighFiveNtupleDataset: Creating EventHeader table";
 		auto headerGroup = file_->createGroup("/EventHeaders");
-		event_datasets_["run_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint32_t>("run_id", scalarSpace, scalar_props));
-		event_datasets_["subrun_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint32_t>("subrun_id", scalarSpace, scalar_props));
-		event_datasets_["event_id"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint32_t>("event_id", scalarSpace, scalar_props));
-		event_datasets_["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint64_t>("sequenceID", scalarSpace, scalar_props));
-		event_datasets_["timestamp"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint64_t>("timestamp", scalarSpace, scalar_props));
-		event_datasets_["is_complete"] = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint8_t>("is_complete", scalarSpace, scalar_props));
+		HighFive::DataSetCreateProps headerProps;
+		fileProfile.applyTo(headerProps);
+		headerTable_ = HighFiveEventHeaderTable::create(headerGroup, ps.get<size_t>("headerChunkSize", 128), headerProps);
+		headerTable_->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+		headerTable_->setExtentGrowth(extentGrowthFactor_);
+
+		if (ps.get<bool>("writeTimeIndex", true))
+		{
+			HighFive::DataSetCreateProps timeIndexProps;
+			fileProfile.applyTo(timeIndexProps);
+			timeIndex_ = HighFiveTimeIndex::create(*file_, 128, timeIndexProps);
+			timeIndex_->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+			timeIndex_->setExtentGrowth(extentGrowthFactor_);
+		}
 	}
 	TLOG(TLVL_DEBUG) << "HighFiveNtupleDataset Constructor END";
 }
@@ -81,12 +157,150 @@ artdaq::hdf5::HighFiveNtupleDataset::~HighFiveNtupleDataset() noexcept
 	//	file_->flush();
 }
 
+artdaq::hdf5::HighFiveNtupleDataset::FragmentTable& artdaq::hdf5::HighFiveNtupleDataset::getTable_(artdaq::Fragment const& frag)
+{
+	if (tableMode_ == TableMode::Single) return *tables_.front();
+
+	if (tableMode_ == TableMode::Type)
+	{
+		auto& index = typeTables_[frag.type()];
+		if (index == NoTable)
+		{
+			index = tables_.size();
+			tables_.push_back(createTable_("Type_" + std::to_string(frag.type()), &frag));
+		}
+		return *tables_[index];
+	}
+
+	auto const& name = getInstanceName_(frag);
+	auto it = tableIndex_.find(name);
+	if (it == tableIndex_.end())
+	{
+		tables_.push_back(createTable_(name, &frag));
+		it = tableIndex_.emplace(name, tables_.size() - 1).first;
+	}
+	return *tables_[it->second];
+}
+
+std::unique_ptr<artdaq::hdf5::HighFiveNtupleDataset::FragmentTable> artdaq::hdf5::HighFiveNtupleDataset::createTable_(std::string const& name, artdaq::Fragment const* frag)
+{
+	auto table = std::make_unique<FragmentTable>();
+	table->name = name;
+
+	auto configIt = tableConfigs_.find(name);
+	auto config = configIt != tableConfigs_.end() ? configIt->second : fhicl::ParameterSet();
+	size_t wordsPerRow = nWordsPerRow_;
+	if (frag != nullptr)
+	{
+		// Room for Fragments somewhat larger than the first one, so that they are not split into a nearly-empty second row
+		auto size = frag->size() + frag->size() / 8;
+		auto autoWords = ((size + TableRowWordsGranularity - 1) / TableRowWordsGranularity) * TableRowWordsGranularity;
+		wordsPerRow = config.get<size_t>("nWordsPerRow", std::min(autoWords, maxWordsPerRow_));
+		if (wordsPerRow == 0) wordsPerRow = std::min(autoWords, maxWordsPerRow_);
+	}
+	// By default, chunks hold as many bytes as those of the single-table layout
+	auto chunkRows = config.get<size_t>("payloadChunkSize", std::max<size_t>(1, payloadChunkSize_ * nWordsPerRow_ / wordsPerRow));
+	if (chunkRows == 0) chunkRows = 1;
+	auto cacheBytes = config.get<size_t>("chunkCacheSizeBytes", ps_.get<size_t>("chunkCacheSizeBytes", sizeof(artdaq::RawDataType) * chunkRows * wordsPerRow * 10));
+	table->wordsPerRow = wordsPerRow;
+
+	// A table's deflateLevel overrides the one of the fileProfile
+	auto tableProfilePs = ps_;
+	if (config.has_key("deflateLevel"))
+	{
+		auto profile = ps_.get<fhicl::ParameterSet>("fileProfile", fhicl::ParameterSet());
+		profile.put_or_replace<unsigned>("deflateLevel", config.get<unsigned>("deflateLevel"));
+		tableProfilePs.put_or_replace<fhicl::ParameterSet>("fileProfile", profile);
+	}
+	HighFiveFileProfile tableProfile(tableProfilePs);
+
+	TLOG(TLVL_DEBUG) << "HighFiveNtupleDataset: Creating Fragment table " << (name.empty() ? "/Fragments" : name) << " with " << wordsPerRow << " words per row and "
+	                 << chunkRows << " rows per chunk";
+	HighFive::DataSetCreateProps vector_props;
+	vector_props.add(HighFive::Chunking(std::vector<hsize_t>{chunkRows, wordsPerRow}));
+	tableProfile.applyTo(vector_props);
+	HighFive::DataSetAccessProps payloadAccessProps;
+	payloadAccessProps.add(HighFive::Caching(12421, cacheBytes, 0.5));
+
+	HighFive::DataSpace scalarSpace = HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1});
+	HighFive::DataSpace vectorSpace = HighFive::DataSpace({0, wordsPerRow}, {HighFive::DataSpace::UNLIMITED, wordsPerRow});
+
+	auto fragmentGroup = name.empty() ? file_->createGroup("/Fragments") : file_->getGroup("/FragmentTables").createGroup(name);
+	auto& columns = table->columns;
+	columns["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("sequenceID", scalarSpace, scalarCProps_));
+	columns["fragmentID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint16_t>("fragmentID", scalarSpace, scalarCProps_));
+	columns["timestamp"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("timestamp", scalarSpace, scalarCProps_));
+	columns["type"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint8_t>("type", scalarSpace, scalarCProps_));
+	columns["size"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("size", scalarSpace, scalarCProps_));
+	columns["index"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint64_t>("index", scalarSpace, scalarCProps_));
+	if (checksumsEnabled_())
+	{
+		columns["checksum"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<uint32_t>("checksum", scalarSpace, scalarCProps_));
+	}
+	columns["payload"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.createDataSet<artdaq::RawDataType>("payload", vectorSpace, vector_props, payloadAccessProps), chunkRows);
+
+	for (auto& dataset : columns)
+	{
+		dataset.second->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+		dataset.second->setExtentGrowth(extentGrowthFactor_);
+	}
+
+	if (compressionPool_)
+	{
+		auto const& payload = columns["payload"]->getDataset();
+		if (HighFiveChunkWriter::supports(payload))
+		{
+			table->payloadWriter = std::make_unique<HighFiveChunkWriter>(payload, *compressionPool_, compressionQueueChunks_);
+		}
+		else
+		{
+			TLOG(TLVL_WARNING) << "HighFiveNtupleDataset: compressionThreads is set, but deflateLevel is not set for " << (name.empty() ? "/Fragments" : name)
+			                   << "; writing its payload uncompressed";
+		}
+	}
+	return table;
+}
+
+std::unique_ptr<artdaq::hdf5::HighFiveNtupleDataset::FragmentTable> artdaq::hdf5::HighFiveNtupleDataset::openTable_(HighFive::Group const& fragmentGroup, std::string const& name, HighFive::DataSetAccessProps const& payloadAccessProps)
+{
+	auto table = std::make_unique<FragmentTable>();
+	table->name = name;
+	auto& columns = table->columns;
+	columns["sequenceID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("sequenceID"));
+	columns["fragmentID"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("fragmentID"));
+	columns["timestamp"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("timestamp"));
+	columns["type"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("type"));
+	columns["size"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("size"));
+	columns["index"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("index"));
+	if (verifyingChecksums_() && fragmentGroup.exist("checksum"))
+	{
+		columns["checksum"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("checksum"));
+	}
+	columns["payload"] = std::make_unique<HighFiveDatasetHelper>(fragmentGroup.getDataSet("payload", payloadAccessProps));
+	table->wordsPerRow = columns["payload"]->getRowSize();
+	table->chunkReadable = HighFiveChunkReader::supports(columns["payload"]->getDataset());
+	return table;
+}
+
+std::vector<uint64_t> const& artdaq::hdf5::HighFiveNtupleDataset::tableSequenceIDs_(FragmentTable& table)
+{
+	if (table.sequenceIDs.empty())
+	{
+		table.sequenceIDs = table.columns["sequenceID"]->readColumn<uint64_t>();
+	}
+	return table.sequenceIDs;
+}
+
 void artdaq::hdf5::HighFiveNtupleDataset::insertOne(artdaq::Fragment const& frag)
 {
 	TLOG(TLVL_TRACE) << "insertOne BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertOne));
+	auto& table = getTable_(frag);
+	auto& columns = table.columns;
+	auto wordsPerRow = table.wordsPerRow;
 	auto fragSize = frag.size();
-	auto rows = static_cast<size_t>(floor(fragSize / static_cast<double>(nWordsPerRow_))) + (fragSize % nWordsPerRow_ == 0 ? 0 : 1);
-	TLOG(5) << "Fragment size: " << fragSize << ", rows: " << rows << " (nWordsPerRow: " << nWordsPerRow_ << ")";
+	auto rows = static_cast<size_t>(floor(fragSize / static_cast<double>(wordsPerRow))) + (fragSize % wordsPerRow == 0 ? 0 : 1);
+	TLOG(5) << "Fragment size: " << fragSize << ", rows: " << rows << " (nWordsPerRow: " << wordsPerRow << ")";
 
 	TLOG(6) << "First words of Fragment: 0x" << std::hex << *frag.headerBegin() << " 0x" << std::hex << *(frag.headerBegin() + 1) << " 0x" << std::hex << *(frag.headerBegin() + 2) << " 0x" << std::hex << *(frag.headerBegin() + 3) << " 0x" << std::hex << *(frag.headerBegin() + 4);
 
@@ -94,19 +308,38 @@ void artdaq::hdf5::HighFiveNtupleDataset::insertOne(artdaq::Fragment const& frag
 	auto fragID = frag.fragmentID();
 	auto timestamp = frag.timestamp();
 	auto type = frag.type();
+	uint32_t checksum = checksumsEnabled_() ? fragmentChecksum(frag) : 0;
+
+	if (timeIndex_)
+	{
+		timeIndex_->write(makeTimeIndexEntry_(frag));
+	}
 
 	for (size_t ii = 0; ii < rows; ++ii)
 	{
 		TLOG(7) << "Writing Fragment fields to datasets";
-		fragment_datasets_["sequenceID"]->write(seqID);
-		fragment_datasets_["fragmentID"]->write(fragID);
-		fragment_datasets_["timestamp"]->write(timestamp);
-		fragment_datasets_["type"]->write(type);
-		fragment_datasets_["size"]->write(fragSize);
-		fragment_datasets_["index"]->write(ii * nWordsPerRow_);
+		columns["sequenceID"]->write(seqID);
+		columns["fragmentID"]->write(fragID);
+		columns["timestamp"]->write(timestamp);
+		columns["type"]->write(type);
+		columns["size"]->write(fragSize);
+		columns["index"]->write(ii * wordsPerRow);
+		if (checksumsEnabled_())
+		{
+			columns["checksum"]->write(checksum);
+		}
 
-		auto wordsThisRow = (ii + 1) * nWordsPerRow_ <= fragSize ? nWordsPerRow_ : fragSize - (ii * nWordsPerRow_);
-		fragment_datasets_["payload"]->write(frag.headerBegin() + (ii * nWordsPerRow_), wordsThisRow);
+		auto wordsThisRow = (ii + 1) * wordsPerRow <= fragSize ? wordsPerRow : fragSize - (ii * wordsPerRow);
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+		if (table.payloadWriter)
+		{
+			// The last row of the Fragment is zero-filled, as HighFiveDatasetHelper leaves it
+			table.payloadWriter->write(frag.headerBegin() + (ii * wordsPerRow), wordsThisRow);
+		}
+		else
+		{
+			columns["payload"]->write(frag.headerBegin() + (ii * wordsPerRow), wordsThisRow);
+		}
 	}
 	TLOG(TLVL_TRACE) << "insertOne END";
 }
@@ -114,112 +347,320 @@ void artdaq::hdf5::HighFiveNtupleDataset::insertOne(artdaq::Fragment const& frag
 void artdaq::hdf5::HighFiveNtupleDataset::insertHeader(artdaq::detail::RawEventHeader const& hdr)
 {
 	TLOG(TLVL_TRACE) << "insertHeader BEGIN";
-	event_datasets_["run_id"]->write(hdr.run_id);
-	event_datasets_["subrun_id"]->write(hdr.subrun_id);
-	event_datasets_["event_id"]->write(hdr.event_id);
-	event_datasets_["sequenceID"]->write(hdr.sequence_id);
-	event_datasets_["timestamp"]->write(hdr.timestamp);
-	event_datasets_["is_complete"]->write(hdr.is_complete);
+	coreSpill_.check();
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertHeader));
+	headerTable_->write(hdr);
 
 	TLOG(TLVL_TRACE) << "insertHeader END";
 }
 
 std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveNtupleDataset::readNextEvent()
 {
-	TLOG(TLVL_TRACE) << "readNextEvent START fragmentIndex_ " << fragmentIndex_;
+	TLOG(TLVL_TRACE) << "readNextEvent START";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
 	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
 
-	auto numFragments = fragment_datasets_["sequenceID"]->getDatasetSize();
+	// Each table is in event order, so the next event is the lowest sequence ID at the tables' read positions
 	artdaq::Fragment::sequence_id_t currentSeqID = 0;
-
-	while (fragmentIndex_ < numFragments)
+	for (auto& table : tables_)
 	{
-		TLOG(8) << "readNextEvent: Testing Fragment " << fragmentIndex_ << " / " << numFragments << " to see if it belongs in this event";
-		if (currentSeqID == 0)
+		auto const& sequenceIDs = tableSequenceIDs_(*table);
+		// Zero-filled rows (from files whose extent was not trimmed) are skipped
+		while (table->nextRow < sequenceIDs.size() && sequenceIDs[table->nextRow] == 0) table->nextRow++;
+		if (table->nextRow < sequenceIDs.size() && (currentSeqID == 0 || sequenceIDs[table->nextRow] < currentSeqID))
 		{
-			currentSeqID = fragment_datasets_["sequenceID"]->readOne<uint64_t>(fragmentIndex_);
-			TLOG(8) << "readNextEvent: Setting current Sequence ID to " << currentSeqID;
+			currentSeqID = sequenceIDs[table->nextRow];
 		}
+	}
+	TLOG(8) << "readNextEvent: Current sequence ID is " << currentSeqID;
 
-		auto sequence_id = fragment_datasets_["sequenceID"]->readOne<uint64_t>(fragmentIndex_);
-		if (sequence_id != currentSeqID)
+	if (currentSeqID != 0)
+	{
+		for (auto& table : tables_)
 		{
-			TLOG(8) << "readNextEvent: Current sequence ID is " << currentSeqID << ", next Fragment sequence ID is " << sequence_id << ", leaving read loop";
-			break;
+			readTableRows_(*table, table->nextRow, currentSeqID, output);
 		}
+	}
+
+	recordFragmentCounts_(output);
+
+	TLOG(TLVL_TRACE) << "readNextEvent END output.size() = " << output.size();
+	return output;
+}
+
+void artdaq::hdf5::HighFiveNtupleDataset::readTableRows_(FragmentTable& table, size_t& row, artdaq::Fragment::sequence_id_t seqID, std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>& output)
+{
+	auto const& sequenceIDs = tableSequenceIDs_(table);
+	auto& columns = table.columns;
+
+	// With a chunk reader, payload rows are queued and read once all of the table's Fragments exist (so that they no longer move)
+	struct PayloadRow
+	{
+		artdaq::Fragment::type_t type;
+		size_t fragment;
+		size_t row;
+		size_t offset;
+		size_t words;
+	};
+	std::vector<PayloadRow> payloadRows;
+	auto useChunkReader = chunkReader_ && table.chunkReadable;
+	// Checksums are verified once all payload rows have been read
+	std::vector<std::tuple<artdaq::Fragment::type_t, size_t, uint32_t>> checksums;
+	auto checksumColumn = columns.find("checksum");
+	auto payloadRowSize = table.wordsPerRow;
+
+	while (row < sequenceIDs.size() && sequenceIDs[row] == seqID)
+	{
+		TLOG(8) << "readTableRows_: Reading Fragment at row " << row << " / " << sequenceIDs.size() << " of table " << table.name;
 
-		auto payloadRowSize = fragment_datasets_["payload"]->getRowSize();
+		auto type = columns["type"]->readOne<uint8_t>(row);
+		auto size_words = columns["size"]->readOne<uint64_t>(row);
+		auto index = columns["index"]->readOne<uint64_t>(row);
 
-		auto type = fragment_datasets_["type"]->readOne<uint8_t>(fragmentIndex_);
-		auto size_words = fragment_datasets_["size"]->readOne<uint64_t>(fragmentIndex_);
-		auto index = fragment_datasets_["index"]->readOne<uint64_t>(fragmentIndex_);
-		artdaq::Fragment frag(size_words - artdaq::detail::RawFragmentHeader::num_words());
+		if (output.count(type) == 0u)
+		{
+			output[type] = makeFragments_(type);
+		}
+		// Construct the Fragment in place in the output vector, so that its payload is never copied
+		output[type]->emplace_back(size_words - artdaq::detail::RawFragmentHeader::num_words());
+		auto& frag = output[type]->back();
+		if (checksumColumn != columns.end())
+		{
+			checksums.emplace_back(type, output[type]->size() - 1, checksumColumn->second->readOne<uint32_t>(row));
+		}
 
-		TLOG(8) << "readNextEvent: Fragment has size " << size_words << ", payloadRowSize is " << payloadRowSize;
+		TLOG(8) << "readTableRows_: Fragment has size " << size_words << ", payloadRowSize is " << payloadRowSize;
 		auto thisRowSize = size_words > payloadRowSize ? payloadRowSize : size_words;
-		auto payloadvec = fragment_datasets_["payload"]->read<artdaq::RawDataType>(fragmentIndex_);
-		memcpy(frag.headerBegin(), &(payloadvec[0]), thisRowSize * sizeof(artdaq::RawDataType));
+		if (useChunkReader)
+		{
+			payloadRows.push_back(PayloadRow{type, output[type]->size() - 1, row, 0, thisRowSize});
+		}
+		else
+		{
+			// Payload rows are read directly into the Fragment, without an intermediate row buffer
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+			columns["payload"]->read(row, frag.headerBegin(), thisRowSize);
 
-		TLOG(8) << "readNextEvent: First words of Payload: 0x" << std::hex << payloadvec[0] << " 0x" << std::hex << payloadvec[1] << " 0x" << std::hex << payloadvec[2] << " 0x" << std::hex << payloadvec[3] << " 0x" << std::hex << payloadvec[4];
-		TLOG(8) << "readNextEvent: First words of Fragment: 0x" << std::hex << *frag.headerBegin() << " 0x" << std::hex << *(frag.headerBegin() + 1) << " 0x" << std::hex << *(frag.headerBegin() + 2) << " 0x" << std::hex << *(frag.headerBegin() + 3) << " 0x" << std::hex << *(frag.headerBegin() + 4);
+			TLOG(8) << "readTableRows_: First words of Fragment: 0x" << std::hex << *frag.headerBegin() << " 0x" << std::hex << *(frag.headerBegin() + 1) << " 0x" << std::hex << *(frag.headerBegin() + 2) << " 0x" << std::hex << *(frag.headerBegin() + 3) << " 0x" << std::hex << *(frag.headerBegin() + 4);
+		}
 
 		while (index + payloadRowSize < size_words)
 		{
-			TLOG(8) << "readNextEvent: Retrieving additional payload row, index of previous row " << index << ", payloadRowSize " << payloadRowSize << ", fragment size words " << size_words;
-			fragmentIndex_++;
-			index = fragment_datasets_["index"]->readOne<size_t>(fragmentIndex_);
-			payloadvec = fragment_datasets_["payload"]->read<artdaq::RawDataType>(fragmentIndex_);
+			TLOG(8) << "readTableRows_: Retrieving additional payload row, index of previous row " << index << ", payloadRowSize " << payloadRowSize << ", fragment size words " << size_words;
+			row++;
+			index = columns["index"]->readOne<size_t>(row);
 
 			auto thisRowSize = index + payloadRowSize < size_words ? payloadRowSize : size_words - index;
-			memcpy(frag.headerBegin() + index, &(payloadvec[0]), thisRowSize * sizeof(artdaq::RawDataType));
+			if (useChunkReader)
+			{
+				payloadRows.push_back(PayloadRow{type, output[type]->size() - 1, row, index, thisRowSize});
+			}
+			else
+			{
+				ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+				columns["payload"]->read(row, frag.headerBegin() + index, thisRowSize);
+			}
 		}
 
-		if (output.count(type) == 0u)
+		TLOG(8) << "readTableRows_: Added Fragment to event map; type=" << type << ", frag size " << frag.size();
+
+		row++;
+	}
+
+	if (!payloadRows.empty())
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+		auto const& payload = columns["payload"]->getDataset();
+		for (auto const& payloadRow : payloadRows)
 		{
-			output[type] = std::make_unique<artdaq::Fragments>();
+			auto& frag = (*output[payloadRow.type])[payloadRow.fragment];
+			chunkReader_->add(payload, payloadRow.row, 1, 0, payloadRow.words, frag.headerBegin() + payloadRow.offset);
 		}
-		TLOG(8) << "readNextEvent: Adding Fragment to event map; type=" << type << ", frag size " << frag.size();
-		output[type]->push_back(frag);
+		chunkReader_->execute();
+	}
+	for (auto const& checksum : checksums)
+	{
+		verifyChecksum_((*output[std::get<0>(checksum)])[std::get<1>(checksum)], std::get<2>(checksum));
+	}
+}
+
+std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveNtupleDataset::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
+{
+	TLOG(TLVL_TRACE) << "getEventHeader BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::GetEventHeader));
+	auto const& headers = loadEventHeaders_();
 
-		fragmentIndex_++;
+	TLOG(9) << "getEventHeader: Searching for matching header";
+	auto it = std::lower_bound(headers.begin(), headers.end(), seqID, [](artdaq::detail::RawEventHeader const& hdr, artdaq::Fragment::sequence_id_t id) { return hdr.sequence_id < id; });
+	if (it == headers.end() || it->sequence_id != seqID)
+	{
+		return nullptr;
 	}
 
-	TLOG(TLVL_TRACE) << "readNextEvent END output.size() = " << output.size();
+	TLOG(TLVL_TRACE) << "getEventHeader END";
+	return std::make_unique<artdaq::detail::RawEventHeader>(*it);
+}
+
+std::vector<artdaq::detail::RawEventHeader> const& artdaq::hdf5::HighFiveNtupleDataset::loadEventHeaders_()
+{
+	if (eventHeaders_) return *eventHeaders_;
+
+	eventHeaders_ = std::make_unique<std::vector<artdaq::detail::RawEventHeader>>();
+	if (!file_->exist("/EventHeaders")) return *eventHeaders_;
+
+	auto headerGroup = file_->getGroup("/EventHeaders");
+	if (HighFiveEventHeaderTable::exists(headerGroup))
+	{
+		*eventHeaders_ = HighFiveEventHeaderTable::read(headerGroup);
+	}
+	else
+	{
+		// Files written before the EventHeaders table have one column per header field
+		TLOG(TLVL_DEBUG) << "loadEventHeaders_: Reading per-field EventHeaders columns";
+		auto seqIDs = HighFiveDatasetHelper(headerGroup.getDataSet("sequenceID")).readColumn<uint64_t>();
+		auto runIDs = HighFiveDatasetHelper(headerGroup.getDataSet("run_id")).readColumn<uint32_t>();
+		auto subrunIDs = HighFiveDatasetHelper(headerGroup.getDataSet("subrun_id")).readColumn<uint32_t>();
+		auto eventIDs = HighFiveDatasetHelper(headerGroup.getDataSet("event_id")).readColumn<uint32_t>();
+		auto timestamps = HighFiveDatasetHelper(headerGroup.getDataSet("timestamp")).readColumn<uint64_t>();
+		auto isCompletes = HighFiveDatasetHelper(headerGroup.getDataSet("is_complete")).readColumn<uint8_t>();
+
+		// A file closed while a header was being written can have columns of different lengths
+		auto rows = std::min({seqIDs.size(), runIDs.size(), subrunIDs.size(), eventIDs.size(), timestamps.size(), isCompletes.size()});
+		eventHeaders_->reserve(rows);
+		for (size_t ii = 0; ii < rows; ++ii)
+		{
+			// Rows past the last written header are zero-filled
+			if (seqIDs[ii] == 0) continue;
+
+			eventHeaders_->emplace_back(runIDs[ii], subrunIDs[ii], eventIDs[ii], seqIDs[ii], timestamps[ii]);
+			eventHeaders_->back().is_complete = isCompletes[ii] != 0u;
+		}
+	}
+
+	std::stable_sort(eventHeaders_->begin(), eventHeaders_->end(), [](artdaq::detail::RawEventHeader const& a, artdaq::detail::RawEventHeader const& b) { return a.sequence_id < b.sequence_id; });
+	TLOG(TLVL_DEBUG) << "loadEventHeaders_: " << eventHeaders_->size() << " event headers in memory";
+	return *eventHeaders_;
+}
+
+std::vector<artdaq::hdf5::FragmentDatasetEventSummary> artdaq::hdf5::HighFiveNtupleDataset::scanEvents()
+{
+	TLOG(TLVL_TRACE) << "scanEvents BEGIN";
+	std::map<artdaq::Fragment::sequence_id_t, FragmentDatasetEventSummary> events;
+
+	TLOG(10) << "scanEvents: Reading EventHeaders table";
+	for (auto const& hdr : loadEventHeaders_())
+	{
+		auto& evt = events[hdr.sequence_id];
+		evt.sequence_id = hdr.sequence_id;
+		evt.run_id = hdr.run_id;
+		evt.subrun_id = hdr.subrun_id;
+		evt.event_id = hdr.event_id;
+		evt.timestamp = hdr.timestamp;
+		evt.is_complete = hdr.is_complete;
+		evt.has_header = true;
+	}
+
+	for (auto& table : tables_)
+	{
+		TLOG(10) << "scanEvents: Reading Fragments columns of table " << table->name;
+		auto const& fragSeqIDs = tableSequenceIDs_(*table);
+		auto types = table->columns["type"]->readColumn<uint8_t>();
+		auto sizes = table->columns["size"]->readColumn<uint64_t>();
+		auto indices = table->columns["index"]->readColumn<uint64_t>();
+
+		for (size_t ii = 0; ii < fragSeqIDs.size(); ++ii)
+		{
+			// Only the first row of each Fragment is counted, and zero-filled rows are skipped
+			if (fragSeqIDs[ii] == 0 || indices[ii] != 0) continue;
+
+			auto& evt = events[fragSeqIDs[ii]];
+			evt.sequence_id = fragSeqIDs[ii];
+			auto& typeSummary = evt.fragment_types[types[ii]];
+			typeSummary.count++;
+			typeSummary.bytes += sizes[ii] * sizeof(artdaq::RawDataType);
+		}
+	}
+
+	std::vector<FragmentDatasetEventSummary> output;
+	output.reserve(events.size());
+	for (auto& evt : events)
+	{
+		output.push_back(std::move(evt.second));
+	}
+
+	TLOG(TLVL_TRACE) << "scanEvents END output.size() = " << output.size();
 	return output;
 }
 
-std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveNtupleDataset::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
+size_t artdaq::hdf5::HighFiveNtupleDataset::getFileSize()
 {
-	TLOG(TLVL_TRACE) << "getEventHeader BEGIN";
-	artdaq::Fragment::sequence_id_t sequence_id = 0;
-	auto numHeaders = event_datasets_["sequenceID"]->getDatasetSize();
+	return getHDF5FileSize(file_.get());
+}
 
-	TLOG(9) << "getEventHeader: Searching for matching header row";
-	while (sequence_id != seqID && headerIndex_ < numHeaders)
+size_t artdaq::hdf5::HighFiveNtupleDataset::getDatasetExtensionCount()
+{
+	size_t count = 0;
+	for (auto const& table : tables_)
 	{
-		sequence_id = event_datasets_["sequenceID"]->readOne<uint64_t>(headerIndex_);
-		if (sequence_id != seqID)
+		for (auto const& dataset : table->columns)
+		{
+			count += dataset.second->getResizeCount();
+		}
+		if (table->payloadWriter)
 		{
-			headerIndex_++;
+			count += table->payloadWriter->getResizeCount();
 		}
 	}
+	if (headerTable_)
+	{
+		count += headerTable_->getResizeCount();
+	}
+	if (timeIndex_)
+	{
+		count += timeIndex_->getResizeCount();
+	}
+	return count;
+}
 
-	if (headerIndex_ >= numHeaders)
+std::vector<artdaq::hdf5::FragmentTimeIndexEntry> artdaq::hdf5::HighFiveNtupleDataset::getTimeIndex()
+{
+	if (!timeIndexEntries_)
 	{
-		return nullptr;
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+		timeIndexEntries_ = std::make_unique<std::vector<FragmentTimeIndexEntry>>(HighFiveTimeIndex::read(*file_));
 	}
+	return *timeIndexEntries_;
+}
 
-	TLOG(9) << "getEventHeader: Matching header found. Populating output";
-	auto runID = event_datasets_["run_id"]->readOne<uint32_t>(headerIndex_);
-	auto subrunID = event_datasets_["subrun_id"]->readOne<uint32_t>(headerIndex_);
-	auto eventID = event_datasets_["event_id"]->readOne<uint32_t>(headerIndex_);
-	auto timestamp = event_datasets_["timestamp"]->readOne<uint64_t>(headerIndex_);
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveNtupleDataset::readEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	TLOG(TLVL_TRACE) << "readEvent BEGIN seqID=" << seqID;
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
+	if (seqID == 0)
+	{
+		TLOG(TLVL_ERROR) << "readEvent: Sequence ID 0 is not a valid event";
+		return output;
+	}
 
-	artdaq::detail::RawEventHeader hdr(runID, subrunID, eventID, sequence_id, timestamp);
-	hdr.is_complete = (event_datasets_["is_complete"]->readOne<uint8_t>(headerIndex_) != 0u);
+	// The rows are read from a copy of each table's position, so that readNextEvent is not affected
+	for (auto& table : tables_)
+	{
+		auto const& sequenceIDs = tableSequenceIDs_(*table);
+		auto first = std::find(sequenceIDs.begin(), sequenceIDs.end(), seqID);
+		if (first == sequenceIDs.end()) continue;
 
-	TLOG(TLVL_TRACE) << "getEventHeader END";
-	return std::make_unique<artdaq::detail::RawEventHeader>(hdr);
+		auto row = static_cast<size_t>(std::distance(sequenceIDs.begin(), first));
+		readTableRows_(*table, row, seqID, output);
+	}
+	if (output.empty())
+	{
+		TLOG(TLVL_ERROR) << "readEvent: Sequence ID " << seqID << " not found in input file!";
+		return output;
+	}
+	recordFragmentCounts_(output);
+
+	TLOG(TLVL_TRACE) << "readEvent END output.size() = " << output.size();
+	return output;
 }
 
 DEFINE_ARTDAQ_DATASET_PLUGIN(artdaq::hdf5::HighFiveNtupleDataset)
@@ -0,0 +1,703 @@
+#include "tracemf.h"
+#define TRACE_NAME "HighFiveStreamDataset"
+#define TLVL_INSERTONE 6
+#define TLVL_INSERTHEADER 7
+#define TLVL_READNEXTEVENT 10
+#define TLVL_READNEXTEVENT_V 11
+#define TLVL_OPENSOURCES 12
+#define TLVL_GETEVENTHEADER 14
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveChunkReader.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveChunkWriter.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveFileProfile.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveTimeIndex.hh"
+
+namespace artdaq {
+namespace hdf5 {
+/**
+ * @brief A FragmentDataset implementation which appends the data of each Fragment source to its own dataset
+ *
+ * Each source, identified by (Fragment type, Fragment ID), gets a group "/Sources/<instance name>/Fragment_<id>" containing:
+ * "data": A chunked, extendable dataset holding every Fragment from that source (header included), concatenated in the order they were written.
+ *   Its extent grows a whole number of chunks at a time (geometrically with fileProfile.extentGrowthFactor), and is trimmed
+ *   to the words written, which are also stored in its "rowCount" attribute, when the file is closed.
+ * "index": A table with one row per Fragment: sequence ID, offset (words) into "data", length (words), timestamp
+ * Event headers are stored in the "/EventHeaders/headers" table (sequence ID, run, subrun, event, timestamp, is_complete).
+ *
+ * The data of one readout link for a whole run can therefore be read with a single sequential read of its "data" dataset,
+ * while the event reader uses the indices to reassemble events. Unused rows at the end of the index tables are zero-filled.
+ * If two Fragment types share an instance name, the source group of the second type with the same Fragment ID is named
+ * "Fragment_<id>_Type_<type>"; readers identify sources by their "fragment_type" attribute.
+ * Unless disabled, the "time_index" dataset (see HighFiveTimeIndex) is also written, for readTimeRange.
+ */
+class HighFiveStreamDataset : public FragmentDataset
+{
+public:
+	/**
+	 * @brief HighFiveStreamDataset Constructor
+	 * @param ps ParameterSet used to configure HighFiveStreamDataset
+	 *
+	 * HighFiveStreamDataset accepts the following Parameters:
+	 * "fileName" (REQUIRED): File name to use
+	 * "mode" (Default: "write"): Mode string to use for this FragmentDataset
+	 * "dataChunkWords" (Default: 65536): Size of the chunks of each source's data dataset, in words
+	 * "indexChunkSize" (Default: 128): Size of the chunks of the index and event header tables, in rows
+	 * "fileProfile" (Default: {}): HDF5 file and dataset property settings, see HighFiveFileProfile
+	 * "writeTimeIndex" (Default: true): Whether to write the "time_index" dataset (see HighFiveTimeIndex) used by readTimeRange
+	 * "compressionThreads" (Default: 0): When writing, number of threads used to deflate source data (see
+	 *   HighFiveChunkWriter). Requires fileProfile.deflateLevel; 0 compresses in H5Dwrite, on the calling thread.
+	 * "compressionQueueChunks" (Default: 2 * compressionThreads): Chunks of each source which may wait for compression
+	 * "decompressionThreads" (Default: 0): When reading, number of threads used to inflate deflate-compressed source data
+	 *   (see HighFiveChunkReader). 0 reads through H5Dread, which decompresses on the calling thread.
+	 *
+	 * With writeChecksums (see FragmentDataset), each source also gets a "checksums" table, with one row per index row.
+	 */
+	HighFiveStreamDataset(fhicl::ParameterSet const& ps);
+	/**
+	 * @brief HighFiveStreamDataset Destructor
+	 */
+	~HighFiveStreamDataset() noexcept override;
+
+	/**
+	 * @brief Insert a Fragment into the Dataset (write it to the HDF5 file)
+	 * @param frag Fragment to insert
+	 *
+	 * The Fragment is appended to the data dataset of its source, and a row is added to the source's index.
+	 */
+	void insertOne(artdaq::Fragment const& frag) override;
+	/**
+	 * @brief Insert a RawEventHeader into the Dataset (write it to the HDF5 file)
+	 * @param hdr RawEventHeader to insert
+	 */
+	void insertHeader(artdaq::detail::RawEventHeader const& hdr) override;
+	/**
+	 * @brief Read the next event from the Dataset (HDF5 file)
+	 * @returns A Map of Fragment::type_t and pointers to Fragments, suitable for ArtdaqInput
+	 *
+	 * Events are returned in order of sequence ID. Each Fragment is read directly from its source's data dataset into the output Fragment.
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readNextEvent() override;
+	/**
+	 * @brief Read a RawEventHeader from the Dataset (HDF5 file)
+	 * @param seqID Sequence ID of the RawEventHeader (should be equivalent to event number)
+	 * @return Pointer to a RawEventHeader if a match was found in the Dataset, nullptr otherwise
+	 */
+	std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const& seqID) override;
+	/**
+	 * @brief Produce a summary of every event in the Dataset without reading Fragment payloads
+	 * @return One FragmentDatasetEventSummary per event, ordered by sequence ID
+	 *
+	 * The summary is built from the source indices and the event header table, which are read when the file is opened.
+	 */
+	std::vector<FragmentDatasetEventSummary> scanEvents() override;
+	/**
+	 * @brief Get the current size of the HDF5 file
+	 * @return Size of the file, in bytes, as reported by H5Fget_filesize
+	 */
+	size_t getFileSize() override;
+	/**
+	 * @brief Get the number of times the source datasets and tables have been extended
+	 * @return Number of dataset extensions since the file was opened
+	 */
+	size_t getDatasetExtensionCount() override;
+	/**
+	 * @brief Read the time index of the file
+	 * @return One FragmentTimeIndexEntry per Fragment, read from the "time_index" dataset when first requested
+	 */
+	std::vector<FragmentTimeIndexEntry> getTimeIndex() override;
+	/**
+	 * @brief Read a single event from the file, without changing the position of readNextEvent
+	 * @param seqID Sequence ID of the event to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, empty if the event was not found
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readEvent(artdaq::Fragment::sequence_id_t seqID) override;
+	/**
+	 * @brief Read the Fragments of one event which are listed in the time index
+	 * @param seqID Sequence ID of the event to read
+	 * @param entries Time index entries (of event seqID) of the Fragments to read
+	 * @return A Map of Fragment::type_t and pointers to Fragments, holding only the Fragments listed in entries
+	 *
+	 * Only the listed Fragments are read from their sources, so readTimeRange does not read the rest of the event.
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readIndexedFragments(artdaq::Fragment::sequence_id_t seqID, std::vector<FragmentTimeIndexEntry> const& entries) override;
+
+private:
+	HighFiveStreamDataset(HighFiveStreamDataset const&) = delete;
+	HighFiveStreamDataset(HighFiveStreamDataset&&) = delete;
+	HighFiveStreamDataset& operator=(HighFiveStreamDataset const&) = delete;
+	HighFiveStreamDataset& operator=(HighFiveStreamDataset&&) = delete;
+
+	/// Columns of each source's "index" table
+	enum IndexColumn : size_t
+	{
+		IC_SequenceID,
+		IC_Offset,
+		IC_Length,
+		IC_Timestamp,
+		IndexColumns
+	};
+	/// Columns of the "/EventHeaders/headers" table
+	enum HeaderColumn : size_t
+	{
+		HC_SequenceID,
+		HC_RunID,
+		HC_SubrunID,
+		HC_EventID,
+		HC_Timestamp,
+		HC_IsComplete,
+		HeaderColumns
+	};
+
+	/// Append stream of a single Fragment source
+	struct Source
+	{
+		Source(HighFive::DataSet const& data_dataset, size_t data_size, std::unique_ptr<HighFiveDatasetHelper> index_helper, artdaq::Fragment::type_t fragment_type, artdaq::Fragment::fragment_id_t fragment_id)
+		    : data(data_dataset), size(data_size), extent(data_dataset.getDimensions()[0]), index(std::move(index_helper)), type(fragment_type), fragmentID(fragment_id), parallelRead(false) {}
+
+		HighFive::DataSet data;                         ///< Concatenated Fragments of this source
+		size_t size;                                    ///< Number of words written to data
+		size_t extent;                                  ///< Current extent of data, in words (write mode only)
+		std::unique_ptr<HighFiveDatasetHelper> index;   ///< Index table of this source (write mode only)
+		std::unique_ptr<HighFiveChunkWriter> writer;    ///< Parallel-compression writer of data (write mode only)
+		std::unique_ptr<HighFiveDatasetHelper> checksums;  ///< Checksum table of this source (write mode, with writeChecksums)
+		artdaq::Fragment::type_t type;                  ///< Fragment type of this source
+		artdaq::Fragment::fragment_id_t fragmentID;     ///< Fragment ID of this source
+		bool parallelRead;                              ///< Whether data is read with the HighFiveChunkReader (read mode only)
+	};
+	/// Location of one Fragment in the file (read mode)
+	struct FragmentLocation
+	{
+		size_t source;      ///< Index into sources_
+		uint64_t offset;    ///< Offset into the source's data, in words
+		uint64_t length;    ///< Length of the Fragment, in words
+		bool hasChecksum;   ///< Whether the Fragment is verified against checksum
+		uint32_t checksum;  ///< Stored checksum of the Fragment
+	};
+
+	std::unique_ptr<HighFive::File> file_;
+	HighFiveCoreSpill coreSpill_;
+	size_t dataChunkWords_;
+	size_t indexChunkSize_;
+	double extentGrowthFactor_;
+	HighFive::DataSetCreateProps dataCProps_;
+	HighFive::DataSetCreateProps indexCProps_;
+	size_t resizeCount_;
+	size_t compressionQueueChunks_;
+	std::unique_ptr<HighFiveWorkerPool> compressionPool_;
+
+	std::map<std::pair<artdaq::Fragment::type_t, artdaq::Fragment::fragment_id_t>, size_t> sourceIndex_;
+	std::vector<Source> sources_;
+	std::unique_ptr<HighFiveDatasetHelper> headers_;
+	std::unique_ptr<HighFiveTimeIndex> timeIndex_;
+	std::unique_ptr<HighFiveChunkReader> chunkReader_;
+	std::unique_ptr<std::vector<FragmentTimeIndexEntry>> timeIndexEntries_;
+
+	std::map<artdaq::Fragment::sequence_id_t, std::vector<FragmentLocation>> events_;
+	std::map<artdaq::Fragment::sequence_id_t, std::array<uint64_t, HeaderColumns>> eventHeaders_;
+	std::map<artdaq::Fragment::sequence_id_t, std::vector<FragmentLocation>>::const_iterator nextEvent_;
+
+	Source& getSource_(artdaq::Fragment const& frag);
+	void growData_(Source& source, size_t words);
+	void openSources_();
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readLocations_(std::vector<FragmentLocation> const& locations);
+	static std::vector<uint64_t> readTable_(HighFive::DataSet const& dataset);
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+artdaq::hdf5::HighFiveStreamDataset::HighFiveStreamDataset(fhicl::ParameterSet const& ps)
+    : FragmentDataset(ps, ps.get<std::string>("mode", "write"))
+    , file_(nullptr)
+    , dataChunkWords_(ps.get<size_t>("dataChunkWords", 65536))
+    , indexChunkSize_(ps.get<size_t>("indexChunkSize", 128))
+    , extentGrowthFactor_(1.0)
+    , resizeCount_(0)
+    , compressionQueueChunks_(0)
+{
+	TLOG(TLVL_DEBUG) << "HighFiveStreamDataset CONSTRUCTOR BEGIN";
+	if (dataChunkWords_ == 0) dataChunkWords_ = 65536;
+	if (indexChunkSize_ == 0) indexChunkSize_ = 128;
+
+	HighFiveFileProfile fileProfile(ps);
+	file_ = fileProfile.openFile(ps.get<std::string>("fileName"), mode_);
+	if (mode_ == FragmentDatasetMode::Write)
+	{
+		dataCProps_.add(HighFive::Chunking(std::vector<hsize_t>{dataChunkWords_, 1}));
+		indexCProps_.add(HighFive::Chunking(std::vector<hsize_t>{indexChunkSize_, IndexColumns}));
+		fileProfile.applyTo(dataCProps_);
+		fileProfile.applyTo(indexCProps_);
+		coreSpill_ = HighFiveCoreSpill(*file_, fileProfile.coreSpillSize());
+		extentGrowthFactor_ = fileProfile.extentGrowthFactor();
+
+		auto compressionThreads = ps.get<size_t>("compressionThreads", 0);
+		if (compressionThreads > 0)
+		{
+			compressionPool_ = std::make_unique<HighFiveWorkerPool>(compressionThreads);
+			compressionQueueChunks_ = ps.get<size_t>("compressionQueueChunks", 2 * compressionThreads);
+		}
+
+		file_->createGroup("/Sources");
+		auto headerGroup = file_->createGroup("/EventHeaders");
+		HighFive::DataSetCreateProps headerCProps;
+		headerCProps.add(HighFive::Chunking(std::vector<hsize_t>{indexChunkSize_, HeaderColumns}));
+		fileProfile.applyTo(headerCProps);
+		headers_ = std::make_unique<HighFiveDatasetHelper>(headerGroup.createDataSet<uint64_t>("headers", HighFive::DataSpace({0, HeaderColumns}, {HighFive::DataSpace::UNLIMITED, HeaderColumns}), headerCProps), indexChunkSize_);
+		headers_->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+		headers_->setExtentGrowth(extentGrowthFactor_);
+
+		if (ps.get<bool>("writeTimeIndex", true))
+		{
+			HighFive::DataSetCreateProps timeIndexCProps;
+			fileProfile.applyTo(timeIndexCProps);
+			timeIndex_ = HighFiveTimeIndex::create(*file_, indexChunkSize_, timeIndexCProps);
+			timeIndex_->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+			timeIndex_->setExtentGrowth(extentGrowthFactor_);
+		}
+	}
+	else
+	{
+		auto decompressionThreads = ps.get<size_t>("decompressionThreads", 0);
+		if (decompressionThreads > 0)
+		{
+			chunkReader_ = std::make_unique<HighFiveChunkReader>(decompressionThreads);
+		}
+		openSources_();
+	}
+	nextEvent_ = events_.begin();
+
+	TLOG(TLVL_DEBUG) << "HighFiveStreamDataset CONSTRUCTOR END";
+}
+
+artdaq::hdf5::HighFiveStreamDataset::~HighFiveStreamDataset() noexcept
+{
+	TLOG(TLVL_DEBUG) << "~HighFiveStreamDataset BEGIN";
+	for (auto& source : sources_)
+	{
+		if (!source.index) continue;  // Read mode
+		try
+		{
+			if (source.writer)
+			{
+				// The writer trims the extent and stores the row count itself
+				source.writer->flush();
+				continue;
+			}
+			if (source.extent != source.size)
+			{
+				source.data.resize({source.size, 1});
+				source.extent = source.size;
+			}
+			HighFiveDatasetHelper::writeRowCount(source.data, source.size);
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG(TLVL_ERROR) << "~HighFiveStreamDataset: Error trimming source data: " << ex.what();
+		}
+	}
+	TLOG(TLVL_DEBUG) << "~HighFiveStreamDataset END";
+}
+
+void artdaq::hdf5::HighFiveStreamDataset::insertOne(artdaq::Fragment const& frag)
+{
+	TLOG(TLVL_TRACE) << "insertOne BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertOne));
+	auto& source = getSource_(frag);
+	auto offset = source.size;
+	auto length = frag.size();
+
+	TLOG(TLVL_INSERTONE) << "insertOne: Appending Fragment " << frag.fragmentID() << " of event " << frag.sequenceID() << " at offset " << offset << ", length " << length;
+	if (source.writer)
+	{
+		// Completed chunks are compressed on the worker pool and written by the HighFiveChunkWriter, which also extends the dataset
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+		source.writer->write(frag.headerBegin(), length);
+	}
+	else
+	{
+		if (offset + length > source.extent)
+		{
+			growData_(source, offset + length);
+		}
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WritePayload));
+		source.data.select({offset, 0}, {length, 1}).write(frag.headerBegin());
+	}
+	source.size += length;
+
+	std::array<uint64_t, IndexColumns> row{frag.sequenceID(), offset, length, frag.timestamp()};
+	source.index->write(row.data(), IndexColumns);
+	if (source.checksums)
+	{
+		source.checksums->write(fragmentChecksum(frag));
+	}
+	if (timeIndex_)
+	{
+		timeIndex_->write(makeTimeIndexEntry_(frag));
+	}
+	TLOG(TLVL_TRACE) << "insertOne END";
+}
+
+void artdaq::hdf5::HighFiveStreamDataset::insertHeader(artdaq::detail::RawEventHeader const& hdr)
+{
+	TLOG(TLVL_TRACE) << "insertHeader BEGIN";
+	coreSpill_.check();
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertHeader));
+	TLOG(TLVL_INSERTHEADER) << "insertHeader: Writing header for event " << hdr.sequence_id;
+	std::array<uint64_t, HeaderColumns> row{hdr.sequence_id, hdr.run_id, hdr.subrun_id, hdr.event_id, hdr.timestamp, hdr.is_complete ? 1ul : 0ul};
+	headers_->write(row.data(), HeaderColumns);
+	TLOG(TLVL_TRACE) << "insertHeader END";
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveStreamDataset::readNextEvent()
+{
+	TLOG(TLVL_DEBUG) << "readNextEvent BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
+
+	if (nextEvent_ == events_.end())
+	{
+		TLOG(TLVL_INFO) << "readNextEvent: No more events in file!";
+		return output;
+	}
+
+	TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading event " << nextEvent_->first << " with " << nextEvent_->second.size() << " Fragments";
+	output = readLocations_(nextEvent_->second);
+	++nextEvent_;
+
+	recordFragmentCounts_(output);
+
+	TLOG(TLVL_DEBUG) << "readNextEvent END output.size() = " << output.size();
+	return output;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveStreamDataset::readEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	TLOG(TLVL_DEBUG) << "readEvent BEGIN seqID=" << seqID;
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
+	auto event = events_.find(seqID);
+	if (event == events_.end())
+	{
+		TLOG(TLVL_ERROR) << "readEvent: Sequence ID " << seqID << " not found in input file!";
+		return std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>();
+	}
+
+	auto output = readLocations_(event->second);
+	TLOG(TLVL_DEBUG) << "readEvent END output.size() = " << output.size();
+	return output;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveStreamDataset::readIndexedFragments(artdaq::Fragment::sequence_id_t seqID, std::vector<FragmentTimeIndexEntry> const& entries)
+{
+	TLOG(TLVL_DEBUG) << "readIndexedFragments BEGIN seqID=" << seqID << ", " << entries.size() << " Fragments";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
+	auto event = events_.find(seqID);
+	if (event == events_.end())
+	{
+		TLOG(TLVL_ERROR) << "readIndexedFragments: Sequence ID " << seqID << " not found in input file!";
+		return std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>();
+	}
+
+	std::vector<FragmentLocation> locations;
+	for (auto const& location : event->second)
+	{
+		auto const& source = sources_[location.source];
+		if (std::any_of(entries.begin(), entries.end(), [&](FragmentTimeIndexEntry const& e) { return e.type == source.type && e.fragment_id == source.fragmentID; }))
+		{
+			locations.push_back(location);
+		}
+	}
+
+	auto output = readLocations_(locations);
+	TLOG(TLVL_DEBUG) << "readIndexedFragments END output.size() = " << output.size();
+	return output;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveStreamDataset::readLocations_(std::vector<FragmentLocation> const& locations)
+{
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
+	for (auto const& location : locations)
+	{
+		auto& source = sources_[location.source];
+		if (output.count(source.type) == 0u)
+		{
+			output[source.type] = makeFragments_(source.type);
+		}
+
+		// Construct the Fragment in place in the output vector and read the stored words (header included) directly into it
+		output[source.type]->emplace_back(location.length - artdaq::detail::RawFragmentHeader::num_words());
+		if (!chunkReader_ || !source.parallelRead)
+		{
+			auto& frag = output[source.type]->back();
+			TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Reading " << location.length << " words at offset " << location.offset;
+			ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+			source.data.select({location.offset, 0}, {location.length, 1}).read(frag.headerAddress());
+		}
+	}
+	if (chunkReader_)
+	{
+		// Compressed sources are read once all output Fragments exist, so that the destinations no longer move, and their chunks are inflated in parallel
+		std::unordered_map<artdaq::Fragment::type_t, size_t> fragmentIndex;
+		for (auto const& location : locations)
+		{
+			auto& source = sources_[location.source];
+			auto& frag = (*output[source.type])[fragmentIndex[source.type]++];
+			if (source.parallelRead)
+			{
+				TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Queueing read of " << location.length << " words at offset " << location.offset;
+				chunkReader_->add(source.data, location.offset, location.length, 0, 1, frag.headerAddress());
+			}
+		}
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadPayload));
+		chunkReader_->execute();
+	}
+
+	if (verifyingChecksums_())
+	{
+		std::unordered_map<artdaq::Fragment::type_t, size_t> fragmentIndex;
+		for (auto const& location : locations)
+		{
+			auto type = sources_[location.source].type;
+			auto& frag = (*output[type])[fragmentIndex[type]++];
+			if (location.hasChecksum)
+			{
+				verifyChecksum_(frag, location.checksum);
+			}
+		}
+	}
+	return output;
+}
+
+std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveStreamDataset::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
+{
+	TLOG(TLVL_TRACE) << "GetEventHeader BEGIN seqID=" << seqID;
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::GetEventHeader));
+	auto it = eventHeaders_.find(seqID);
+	if (it == eventHeaders_.end())
+	{
+		TLOG(TLVL_ERROR) << "Sequence ID " << seqID << " not found in input file!";
+		return nullptr;
+	}
+
+	auto const& row = it->second;
+	TLOG(TLVL_GETEVENTHEADER) << "Creating EventHeader with runID " << row[HC_RunID] << ", subrunID " << row[HC_SubrunID] << ", eventID " << row[HC_EventID] << " (seqID " << seqID << ")";
+	artdaq::detail::RawEventHeader hdr(static_cast<uint32_t>(row[HC_RunID]), static_cast<uint32_t>(row[HC_SubrunID]), static_cast<uint32_t>(row[HC_EventID]), seqID, row[HC_Timestamp]);
+	hdr.is_complete = row[HC_IsComplete] != 0;
+
+	TLOG(TLVL_TRACE) << "GetEventHeader END";
+	return std::make_unique<artdaq::detail::RawEventHeader>(hdr);
+}
+
+std::vector<artdaq::hdf5::FragmentDatasetEventSummary> artdaq::hdf5::HighFiveStreamDataset::scanEvents()
+{
+	TLOG(TLVL_TRACE) << "scanEvents BEGIN";
+	std::map<artdaq::Fragment::sequence_id_t, FragmentDatasetEventSummary> events;
+
+	for (auto const& header : eventHeaders_)
+	{
+		auto& evt = events[header.first];
+		evt.sequence_id = header.first;
+		evt.run_id = static_cast<uint32_t>(header.second[HC_RunID]);
+		evt.subrun_id = static_cast<uint32_t>(header.second[HC_SubrunID]);
+		evt.event_id = static_cast<uint32_t>(header.second[HC_EventID]);
+		evt.timestamp = header.second[HC_Timestamp];
+		evt.is_complete = header.second[HC_IsComplete] != 0;
+		evt.has_header = true;
+	}
+
+	for (auto const& event : events_)
+	{
+		auto& evt = events[event.first];
+		evt.sequence_id = event.first;
+		for (auto const& location : event.second)
+		{
+			auto& typeSummary = evt.fragment_types[sources_[location.source].type];
+			typeSummary.count++;
+			typeSummary.bytes += location.length * sizeof(artdaq::RawDataType);
+		}
+	}
+
+	std::vector<FragmentDatasetEventSummary> output;
+	output.reserve(events.size());
+	for (auto& evt : events)
+	{
+		output.push_back(std::move(evt.second));
+	}
+
+	TLOG(TLVL_TRACE) << "scanEvents END output.size() = " << output.size();
+	return output;
+}
+
+size_t artdaq::hdf5::HighFiveStreamDataset::getFileSize()
+{
+	return getHDF5FileSize(file_.get());
+}
+
+size_t artdaq::hdf5::HighFiveStreamDataset::getDatasetExtensionCount()
+{
+	size_t count = resizeCount_;
+	for (auto const& source : sources_)
+	{
+		if (source.index) count += source.index->getResizeCount();
+		if (source.checksums) count += source.checksums->getResizeCount();
+		if (source.writer) count += source.writer->getResizeCount();
+	}
+	if (headers_) count += headers_->getResizeCount();
+	if (timeIndex_) count += timeIndex_->getResizeCount();
+	return count;
+}
+
+std::vector<artdaq::hdf5::FragmentTimeIndexEntry> artdaq::hdf5::HighFiveStreamDataset::getTimeIndex()
+{
+	if (!timeIndexEntries_)
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+		timeIndexEntries_ = std::make_unique<std::vector<FragmentTimeIndexEntry>>(HighFiveTimeIndex::read(*file_));
+	}
+	return *timeIndexEntries_;
+}
+
+artdaq::hdf5::HighFiveStreamDataset::Source& artdaq::hdf5::HighFiveStreamDataset::getSource_(artdaq::Fragment const& frag)
+{
+	auto key = std::make_pair(frag.type(), frag.fragmentID());
+	auto it = sourceIndex_.find(key);
+	if (it != sourceIndex_.end())
+	{
+		return sources_[it->second];
+	}
+
+	auto typeName = getInstanceName_(frag);
+	TLOG(TLVL_INSERTONE) << "getSource_: Creating source for Fragment ID " << frag.fragmentID() << " of type " << typeName;
+	auto sourcesGroup = file_->getGroup("/Sources");
+	auto typeGroup = [&] {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+		return sourcesGroup.exist(typeName) ? sourcesGroup.getGroup(typeName) : sourcesGroup.createGroup(typeName);
+	}();
+	auto sourceGroup = [&] {
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateGroup));
+		// Sources are keyed by (type, Fragment ID), but groups by (instance name, Fragment ID): types sharing an instance name get distinct groups
+		auto sourceName = "Fragment_" + std::to_string(frag.fragmentID());
+		if (typeGroup.exist(sourceName)) sourceName += "_Type_" + std::to_string(frag.type());
+		return typeGroup.createGroup(sourceName);
+	}();
+	{
+		ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteAttributes));
+		sourceGroup.createAttribute("fragment_type", frag.type());
+		sourceGroup.createAttribute("fragment_id", frag.fragmentID());
+	}
+
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::CreateDataset));
+	auto data = sourceGroup.createDataSet<artdaq::RawDataType>("data", HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1}), dataCProps_);
+	auto index = std::make_unique<HighFiveDatasetHelper>(sourceGroup.createDataSet<uint64_t>("index", HighFive::DataSpace({0, IndexColumns}, {HighFive::DataSpace::UNLIMITED, IndexColumns}), indexCProps_), indexChunkSize_);
+	index->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+	index->setExtentGrowth(extentGrowthFactor_);
+
+	sourceIndex_[key] = sources_.size();
+	sources_.emplace_back(data, 0, std::move(index), frag.type(), frag.fragmentID());
+	if (checksumsEnabled_())
+	{
+		sources_.back().checksums = std::make_unique<HighFiveDatasetHelper>(sourceGroup.createDataSet<uint32_t>("checksums", HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1}), indexCProps_), indexChunkSize_);
+		sources_.back().checksums->setResizeTiming(timing_(FragmentDatasetOperation::Resize));
+		sources_.back().checksums->setExtentGrowth(extentGrowthFactor_);
+	}
+	if (compressionPool_)
+	{
+		if (HighFiveChunkWriter::supports(data))
+		{
+			sources_.back().writer = std::make_unique<HighFiveChunkWriter>(data, *compressionPool_, compressionQueueChunks_);
+		}
+		else
+		{
+			TLOG(TLVL_WARNING) << "getSource_: compressionThreads is set, but fileProfile.deflateLevel is not; writing " << typeName << " uncompressed";
+		}
+	}
+	return sources_.back();
+}
+
+void artdaq::hdf5::HighFiveStreamDataset::growData_(Source& source, size_t words)
+{
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::Resize));
+	// As in HighFiveDatasetHelper: grow geometrically, to a whole number of chunks and by at least one chunk
+	auto target = std::max(words, static_cast<size_t>(std::ceil(source.extent * extentGrowthFactor_)));
+	target = std::max(target, source.extent + dataChunkWords_);
+	target = ((target + dataChunkWords_ - 1) / dataChunkWords_) * dataChunkWords_;
+
+	TLOG(TLVL_INSERTONE) << "growData_: Growing source data from " << source.extent << " to " << target << " words";
+	source.data.resize({target, 1});
+	source.extent = target;
+	resizeCount_++;
+}
+
+void artdaq::hdf5::HighFiveStreamDataset::openSources_()
+{
+	TLOG(TLVL_TRACE) << "openSources_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadAttributes));
+	auto sourcesGroup = file_->getGroup("/Sources");
+	for (auto& typeName : sourcesGroup.listObjectNames())
+	{
+		auto typeGroup = sourcesGroup.getGroup(typeName);
+		for (auto& sourceName : typeGroup.listObjectNames())
+		{
+			auto sourceGroup = typeGroup.getGroup(sourceName);
+			artdaq::Fragment::type_t type;
+			sourceGroup.getAttribute("fragment_type").read(type);
+			artdaq::Fragment::fragment_id_t fragmentID;
+			sourceGroup.getAttribute("fragment_id").read(fragmentID);
+
+			auto data = sourceGroup.getDataSet("data");
+			auto sourceNumber = sources_.size();
+			sources_.emplace_back(data, HighFiveDatasetHelper::rowCount(data), nullptr, type, fragmentID);
+			sources_.back().parallelRead = chunkReader_ && HighFiveChunkReader::supports(data);
+
+			auto index = readTable_(sourceGroup.getDataSet("index"));
+			std::vector<uint64_t> checksums;
+			if (verifyingChecksums_() && sourceGroup.exist("checksums"))
+			{
+				checksums = readTable_(sourceGroup.getDataSet("checksums"));
+			}
+			TLOG(TLVL_OPENSOURCES) << "openSources_: " << typeName << "/" << sourceName << " has " << index.size() / IndexColumns << " index rows";
+			for (size_t row = 0; row < index.size(); row += IndexColumns)
+			{
+				// Rows past the last written Fragment are zero-filled
+				if (index[row + IC_Length] == 0) continue;
+				if (index[row + IC_Length] < artdaq::detail::RawFragmentHeader::num_words() || index[row + IC_Offset] + index[row + IC_Length] > sources_.back().size)
+				{
+					TLOG(TLVL_ERROR) << "openSources_: Invalid index row " << row / IndexColumns << " in " << typeName << "/" << sourceName << ", skipping";
+					continue;
+				}
+				auto hasChecksum = row / IndexColumns < checksums.size();
+				auto checksum = hasChecksum ? static_cast<uint32_t>(checksums[row / IndexColumns]) : 0;
+				events_[index[row + IC_SequenceID]].push_back(FragmentLocation{sourceNumber, index[row + IC_Offset], index[row + IC_Length], hasChecksum, checksum});
+			}
+		}
+	}
+
+	auto headers = readTable_(file_->getGroup("/EventHeaders").getDataSet("headers"));
+	for (size_t row = 0; row < headers.size(); row += HeaderColumns)
+	{
+		// Rows past the last written header are zero-filled
+		if (headers[row + HC_SequenceID] == 0) continue;
+		auto& cached = eventHeaders_[headers[row + HC_SequenceID]];
+		std::copy(headers.begin() + row, headers.begin() + row + HeaderColumns, cached.begin());
+	}
+	TLOG(TLVL_TRACE) << "openSources_ END: " << sources_.size() << " sources, " << events_.size() << " events";
+}
+
+std::vector<uint64_t> artdaq::hdf5::HighFiveStreamDataset::readTable_(HighFive::DataSet const& dataset)
+{
+	// Rows past the row count of a table closed by HighFiveDatasetHelper are padding
+	auto dims = dataset.getDimensions();
+	auto rows = HighFiveDatasetHelper::rowCount(dataset);
+	std::vector<uint64_t> table(rows * dims[1]);
+	if (!table.empty()) dataset.select({0, 0}, {rows, dims[1]}).read(table.data());
+	return table;
+}
+
+DEFINE_ARTDAQ_DATASET_PLUGIN(artdaq::hdf5::HighFiveStreamDataset)
@@ -15,6 +15,8 @@
 #include "artdaq-core/Utilities/TimeUtils.hh"
 #include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
 #include "artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveFileProfile.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveGroupRegistry.hh"
 
 namespace artdaq {
 namespace hdf5 {
@@ -60,15 +62,21 @@ public:
 	 * @return Pointer to RawEventHeader
 	 */
 	std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const& seqID) override;
+	/**
+	 * @brief Get the current size of the HDF5 file
+	 * @return Size of the file, in bytes, as reported by H5Fget_filesize
+	 */
+	size_t getFileSize() override;
 
 private:
 	std::unique_ptr<HighFive::File> file_;
+	std::unique_ptr<HighFiveGroupRegistry> registry_;
 	size_t eventIndex_;
 	HighFive::DataSetCreateProps fragmentCProps_;
 	HighFive::DataSetAccessProps fragmentAProps_;
 
-	void writeFragment_(HighFive::Group& group, artdaq::Fragment const& frag);
-	artdaq::FragmentPtr readFragment_(HighFive::DataSet const& dataset);
+	void writeFragment_(std::string const& groupPath, artdaq::Fragment const& frag);
+	void readFragment_(HighFive::DataSet const& dataset, artdaq::Fragments& output);
 
 	uint64_t windowOfInterestStart;
 	uint64_t windowOfInterestSize;
@@ -83,16 +91,15 @@ std::string createTimeString(const uint64_t& timeValue);
 }  // namespace artdaq
 
 artdaq::hdf5::HighFiveGeoCmpltPDSPSample::HighFiveGeoCmpltPDSPSample(fhicl::ParameterSet const& ps)
-    : FragmentDataset(ps, ps.get<std::string>("mode", "write")), file_(nullptr), eventIndex_(0)
+    : FragmentDataset(ps, ps.get<std::string>("mode", "write")), file_(nullptr), registry_(nullptr), eventIndex_(0)
 {
 	TLOG(TLVL_DEBUG) << "HighFiveGeoCmpltPDSPSample CONSTRUCTOR BEGIN";
-	if (mode_ == FragmentDatasetMode::Read)
-	{
-		file_.reset(new HighFive::File(ps.get<std::string>("fileName"), HighFive::File::ReadOnly));
-	}
-	else
+	HighFiveFileProfile fileProfile(ps);
+	file_ = fileProfile.openFile(ps.get<std::string>("fileName"), mode_);
+	if (mode_ == FragmentDatasetMode::Write)
 	{
-		file_.reset(new HighFive::File(ps.get<std::string>("fileName"), HighFive::File::OpenOrCreate | HighFive::File::Truncate));
+		fileProfile.applyTo(fragmentCProps_);
+		registry_.reset(new HighFiveGroupRegistry(*file_, ps.get<size_t>("openEventGroups", 4)));
 	}
 
 	windowOfInterestStart = ps.get<uint64_t>("windowOfInterestStart");
@@ -114,13 +121,9 @@ artdaq::hdf5::HighFiveGeoCmpltPDSPSample::~HighFiveGeoCmpltPDSPSample()
 void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertOne(artdaq::Fragment const& frag)
 {
 	TLOG(TLVL_TRACE) << "insertOne BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertOne));
 	uint64_t timeSliceGroupTimeStamp = windowOfInterestStart - outputTimeStampDelta;
-	if (!file_->exist(std::to_string(timeSliceGroupTimeStamp)))
-	{
-		TLOG(TLVL_INSERTONE) << "insertOne: Creating group for windowOfInterest " << timeSliceGroupTimeStamp;
-		file_->createGroup(std::to_string(timeSliceGroupTimeStamp));
-	}
-	auto timeSliceGroup = file_->getGroup(std::to_string(timeSliceGroupTimeStamp));
+	auto eventPath = std::to_string(timeSliceGroupTimeStamp);
 
 	// fragment_type_map: [[1, "MISSED"], [2, "TPC"], [3, "PHOTON"], [4, "TRIGGER"], [5, "TIMING"], [6, "TOY1"], [7, "TOY2"], [8, "FELIX"], [9, "CRT"], [10, "CTB"], [11, "CPUHITS"], [12, "DEVBOARDHITS"], [13, "UNKNOWN"]]
 
@@ -135,26 +138,11 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertOne(artdaq::Fragment const&
 			{
 				TLOG(TLVL_INSERTONE) << "insertOne: Getting Fragment type name";
 				auto fragPtr = cf.at(0);
-				auto typeName = nameHelper_->GetInstanceNameForFragment(*fragPtr).second;
-				if (!timeSliceGroup.exist(typeName))
-				{
-					TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-					timeSliceGroup.createGroup(typeName);
-				}
+				auto typePath = eventPath + "/" + getInstanceName_(*fragPtr);
 
 				TLOG(TLVL_INSERTONE) << "insertOne: Creating group and setting attributes";
-				auto typeGroup = timeSliceGroup.getGroup(typeName);
-				std::string containerName = "Container0";
-
-				int counter = 1;
-				while (typeGroup.exist(containerName))
-				{
-					// TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Duplicate Fragment ID " << frag.fragmentID() << " detected. If this is a ContainerFragment, this is expected, otherwise check configuration!";
-					containerName = "Container" + std::to_string(counter);
-					counter++;
-				}
-
-				auto containerGroup = typeGroup.createGroup(containerName);
+				auto containerPath = typePath + "/" + registry_->uniqueName(typePath, "Container", [](std::string const& base, size_t index) { return base + std::to_string(index); });
+				auto& containerGroup = registry_->getGroup(containerPath);
 				containerGroup.createAttribute("version", frag.version());
 				containerGroup.createAttribute("type", frag.type());
 				containerGroup.createAttribute("sequence_id", frag.sequenceID());
@@ -173,44 +161,30 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertOne(artdaq::Fragment const&
 					{
 						fragPtr = cf.at(ii);
 					}
-					writeFragment_(containerGroup, *fragPtr);
+					writeFragment_(containerPath, *fragPtr);
 				}
 			}
 			else if (cf.block_count() == 1 || cf.fragment_type() == 10)
 			{
 				TLOG(TLVL_INSERTONE) << "insertOne: Getting Fragment type name";
 				auto fragPtr = cf.at(0);
-				auto typeName = nameHelper_->GetInstanceNameForFragment(*fragPtr).second;
-				if (!timeSliceGroup.exist(typeName))
-				{
-					TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-					timeSliceGroup.createGroup(typeName);
-				}
-
-				TLOG(TLVL_INSERTONE) << "insertOne: Creating type group";
-				auto typeGroup = timeSliceGroup.getGroup(typeName);
+				auto typePath = eventPath + "/" + getInstanceName_(*fragPtr);
 				for (size_t ii = 0; ii < cf.block_count(); ++ii)
 				{
 					if (ii != 0)
 					{
 						fragPtr = cf.at(ii);
 					}
-					writeFragment_(typeGroup, *fragPtr);
+					writeFragment_(typePath, *fragPtr);
 				}
 			}
 #if 0
 		else
 		{
 			TLOG(TLVL_INSERTONE) << "insertOne: Writing Empty Container Fragment as standard Fragment";
-			auto typeName = nameHelper_->GetInstanceNameForFragment(frag).second;
-			if (!timeSliceGroup.exist(typeName))
-			{
-				TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-				timeSliceGroup.createGroup(typeName);
-			}
-			auto typeGroup = timeSliceGroup.getGroup(typeName);
+			auto typePath = eventPath + "/" + getInstanceName_(frag);
 
-			writeFragment_(typeGroup, frag);
+			writeFragment_(typePath, frag);
 		}
 #endif
 		}
@@ -218,20 +192,14 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertOne(artdaq::Fragment const&
 	else if (frag.type() == 5)  // Timing
 	{
 		// TLOG(TLVL_INSERTONE) << "insertOne: Writing Timing Fragment";
-		// writeFragment_(timeSliceGroup, frag);
+		// writeFragment_(eventPath, frag);
 	}
 	else
 	{
 		TLOG(TLVL_INSERTONE) << "insertOne: Writing non-Container Fragment";
-		auto typeName = nameHelper_->GetInstanceNameForFragment(frag).second;
-		if (!timeSliceGroup.exist(typeName))
-		{
-			TLOG(TLVL_INSERTONE) << "insertOne: Creating group for type " << typeName;
-			timeSliceGroup.createGroup(typeName);
-		}
-		auto typeGroup = timeSliceGroup.getGroup(typeName);
+		auto typePath = eventPath + "/" + getInstanceName_(frag);
 
-		writeFragment_(typeGroup, frag);
+		writeFragment_(typePath, frag);
 	}
 	TLOG(TLVL_TRACE) << "insertOne END";
 }
@@ -247,13 +215,10 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertMany(artdaq::Fragments cons
 void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertHeader(artdaq::detail::RawEventHeader const& hdr)
 {
 	TLOG(TLVL_TRACE) << "insertHeader BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::InsertHeader));
 	uint64_t timeSliceGroupTimeStamp = windowOfInterestStart - outputTimeStampDelta;
-	if (!file_->exist(std::to_string(timeSliceGroupTimeStamp)))
-	{
-		TLOG(TLVL_INSERTONE) << "insertOne: Creating group for windowOfInterest " << timeSliceGroupTimeStamp;
-		file_->createGroup(std::to_string(timeSliceGroupTimeStamp));
-	}
-	auto timeSliceGroup = file_->getGroup(std::to_string(timeSliceGroupTimeStamp));
+	TLOG(TLVL_INSERTHEADER) << "insertHeader: Getting group for windowOfInterest " << timeSliceGroupTimeStamp;
+	auto& timeSliceGroup = registry_->getGroup(std::to_string(timeSliceGroupTimeStamp));
 	timeSliceGroup.createAttribute("run_id", hdr.run_id);
 	// timeSliceGroup.createAttribute("subrun_id", hdr.subrun_id);
 	// timeSliceGroup.createAttribute("event_id", hdr.event_id);
@@ -276,6 +241,7 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::insertHeader(artdaq::detail::RawE
 std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::HighFiveGeoCmpltPDSPSample::readNextEvent()
 {
 	TLOG(TLVL_DEBUG) << "readNextEvent BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadNextEvent));
 	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> output;
 
 	TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Finding next event group in file";
@@ -323,7 +289,7 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 					container_group.getAttribute("fragment_id").read(fragID);
 					if (!output.count(type))
 					{
-						output[type].reset(new Fragments());
+						output[type] = makeFragments_(type);
 					}
 					output[type]->emplace_back(seqID, fragID);
 					output[type]->back().setTimestamp(timestamp);
@@ -342,36 +308,41 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 
 					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Reading ContainerFragment Fragments";
 					auto fragments = container_group.listObjectNames();
+					artdaq::Fragments blockBuffer;
 					for (auto& fragname : fragments)
 					{
 						if (container_group.getObjectType(fragname) != HighFive::ObjectType::Dataset) continue;
 						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
-						auto frag = readFragment_(container_group.getDataSet(fragname, fragmentAProps_));
+						readFragment_(container_group.getDataSet(fragname, fragmentAProps_), blockBuffer);
 						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
 
 						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling addFragment BEGIN";
-						cfl.addFragment(frag);
+						cfl.addFragment(blockBuffer.back());
+						blockBuffer.clear();
 						TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: addFragment END";
 					}
 				}
 				else if (node_type == HighFive::ObjectType::Dataset)
 				{
-					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
-					auto frag = readFragment_(type_group.getDataSet(fragment_name, fragmentAProps_));
-					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
-
-					TLOG(TLVL_READNEXTEVENT) << "readNextEvent: Adding Fragment to output";
-					if (!output.count(frag->type()))
+					auto dataset = type_group.getDataSet(fragment_name, fragmentAProps_);
+					Fragment::type_t type;
+					dataset.getAttribute("type").read(type);
+					if (!output.count(type))
 					{
-						output[frag->type()].reset(new artdaq::Fragments());
+						output[type] = makeFragments_(type);
 					}
-					output[frag->type()]->push_back(*frag.release());
+
+					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ BEGIN";
+					readFragment_(dataset, *output[type]);
+					TLOG(TLVL_READNEXTEVENT_V) << "readNextEvent: Calling readFragment_ END";
 				}
 			}
 		}
 	}
 	++eventIndex_;
 
+	recordFragmentCounts_(output);
+
 	TLOG(TLVL_DEBUG)
 	    << "readNextEvent END output.size() = " << output.size();
 	return output;
@@ -380,6 +351,7 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveGeoCmpltPDSPSample::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
 {
 	TLOG(TLVL_TRACE) << "GetEventHeader BEGIN seqID=" << seqID;
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::GetEventHeader));
 	if (!file_->exist(std::to_string(seqID)))
 	{
 		TLOG(TLVL_ERROR) << "Sequence ID " << seqID << " not found in input file!";
@@ -402,9 +374,11 @@ std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::HighFiveGeoCmpltPD
 	return std::make_unique<artdaq::detail::RawEventHeader>(hdr);
 }
 
-void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::writeFragment_(HighFive::Group& group, artdaq::Fragment const& frag)
+void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::writeFragment_(std::string const& groupPath, artdaq::Fragment const& frag)
 {
 	TLOG(TLVL_TRACE) << "writeFragment_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::WriteFragment));
+	auto& group = registry_->getGroup(groupPath);
 
 	uint64_t windowOfInterestEnd = windowOfInterestStart + windowOfInterestSize;
 	int firstFrameOfInterest = -1;
@@ -515,13 +489,7 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::writeFragment_(HighFive::Group& g
 	if (firstFrameOfInterest == -1 || lastFrameOfInterest == -1) { return; }
 	int numberOfFrames = lastFrameOfInterest - firstFrameOfInterest + 1;
 
-	int counter = 1;
-	while (group.exist(datasetName))
-	{
-		// TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Duplicate Fragment ID " << frag.fragmentID() << " detected. If this is a ContainerFragment, this is expected, otherwise check configuration!";
-		datasetName = datasetNameBase + std::to_string(counter);
-		counter++;
-	}
+	datasetName = registry_->uniqueName(groupPath, datasetNameBase, [&](std::string const& base, size_t index) { return index == 0 ? datasetName : base + std::to_string(index); });
 
 	TLOG(TLVL_WRITEFRAGMENT) << "writeFragment_: Creating DataSpace";
 	HighFive::DataSpace fragmentSpace = HighFive::DataSpace({((uint32_t)(numberOfFrames * 58)), 1});
@@ -561,14 +529,17 @@ void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::writeFragment_(HighFive::Group& g
 	TLOG(TLVL_TRACE) << "writeFragment_ END";
 }
 
-artdaq::FragmentPtr artdaq::hdf5::HighFiveGeoCmpltPDSPSample::readFragment_(HighFive::DataSet const& dataset)
+void artdaq::hdf5::HighFiveGeoCmpltPDSPSample::readFragment_(HighFive::DataSet const& dataset, artdaq::Fragments& output)
 {
 	TLOG(TLVL_TRACE) << "readFragment_ BEGIN";
+	ARTDAQ_HDF5_SCOPED_TIMER(timing_(FragmentDatasetOperation::ReadFragment));
 	size_t fragSize;
 	dataset.getAttribute("fragment_data_size").read(fragSize);
 	TLOG(TLVL_READFRAGMENT) << "readFragment_: Fragment size " << fragSize << ", dataset size " << dataset.getDimensions()[0];
 
-	artdaq::FragmentPtr frag(new Fragment(fragSize));
+	// Construct the Fragment in place in the output vector, so that its payload is never copied
+	output.emplace_back(fragSize);
+	auto& frag = output.back();
 
 	artdaq::Fragment::type_t type;
 	size_t metadata_size;
@@ -591,7 +562,7 @@ artdaq::FragmentPtr artdaq::hdf5::HighFiveGeoCmpltPDSPSample::readFragment_(High
 	dataset.getAttribute("atime_ns").read(atime_ns);
 	dataset.getAttribute("atime_s").read(atime_s);
 
-	auto fragHdr = frag->fragmentHeader();
+	auto fragHdr = frag.fragmentHeader();
 	fragHdr.type = type;
 	fragHdr.metadata_word_count = metadata_size;
 
@@ -606,14 +577,13 @@ artdaq::FragmentPtr artdaq::hdf5::HighFiveGeoCmpltPDSPSample::readFragment_(High
 	fragHdr.atime_s = atime_s;
 
 	TLOG(TLVL_READFRAGMENT) << "readFragment_: Copying header into Fragment";
-	memcpy(frag->headerAddress(), &fragHdr, sizeof(fragHdr));
+	memcpy(frag.headerAddress(), &fragHdr, sizeof(fragHdr));
 
 	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment BEGIN";
-	dataset.read(frag->headerAddress() + frag->headerSizeWords());
+	dataset.read(frag.headerAddress() + frag.headerSizeWords());
 	TLOG(TLVL_READFRAGMENT_V) << "readFragment_: Reading payload data into Fragment END";
 
 	TLOG(TLVL_TRACE) << "readFragment_ END";
-	return frag;
 }
 
 std::string artdaq::hdf5::createTimeString(const uint64_t& timeValue)
@@ -624,4 +594,9 @@ std::string artdaq::hdf5::createTimeString(const uint64_t& timeValue)
 	return artdaq::TimeUtils::convertUnixTimeToString(tsp);
 }
 
+size_t artdaq::hdf5::HighFiveGeoCmpltPDSPSample::getFileSize()
+{
+	return getHDF5FileSize(file_.get());
+}
+
 DEFINE_ARTDAQ_DATASET_PLUGIN(artdaq::hdf5::HighFiveGeoCmpltPDSPSample)
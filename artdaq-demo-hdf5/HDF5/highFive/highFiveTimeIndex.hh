@@ -0,0 +1,145 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveTimeIndex_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveTimeIndex_hh 1
+
+#include "tracemf.h"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+#include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Time index table shared by the HighFive plugins
+ *
+ * The index is stored in the "time_index" dataset at the root of the file, with one row per Fragment written:
+ * sequence ID, type, Fragment ID, first timestamp, last timestamp, frame size (words), frame timestamp offset (words),
+ * frame count. It is a dataset rather than a group so that plugins which treat every root group as an event ignore it.
+ * Unused rows at the end of the table are zero-filled, and are recognized by their invalid Fragment type.
+ */
+class HighFiveTimeIndex
+{
+public:
+	/// Columns of the "time_index" dataset
+	enum Column : size_t
+	{
+		TI_SequenceID,
+		TI_Type,
+		TI_FragmentID,
+		TI_FirstTimestamp,
+		TI_LastTimestamp,
+		TI_FrameWords,
+		TI_FrameTimestampWord,
+		TI_FrameCount,
+		Columns
+	};
+
+	/**
+	 * @brief Create the time index of a file being written
+	 * @param file File to create the "time_index" dataset in
+	 * @param chunk_size Number of rows per chunk
+	 * @param props Dataset creation properties (e.g. from HighFiveFileProfile), chunking is added to them
+	 * @return HighFiveTimeIndex for writing
+	 */
+	static std::unique_ptr<HighFiveTimeIndex> create(HighFive::File& file, size_t chunk_size, HighFive::DataSetCreateProps props)
+	{
+		if (chunk_size == 0) chunk_size = 128;
+		props.add(HighFive::Chunking(std::vector<hsize_t>{chunk_size, Columns}));
+		auto dataset = file.createDataSet<uint64_t>(datasetName(), HighFive::DataSpace({0, Columns}, {HighFive::DataSpace::UNLIMITED, Columns}), props);
+		return std::unique_ptr<HighFiveTimeIndex>(new HighFiveTimeIndex(std::make_unique<HighFiveDatasetHelper>(dataset, chunk_size)));
+	}
+
+	/**
+	 * @brief Read the time index of a file
+	 * @param file File to read the "time_index" dataset from
+	 * @return All entries in the index, empty if the file has no time index
+	 */
+	static std::vector<FragmentTimeIndexEntry> read(HighFive::File const& file)
+	{
+		std::vector<FragmentTimeIndexEntry> output;
+		if (!file.exist(datasetName()))
+		{
+			TLOG(TLVL_WARNING, "HighFiveTimeIndex") << "File has no time index";
+			return output;
+		}
+
+		auto dataset = file.getDataSet(datasetName());
+		auto dims = dataset.getDimensions();
+		if (dims.size() != 2 || dims[1] != Columns)
+		{
+			TLOG(TLVL_ERROR, "HighFiveTimeIndex") << "Time index has unexpected shape, ignoring it";
+			return output;
+		}
+		auto rows = HighFiveDatasetHelper::rowCount(dataset);
+		std::vector<uint64_t> table(rows * Columns);
+		if (!table.empty()) dataset.select({0, 0}, {rows, Columns}).read(table.data());
+
+		output.reserve(rows);
+		for (size_t row = 0; row < table.size(); row += Columns)
+		{
+			if (table[row + TI_Type] == artdaq::Fragment::InvalidFragmentType) continue;
+
+			FragmentTimeIndexEntry entry;
+			entry.sequence_id = table[row + TI_SequenceID];
+			entry.type = static_cast<artdaq::Fragment::type_t>(table[row + TI_Type]);
+			entry.fragment_id = static_cast<artdaq::Fragment::fragment_id_t>(table[row + TI_FragmentID]);
+			entry.first_timestamp = table[row + TI_FirstTimestamp];
+			entry.last_timestamp = table[row + TI_LastTimestamp];
+			entry.frame_format.frame_words = table[row + TI_FrameWords];
+			entry.frame_format.timestamp_word = table[row + TI_FrameTimestampWord];
+			entry.frame_count = table[row + TI_FrameCount];
+			output.push_back(entry);
+		}
+		TLOG(TLVL_DEBUG, "HighFiveTimeIndex") << "Read " << output.size() << " time index entries";
+		return output;
+	}
+
+	/**
+	 * @brief Append an entry to the time index
+	 * @param entry Entry to append
+	 */
+	void write(FragmentTimeIndexEntry const& entry)
+	{
+		std::array<uint64_t, Columns> row{entry.sequence_id, entry.type, entry.fragment_id, entry.first_timestamp, entry.last_timestamp,
+		                                  entry.frame_format.frame_words, entry.frame_format.timestamp_word, entry.frame_count};
+		table_->write(row.data(), Columns);
+	}
+
+	/**
+	 * @brief Get the number of times the time index has been extended
+	 * @return The number of resize operations performed on the dataset
+	 */
+	size_t getResizeCount() { return table_->getResizeCount(); }
+	/**
+	 * @brief Record the duration of each resize operation in the given histogram
+	 * @param hist TimingHistogram to record into (must outlive this HighFiveTimeIndex)
+	 */
+	void setResizeTiming(TimingHistogram& hist) { table_->setResizeTiming(hist); }
+	/**
+	 * @brief Set how the extent of the time index grows when it is full
+	 * @param factor Growth factor, see HighFiveDatasetHelper::setExtentGrowth
+	 */
+	void setExtentGrowth(double factor) { table_->setExtentGrowth(factor); }
+
+	/**
+	 * @brief Name of the time index dataset
+	 * @return "time_index"
+	 */
+	static std::string datasetName() { return "time_index"; }
+
+private:
+	explicit HighFiveTimeIndex(std::unique_ptr<HighFiveDatasetHelper> table)
+	    : table_(std::move(table))
+	{}
+
+	std::unique_ptr<HighFiveDatasetHelper> table_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveTimeIndex_hh
@@ -0,0 +1,789 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveUringDriver_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveUringDriver_hh 1
+
+#include "tracemf.h"
+
+#include <hdf5.h>
+#if __has_include(<H5FDdevelop.h>)
+#include <H5FDdevelop.h>  // H5FD_class_t moved here in HDF5 1.14
+#endif
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#define ARTDAQ_DEMO_HDF5_HAVE_IO_URING 1
+#endif
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Settings of the io_uring file driver, see setUringDriver
+ */
+struct UringDriverConfig
+{
+	unsigned queueDepth{64};                   ///< Maximum number of reads and writes in flight
+	size_t writeBufferSize{1024 * 1024};       ///< Adjacent writes are coalesced into requests of up to this size, in bytes
+	size_t readaheadSize{4 * 1024 * 1024};     ///< Size of the readahead window, in bytes (0 disables readahead)
+};
+
+namespace uring {
+
+/**
+ * @brief Minimal io_uring submission/completion queue pair, using the system calls directly
+ *
+ * Only used from one thread at a time (the thread calling into the HDF5 library).
+ */
+class UringQueue
+{
+public:
+	UringQueue() = default;
+	~UringQueue() { close(); }
+	UringQueue(UringQueue const&) = delete;
+	UringQueue& operator=(UringQueue const&) = delete;
+
+	/**
+	 * @brief Create the ring
+	 * @param entries Submission queue size
+	 * @return 0 on success, otherwise the errno value (e.g. ENOSYS when the kernel or sandbox does not allow io_uring)
+	 */
+	int open(unsigned entries)
+	{
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (fd < 0) return errno;
+		fd_ = fd;
+
+		sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		singleMmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMmap_) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+		sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+		if (sqRing_ == MAP_FAILED) return fail_();
+		cqRing_ = singleMmap_ ? sqRing_ : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+		if (cqRing_ == MAP_FAILED) return fail_();
+		sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+		sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+		if (sqes_ == MAP_FAILED) return fail_();
+
+		auto sq = static_cast<char*>(sqRing_);
+		auto cq = static_cast<char*>(cqRing_);
+		sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		sqEntries_ = params.sq_entries;
+		sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		return 0;
+#else
+		(void)entries;
+		return ENOSYS;
+#endif
+	}
+
+	/**
+	 * @brief Destroy the ring. Requests still in flight complete in the kernel, so callers drain first.
+	 */
+	void close()
+	{
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+		if (sqes_ != nullptr && sqes_ != MAP_FAILED) munmap(sqes_, sqesSize_);
+		if (cqRing_ != nullptr && cqRing_ != MAP_FAILED && !singleMmap_) munmap(cqRing_, cqRingSize_);
+		if (sqRing_ != nullptr && sqRing_ != MAP_FAILED) munmap(sqRing_, sqRingSize_);
+		sqes_ = nullptr;
+		sqRing_ = cqRing_ = nullptr;
+#endif
+		if (fd_ >= 0) ::close(fd_);
+		fd_ = -1;
+	}
+
+	/**
+	 * @brief Whether the ring was created
+	 * @return True if requests can be queued
+	 */
+	bool isOpen() const { return fd_ >= 0; }
+
+	/**
+	 * @brief Queue a vectored read or write (submitted by the next call to submit)
+	 * @param write True for a write, false for a read
+	 * @param fd File descriptor
+	 * @param iov I/O vector, which must stay valid until the request completes
+	 * @param offset File offset, in bytes
+	 * @param user_data Value returned with the completion
+	 * @return False if the submission queue is full
+	 */
+	bool prepare(bool write, int fd, iovec const* iov, uint64_t offset, uint64_t user_data)
+	{
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+		unsigned tail = *sqTail_;
+		if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) return false;
+		unsigned index = tail & sqMask_;
+		io_uring_sqe* sqe = &sqes_[index];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->fd = fd;
+		sqe->addr = reinterpret_cast<uint64_t>(iov);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		sqe->len = 1;
+		sqe->off = offset;
+		sqe->user_data = user_data;
+		sqArray_[index] = index;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		__atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+		++unsubmitted_;
+		return true;
+#else
+		(void)write, (void)fd, (void)iov, (void)offset, (void)user_data;
+		return false;
+#endif
+	}
+
+	/**
+	 * @brief Submit the queued requests, optionally waiting for completions
+	 * @param wait Number of completions to wait for
+	 * @return 0 on success, otherwise the errno value
+	 */
+	int submit(unsigned wait)
+	{
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+		while (unsubmitted_ > 0 || wait > 0)
+		{
+			auto ret = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+			if (ret < 0)
+			{
+				if (errno == EINTR) continue;
+				return errno;
+			}
+			unsubmitted_ -= static_cast<unsigned>(ret);
+			if (wait > 0 || ret == 0) break;
+		}
+		return 0;
+#else
+		(void)wait;
+		return ENOSYS;
+#endif
+	}
+
+	/**
+	 * @brief Handle the available completions
+	 * @param handler Called with the user_data and result (bytes transferred or -errno) of each completion
+	 */
+	template<typename Handler>
+	void reap(Handler&& handler)
+	{
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+		unsigned head = *cqHead_;
+		unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			io_uring_cqe const& cqe = cqes_[head & cqMask_];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			auto user_data = cqe.user_data;
+			auto res = cqe.res;
+			++head;
+			__atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+			handler(user_data, res);
+		}
+#else
+		(void)handler;
+#endif
+	}
+
+private:
+	int fail_()
+	{
+		int error = errno;
+		close();
+		return error;
+	}
+
+	int fd_{-1};
+	unsigned unsubmitted_{0};
+#ifdef ARTDAQ_DEMO_HDF5_HAVE_IO_URING
+	void* sqRing_{nullptr};
+	void* cqRing_{nullptr};
+	size_t sqRingSize_{0};
+	size_t cqRingSize_{0};
+	bool singleMmap_{false};
+	io_uring_sqe* sqes_{nullptr};
+	size_t sqesSize_{0};
+	unsigned* sqHead_{nullptr};
+	unsigned* sqTail_{nullptr};
+	unsigned* sqArray_{nullptr};
+	unsigned sqMask_{0};
+	unsigned sqEntries_{0};
+	unsigned* cqHead_{nullptr};
+	unsigned* cqTail_{nullptr};
+	unsigned cqMask_{0};
+	io_uring_cqe* cqes_{nullptr};
+#endif
+};
+
+/**
+ * @brief Open file of the io_uring driver. The HDF5 library only sees the H5FD_t, which must be the first member.
+ */
+struct UringFile
+{
+	/// One read or write in flight
+	struct Request
+	{
+		std::vector<char> buffer;  ///< Data of writes and readahead reads (owned, since HDF5 reuses its buffers as soon as a call returns)
+		iovec iov{nullptr, 0};     ///< Remaining part of the transfer
+		char* data{nullptr};       ///< Start of the transfer
+		size_t length{0};          ///< Size of the transfer, in bytes
+		size_t done{0};            ///< Bytes transferred so far
+		haddr_t addr{0};           ///< File offset of the transfer
+		bool write{false};         ///< Whether this is a write
+		bool busy{false};          ///< Whether the request is in flight
+		int window{-1};            ///< Readahead window filled by this read (-1 if none)
+	};
+
+	/// Range of the file held in memory for small reads
+	struct Window
+	{
+		std::vector<char> data;  ///< Contents
+		haddr_t addr{0};         ///< File offset of the first byte
+		size_t length{0};        ///< Valid bytes
+		unsigned pending{0};     ///< Reads still filling the window
+		bool valid{false};       ///< Whether the window holds (or is being filled with) file data
+
+		bool contains(haddr_t a) const { return valid && a >= addr && a < addr + length; }  ///< @return Whether the byte at a is in the window
+	};
+
+	H5FD_t pub;  ///< Public part, used by the HDF5 library
+	int fd{-1};
+	dev_t device{0};
+	ino_t inode{0};
+	haddr_t eoa{0};
+	haddr_t eof{0};
+	UringDriverConfig config;
+	UringQueue ring;
+	std::vector<Request> requests;
+	std::vector<unsigned> freeRequests;
+	unsigned writesInFlight{0};
+	int asyncError{0};       ///< First failed transfer; sticky, since the data of a failed write is lost
+	bool ringFailed{false};  ///< io_uring_enter failed: the ring is closed, and requests which were in flight will not complete
+	std::vector<char> writeBuffer;
+	haddr_t writeAddr{0};
+	Window windows[2];  ///< Current window and the one being read ahead
+	int current{0};     ///< Index of the current window
+};
+
+#define URING_ERROR(major, minor, message) H5Epush2(H5E_DEFAULT, __FILE__, __func__, __LINE__, H5E_ERR_CLS, major, minor, "%s", message)
+
+inline UringFile* uringFile(H5FD_t* file) { return reinterpret_cast<UringFile*>(file); }                          // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+inline UringFile const* uringFile(H5FD_t const* file) { return reinterpret_cast<UringFile const*>(file); }        // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+/// Start (or continue) a request: queued on the ring, or done synchronously when the ring is not available
+inline void uringComplete(UringFile* file, unsigned index, int result);
+inline void uringStart(UringFile* file, unsigned index)
+{
+	auto& request = file->requests[index];
+	request.iov.iov_base = request.data + request.done;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	request.iov.iov_len = request.length - request.done;
+	auto offset = request.addr + request.done;
+	if (file->ring.isOpen() && file->ring.prepare(request.write, file->fd, &request.iov, offset, index)) return;
+
+	ssize_t result = request.write ? pwrite(file->fd, request.iov.iov_base, request.iov.iov_len, static_cast<off_t>(offset))
+	                               : pread(file->fd, request.iov.iov_base, request.iov.iov_len, static_cast<off_t>(offset));
+	uringComplete(file, index, result < 0 ? -errno : static_cast<int>(result));
+}
+
+inline void uringComplete(UringFile* file, unsigned index, int result)
+{
+	auto& request = file->requests[index];
+	if (result == -EINTR || result == -EAGAIN)
+	{
+		uringStart(file, index);
+		return;
+	}
+	if (result < 0)
+	{
+		if (file->asyncError == 0) file->asyncError = -result;
+	}
+	else if (result > 0)
+	{
+		request.done += static_cast<size_t>(result);
+		if (request.done < request.length)
+		{
+			uringStart(file, index);  // Short transfer, continue with the rest
+			return;
+		}
+	}
+	else if (!request.write)
+	{
+		// End of file: the rest of the range reads as zeros
+		memset(request.data + request.done, 0, request.length - request.done);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	else if (file->asyncError == 0)
+	{
+		file->asyncError = EIO;
+	}
+
+	if (request.window >= 0) file->windows[request.window].pending--;
+	if (request.write) file->writesInFlight--;
+	request.busy = false;
+	request.window = -1;
+	file->freeRequests.push_back(index);
+}
+
+/// Submit the queued requests and handle the completions, waiting for at least one if wait is set
+inline void uringSubmit(UringFile* file, bool wait)
+{
+	if (!file->ring.isOpen()) return;
+	auto error = file->ring.submit(wait && file->freeRequests.size() < file->requests.size() ? 1 : 0);
+	file->ring.reap([file](uint64_t index, int result) { uringComplete(file, static_cast<unsigned>(index), result); });
+	if (error != 0 && error != EAGAIN && error != EBUSY)
+	{
+		// Queued and in-flight requests are lost (their slots stay busy, so their buffers are not reused). Later requests
+		// use pread/pwrite, and the sticky error makes every later flush and close fail.
+		TLOG(TLVL_ERROR, "HighFiveUringDriver") << "io_uring_enter failed: " << strerror(error) << ", pending requests are lost and the file is unusable";
+		file->ringFailed = true;
+		if (file->asyncError == 0) file->asyncError = error;
+		file->ring.close();
+	}
+}
+
+/// Whether requests are in flight and can still complete
+inline bool uringBusy(UringFile const* file)
+{
+	return file->freeRequests.size() < file->requests.size() && !file->ringFailed;
+}
+
+/// Get a free request slot, waiting for a completion if all are in flight. Returns -1 if none can be freed.
+inline int uringAcquire(UringFile* file)
+{
+	while (file->freeRequests.empty())
+	{
+		if (!uringBusy(file)) return -1;
+		uringSubmit(file, true);
+	}
+	auto index = file->freeRequests.back();
+	file->freeRequests.pop_back();
+	auto& request = file->requests[index];
+	request.busy = true;
+	request.done = 0;
+	request.window = -1;
+	return static_cast<int>(index);
+}
+
+/// Hand the coalesced writes to the ring
+inline void uringQueueWriteBuffer(UringFile* file)
+{
+	if (file->writeBuffer.empty()) return;
+	auto index = uringAcquire(file);
+	if (index < 0)
+	{
+		file->writeBuffer.clear();  // The error is reported by the next flush or close
+		return;
+	}
+	file->writesInFlight++;
+	auto& request = file->requests[index];
+	std::swap(request.buffer, file->writeBuffer);  // The request's previous buffer is reused for the next writes
+	file->writeBuffer.clear();
+	request.write = true;
+	request.data = request.buffer.data();
+	request.length = request.buffer.size();
+	request.addr = file->writeAddr;
+	uringStart(file, index);
+}
+
+/// Queue the pending writes and wait until every request has completed. Fails from the first failed transfer on.
+inline herr_t uringDrain(UringFile* file)
+{
+	uringQueueWriteBuffer(file);
+	while (uringBusy(file))
+	{
+		uringSubmit(file, true);
+	}
+	if (file->asyncError != 0)
+	{
+		URING_ERROR(H5E_IO, H5E_WRITEERROR, strerror(file->asyncError));
+		return -1;
+	}
+	return 0;
+}
+
+/// Read a range with up to queueDepth requests in flight, into memory owned by a request or a window
+inline void uringReadRange(UringFile* file, char* data, haddr_t addr, size_t size, int window)
+{
+	auto pieces = std::max<size_t>(1, std::min<size_t>(file->requests.size(), size / (256 * 1024)));
+	auto pieceSize = (size + pieces - 1) / pieces;
+	for (size_t offset = 0; offset < size; offset += pieceSize)
+	{
+		auto index = uringAcquire(file);
+		if (index < 0) return;
+		auto& request = file->requests[index];
+		request.write = false;
+		request.data = data + offset;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		request.length = std::min(pieceSize, size - offset);
+		request.addr = addr + offset;
+		request.window = window;
+		if (window >= 0) file->windows[window].pending++;
+		uringStart(file, index);
+	}
+	uringSubmit(file, false);
+}
+
+/// Start filling a readahead window
+inline void uringFillWindow(UringFile* file, int window, haddr_t addr)
+{
+	auto& w = file->windows[window];
+	w.valid = addr < file->eof;
+	if (!w.valid) return;
+	w.addr = addr;
+	w.length = static_cast<size_t>(std::min<haddr_t>(file->config.readaheadSize, file->eof - addr));
+	w.data.resize(file->config.readaheadSize);
+	uringReadRange(file, w.data.data(), addr, w.length, window);
+}
+
+inline void uringWaitWindow(UringFile* file, int window)
+{
+	while (file->windows[window].pending > 0 && uringBusy(file))
+	{
+		uringSubmit(file, true);
+	}
+}
+
+inline void uringInvalidateWindows(UringFile* file, haddr_t addr, size_t size)
+{
+	for (int ii = 0; ii < 2; ++ii)
+	{
+		auto& w = file->windows[ii];
+		if (w.valid && addr < w.addr + w.length && w.addr < addr + size)
+		{
+			uringWaitWindow(file, ii);
+			w.valid = false;
+		}
+	}
+}
+
+// HDF5 virtual file driver callbacks
+
+inline void* uringFaplGet(H5FD_t* file) { return new UringDriverConfig(uringFile(file)->config); }
+inline void* uringFaplCopy(void const* config) { return new UringDriverConfig(*static_cast<UringDriverConfig const*>(config)); }
+inline herr_t uringFaplFree(void* config)
+{
+	delete static_cast<UringDriverConfig*>(config);
+	return 0;
+}
+
+inline H5FD_t* uringOpen(char const* name, unsigned flags, hid_t fapl, haddr_t maxaddr)
+{
+	if (name == nullptr || *name == '\0' || maxaddr == 0 || maxaddr == HADDR_UNDEF)
+	{
+		URING_ERROR(H5E_ARGS, H5E_BADVALUE, "invalid file name or maximum address");
+		return nullptr;
+	}
+
+	int oflags = (flags & H5F_ACC_RDWR) != 0 ? O_RDWR : O_RDONLY;
+	if ((flags & H5F_ACC_TRUNC) != 0) oflags |= O_TRUNC;
+	if ((flags & H5F_ACC_CREAT) != 0) oflags |= O_CREAT;
+	if ((flags & H5F_ACC_EXCL) != 0) oflags |= O_EXCL;
+	int fd = ::open(name, oflags | O_CLOEXEC, 0666);
+	if (fd < 0)
+	{
+		URING_ERROR(H5E_FILE, H5E_CANTOPENFILE, strerror(errno));
+		return nullptr;
+	}
+	struct stat sb;
+	if (fstat(fd, &sb) < 0)
+	{
+		URING_ERROR(H5E_FILE, H5E_BADFILE, strerror(errno));
+		::close(fd);
+		return nullptr;
+	}
+
+	auto file = new UringFile();
+	memset(&file->pub, 0, sizeof(file->pub));
+	file->fd = fd;
+	file->device = sb.st_dev;
+	file->inode = sb.st_ino;
+	file->eof = static_cast<haddr_t>(sb.st_size);
+	auto config = static_cast<UringDriverConfig const*>(H5Pget_driver_info(fapl));
+	if (config != nullptr) file->config = *config;
+	file->config.queueDepth = std::min(std::max(file->config.queueDepth, 1u), 4096u);
+
+	auto error = file->ring.open(file->config.queueDepth);
+	if (error != 0)
+	{
+		TLOG(TLVL_WARNING, "HighFiveUringDriver") << "io_uring is not available (" << strerror(error) << "), " << name << " will use synchronous pread/pwrite";
+	}
+	file->requests.resize(file->config.queueDepth);
+	for (unsigned ii = 0; ii < file->config.queueDepth; ++ii)
+	{
+		file->freeRequests.push_back(file->config.queueDepth - 1 - ii);
+	}
+	TLOG(TLVL_DEBUG, "HighFiveUringDriver") << "Opened " << name << " with queue depth " << file->config.queueDepth << ", write buffer " << file->config.writeBufferSize
+	                                        << " bytes, readahead " << file->config.readaheadSize << " bytes";
+	return &file->pub;
+}
+
+inline herr_t uringClose(H5FD_t* _file)
+{
+	auto file = uringFile(_file);
+	auto status = uringDrain(file);
+	file->ring.close();
+	if (::close(file->fd) < 0)
+	{
+		URING_ERROR(H5E_IO, H5E_CANTCLOSEFILE, strerror(errno));
+		status = -1;
+	}
+	delete file;
+	return status;
+}
+
+inline int uringCmp(H5FD_t const* _f1, H5FD_t const* _f2)
+{
+	auto f1 = uringFile(_f1);
+	auto f2 = uringFile(_f2);
+	if (f1->device != f2->device) return f1->device < f2->device ? -1 : 1;
+	if (f1->inode != f2->inode) return f1->inode < f2->inode ? -1 : 1;
+	return 0;
+}
+
+inline herr_t uringQuery(H5FD_t const* /*file*/, unsigned long* flags)
+{
+	if (flags != nullptr)
+	{
+		*flags = H5FD_FEAT_AGGREGATE_METADATA | H5FD_FEAT_ACCUMULATE_METADATA | H5FD_FEAT_DATA_SIEVE | H5FD_FEAT_AGGREGATE_SMALLDATA;
+#ifdef H5FD_FEAT_DEFAULT_VFD_COMPATIBLE
+		*flags |= H5FD_FEAT_DEFAULT_VFD_COMPATIBLE;  // Files are plain sec2 files
+#endif
+	}
+	return 0;
+}
+
+inline haddr_t uringGetEoa(H5FD_t const* file, H5FD_mem_t /*type*/) { return uringFile(file)->eoa; }
+inline herr_t uringSetEoa(H5FD_t* file, H5FD_mem_t /*type*/, haddr_t addr)
+{
+	uringFile(file)->eoa = addr;
+	return 0;
+}
+inline haddr_t uringGetEof(H5FD_t const* file, H5FD_mem_t /*type*/) { return uringFile(file)->eof; }
+
+inline herr_t uringGetHandle(H5FD_t* _file, hid_t /*fapl*/, void** handle)
+{
+	auto file = uringFile(_file);
+	if (handle == nullptr) return -1;
+	*handle = &file->fd;
+	return uringDrain(file);  // Callers may use the descriptor directly
+}
+
+inline herr_t uringRead(H5FD_t* _file, H5FD_mem_t /*type*/, hid_t /*dxpl*/, haddr_t addr, size_t size, void* buffer)
+{
+	auto file = uringFile(_file);
+	if (addr == HADDR_UNDEF || addr + size > file->eoa)
+	{
+		URING_ERROR(H5E_ARGS, H5E_OVERFLOW, "read past the end of the allocated space");
+		return -1;
+	}
+	// Reads are rare while writing (metadata cache misses); make them see every earlier write
+	if ((!file->writeBuffer.empty() || file->writesInFlight > 0) && uringDrain(file) < 0) return -1;
+
+	auto out = static_cast<char*>(buffer);
+	if (addr >= file->eof || file->config.readaheadSize == 0 || size >= file->config.readaheadSize)
+	{
+		auto valid = static_cast<size_t>(addr < file->eof ? std::min<haddr_t>(size, file->eof - addr) : 0);
+		if (valid > 0) uringReadRange(file, out, addr, valid, -1);
+		memset(out + valid, 0, size - valid);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return uringDrain(file);
+	}
+
+	while (size > 0)
+	{
+		auto& current = file->windows[file->current];
+		auto& next = file->windows[1 - file->current];
+		if (!current.contains(addr))
+		{
+			if (next.contains(addr))
+			{
+				file->current = 1 - file->current;  // Sequential access reached the readahead window
+			}
+			else
+			{
+				uringInvalidateWindows(file, 0, file->eof);
+				uringFillWindow(file, file->current, addr);
+			}
+			auto& w = file->windows[file->current];
+			uringWaitWindow(file, file->current);
+			if (file->asyncError != 0) return uringDrain(file);
+			if (!w.valid)
+			{
+				memset(out, 0, size);
+				return 0;
+			}
+			// Read the following window while this one is used
+			auto& ahead = file->windows[1 - file->current];
+			if (!ahead.contains(w.addr + w.length)) uringFillWindow(file, 1 - file->current, w.addr + w.length);
+		}
+
+		auto& w = file->windows[file->current];
+		auto bytes = static_cast<size_t>(std::min<haddr_t>(size, w.addr + w.length - addr));
+		memcpy(out, w.data.data() + (addr - w.addr), bytes);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		out += bytes;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		addr += bytes;
+		size -= bytes;
+		if (size > 0 && addr >= file->eof)
+		{
+			memset(out, 0, size);
+			break;
+		}
+	}
+	return 0;
+}
+
+inline herr_t uringWrite(H5FD_t* _file, H5FD_mem_t /*type*/, hid_t /*dxpl*/, haddr_t addr, size_t size, void const* buffer)
+{
+	auto file = uringFile(_file);
+	if (addr == HADDR_UNDEF || addr + size > file->eoa)
+	{
+		URING_ERROR(H5E_ARGS, H5E_OVERFLOW, "write past the end of the allocated space");
+		return -1;
+	}
+	if (file->asyncError != 0) return uringDrain(file);
+	uringInvalidateWindows(file, addr, size);
+
+	// Extend the current write buffer if this write is adjacent to it, otherwise hand it to the ring
+	auto in = static_cast<char const*>(buffer);
+	if (!file->writeBuffer.empty() &&
+	    (addr != file->writeAddr + file->writeBuffer.size() || file->writeBuffer.size() + size > file->config.writeBufferSize))
+	{
+		uringQueueWriteBuffer(file);
+	}
+	if (file->writeBuffer.empty()) file->writeAddr = addr;
+	file->writeBuffer.insert(file->writeBuffer.end(), in, in + size);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	if (file->writeBuffer.size() >= file->config.writeBufferSize) uringQueueWriteBuffer(file);
+
+	uringSubmit(file, false);
+	file->eof = std::max(file->eof, addr + size);
+	return 0;
+}
+
+inline herr_t uringFlush(H5FD_t* file, hid_t /*dxpl*/, hbool_t /*closing*/) { return uringDrain(uringFile(file)); }
+
+inline herr_t uringTruncate(H5FD_t* _file, hid_t /*dxpl*/, hbool_t /*closing*/)
+{
+	auto file = uringFile(_file);
+	if (uringDrain(file) < 0) return -1;
+	if (file->eoa != file->eof)
+	{
+		if (ftruncate(file->fd, static_cast<off_t>(file->eoa)) < 0)
+		{
+			URING_ERROR(H5E_IO, H5E_SEEKERROR, strerror(errno));
+			return -1;
+		}
+		file->eof = file->eoa;
+		uringInvalidateWindows(file, 0, HADDR_MAX);
+	}
+	return 0;
+}
+
+inline herr_t uringLock(H5FD_t* file, hbool_t rw)
+{
+	if (flock(uringFile(file)->fd, (rw ? LOCK_EX : LOCK_SH) | LOCK_NB) < 0 && errno != ENOSYS)
+	{
+		URING_ERROR(H5E_FILE, H5E_BADFILE, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+inline herr_t uringUnlock(H5FD_t* file)
+{
+	if (flock(uringFile(file)->fd, LOCK_UN) < 0 && errno != ENOSYS)
+	{
+		URING_ERROR(H5E_FILE, H5E_BADFILE, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+#undef URING_ERROR
+}  // namespace uring
+
+/**
+ * @brief Get the ID of the io_uring file driver, registering it with the HDF5 library on first use
+ * @return Driver ID, negative if registration failed
+ *
+ * The driver writes plain HDF5 files, which any other driver can read. Writes are copied into buffers of up to
+ * UringDriverConfig::writeBufferSize bytes, coalescing adjacent writes, and submitted through io_uring with up to
+ * UringDriverConfig::queueDepth requests in flight; completions are only waited for when a request slot is needed, and
+ * at flush, truncate and close. Reads smaller than the readahead size are served from a window of
+ * UringDriverConfig::readaheadSize bytes, read as parallel requests, and the following window is read ahead while the
+ * current one is used. Where io_uring is not available (old kernels, or seccomp policies which deny it), the same
+ * buffering is used with synchronous pread/pwrite calls. After a failed transfer, or if io_uring_enter fails (the
+ * driver then closes the ring and continues with pread/pwrite), every later flush and close of the file fails.
+ */
+inline hid_t uringDriverId()
+{
+	static hid_t const id = [] {
+		H5FD_class_t cls;
+		memset(&cls, 0, sizeof(cls));
+#ifdef H5FD_CLASS_VERSION
+		cls.version = H5FD_CLASS_VERSION;
+		cls.value = static_cast<H5FD_class_value_t>(470);  // From the range 256-511, which HDF5 leaves to unregistered and testing drivers
+#endif
+		cls.name = "artdaq_io_uring";
+		cls.maxaddr = (static_cast<haddr_t>(1) << (8 * sizeof(off_t) - 1)) - 1;
+		cls.fc_degree = H5F_CLOSE_WEAK;
+		cls.fapl_size = sizeof(UringDriverConfig);
+		cls.fapl_get = uring::uringFaplGet;
+		cls.fapl_copy = uring::uringFaplCopy;
+		cls.fapl_free = uring::uringFaplFree;
+		cls.open = uring::uringOpen;
+		cls.close = uring::uringClose;
+		cls.cmp = uring::uringCmp;
+		cls.query = uring::uringQuery;
+		cls.get_eoa = uring::uringGetEoa;
+		cls.set_eoa = uring::uringSetEoa;
+		cls.get_eof = uring::uringGetEof;
+		cls.get_handle = uring::uringGetHandle;
+		cls.read = uring::uringRead;
+		cls.write = uring::uringWrite;
+		cls.flush = uring::uringFlush;
+		cls.truncate = uring::uringTruncate;
+		cls.lock = uring::uringLock;
+		cls.unlock = uring::uringUnlock;
+		for (auto& type : cls.fl_map)
+		{
+			type = H5FD_MEM_DEFAULT;
+		}
+		return H5FDregister(&cls);
+	}();
+	return id;
+}
+
+/**
+ * @brief Select the io_uring file driver in a file access property list
+ * @param fapl File access property list
+ * @param config Driver settings
+ * @return Negative value on error
+ */
+inline herr_t setUringDriver(hid_t fapl, UringDriverConfig const& config)
+{
+	auto id = uringDriverId();
+	if (id < 0) return -1;
+	return H5Pset_driver(fapl, id, &config);
+}
+
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveUringDriver_hh
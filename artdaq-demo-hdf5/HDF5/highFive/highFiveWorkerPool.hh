@@ -0,0 +1,134 @@
+#ifndef artdaq_demo_hdf5_HDF5_highFive_highFiveWorkerPool_hh
+#define artdaq_demo_hdf5_HDF5_highFive_highFiveWorkerPool_hh 1
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Fixed-size pool of worker threads for the CPU-bound parts of HDF5 I/O (chunk compression and decompression)
+ *
+ * Jobs must not call the HDF5 library, which is only used from the thread owning the pool. The owner submits jobs
+ * and then calls wait(), which rethrows the first exception thrown by a job since the previous wait().
+ */
+class HighFiveWorkerPool
+{
+public:
+	/**
+	 * @brief HighFiveWorkerPool Constructor
+	 * @param threads Number of worker threads (at least one is started)
+	 */
+	explicit HighFiveWorkerPool(size_t threads)
+	{
+		if (threads == 0) threads = 1;
+		for (size_t ii = 0; ii < threads; ++ii)
+		{
+			workers_.emplace_back([this] { work_(); });
+		}
+	}
+	/**
+	 * @brief HighFiveWorkerPool Destructor, finishes queued jobs and joins the worker threads
+	 */
+	~HighFiveWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			stop_ = true;
+		}
+		job_cv_.notify_all();
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	/**
+	 * @brief Queue a job for the worker threads
+	 * @param job Job to run
+	 */
+	void submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			jobs_.push_back(std::move(job));
+			++pending_;
+		}
+		job_cv_.notify_one();
+	}
+
+	/**
+	 * @brief Wait until all submitted jobs have finished
+	 *
+	 * Rethrows the first exception thrown by a job since the previous call to wait().
+	 */
+	void wait()
+	{
+		std::unique_lock<std::mutex> lk(mutex_);
+		done_cv_.wait(lk, [this] { return pending_ == 0; });
+		if (error_)
+		{
+			auto error = error_;
+			error_ = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	/**
+	 * @brief Get the number of worker threads
+	 * @return Number of worker threads
+	 */
+	size_t size() const { return workers_.size(); }
+
+private:
+	HighFiveWorkerPool(HighFiveWorkerPool const&) = delete;
+	HighFiveWorkerPool(HighFiveWorkerPool&&) = delete;
+	HighFiveWorkerPool& operator=(HighFiveWorkerPool const&) = delete;
+	HighFiveWorkerPool& operator=(HighFiveWorkerPool&&) = delete;
+
+	void work_()
+	{
+		std::unique_lock<std::mutex> lk(mutex_);
+		while (true)
+		{
+			job_cv_.wait(lk, [this] { return stop_ || !jobs_.empty(); });
+			if (jobs_.empty()) return;
+
+			auto job = std::move(jobs_.front());
+			jobs_.pop_front();
+			lk.unlock();
+			std::exception_ptr error;
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			lk.lock();
+
+			if (error && !error_) error_ = error;
+			if (--pending_ == 0) done_cv_.notify_all();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable job_cv_;
+	std::condition_variable done_cv_;
+	std::deque<std::function<void()>> jobs_;
+	size_t pending_{0};
+	bool stop_{false};
+	std::exception_ptr error_;
+	std::vector<std::thread> workers_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_HDF5_highFive_highFiveWorkerPool_hh
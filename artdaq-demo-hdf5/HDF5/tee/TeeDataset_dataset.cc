@@ -0,0 +1,432 @@
+#include "tracemf.h"
+#define TRACE_NAME "TeeDataset"
+
+#include "artdaq-core/Data/ContainerFragment.hh"
+#include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+#include "cetlib_except/exception.h"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace artdaq {
+namespace hdf5 {
+/**
+ * @brief A FragmentDataset which forwards every Fragment and event header to several child Datasets
+ *
+ * This writes several file layouts (e.g. a full grouped file and a PDSP sample) in one pass, with one HDFFileOutput
+ * module fetching the event products once.
+ *
+ * A child which throws is no longer written to, so that its file is not continued past the failed write, while the
+ * other children still receive every insert. The error of each failed child is rethrown once, by the insert call which
+ * forwards the failing write (or, with "queueDepth", by a later insert call), and every later insert call throws once
+ * all children have failed.
+ */
+class TeeDataset : public FragmentDataset
+{
+public:
+	/**
+	 * @brief TeeDataset Constructor
+	 * @param ps ParameterSet used to configure TeeDataset
+	 *
+	 * TeeDataset accepts the following Parameters:
+	 * "children" (REQUIRED): List of Dataset plugin configurations (each with "datasetPluginType", "fileName", ...).
+	 *   Children without a "mode" get the mode of the TeeDataset.
+	 * "unpackContainers" (Default: false): Decode each ContainerFragment once and give the children the contained
+	 *   Fragments instead of the Container, so that children do not each decode it (this changes the layout written
+	 *   by children which store Containers specially).
+	 * "parallel" (Default: false): Run each child on its own thread. The children write concurrently only if the HDF5
+	 *   library is thread-safe; otherwise they share one writer thread, which still overlaps writing with the caller.
+	 * "queueDepth" (Default: 0): With 0, insert calls return once every child has written the data. Otherwise the
+	 *   data is copied once, shared by the children, and insert calls return immediately unless a child thread is this
+	 *   many calls behind (implies a writer thread even without "parallel").
+	 *
+	 * In read mode, every read is forwarded to the first child.
+	 */
+	explicit TeeDataset(fhicl::ParameterSet const& ps);
+	/**
+	 * @brief TeeDataset Destructor, waits for the queued writes of the children
+	 */
+	~TeeDataset() noexcept override;
+
+	/**
+	 * @brief Insert a Fragment into every child Dataset
+	 * @param frag Fragment to insert
+	 */
+	void insertOne(artdaq::Fragment const& frag) override;
+	/**
+	 * @brief Insert several Fragments into every child Dataset
+	 * @param frags Fragments to insert
+	 */
+	void insertMany(artdaq::Fragments const& frags) override;
+	/**
+	 * @brief Insert a RawEventHeader into every child Dataset
+	 * @param hdr RawEventHeader to insert
+	 */
+	void insertHeader(artdaq::detail::RawEventHeader const& hdr) override;
+	/**
+	 * @brief Read the next event from the first child Dataset
+	 * @returns Map of Fragment types and Fragments
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> readNextEvent() override;
+	/**
+	 * @brief Read a RawEventHeader from the first child Dataset
+	 * @param seqID Sequence ID of the RawEventHeader
+	 * @return Pointer to a RawEventHeader if a match was found, nullptr otherwise
+	 */
+	std::unique_ptr<artdaq::detail::RawEventHeader> getEventHeader(artdaq::Fragment::sequence_id_t const& seqID) override;
+	/**
+	 * @brief Get the total size of the children's files
+	 * @return Sum of the children's file sizes, in bytes, as of the last event header written
+	 */
+	size_t getFileSize() override;
+	/**
+	 * @brief Get the total number of dataset extensions of the children
+	 * @return Sum of the children's dataset extension counts, as of the last event header written
+	 */
+	size_t getDatasetExtensionCount() override;
+
+private:
+	TeeDataset(TeeDataset const&) = delete;
+	TeeDataset(TeeDataset&&) = delete;
+	TeeDataset& operator=(TeeDataset const&) = delete;
+	TeeDataset& operator=(TeeDataset&&) = delete;
+
+	struct Child
+	{
+		std::unique_ptr<FragmentDataset> dataset;
+		std::atomic<size_t> fileSize{0};
+		std::atomic<size_t> extensionCount{0};
+		std::exception_ptr error;  ///< First error of the child, which is no longer written to (guarded by errorMutex_)
+		bool reported{false};      ///< Whether error has been rethrown to the caller (guarded by errorMutex_)
+	};
+
+	/// Insert call forwarded to the children
+	struct Job
+	{
+		std::function<void(FragmentDataset&)> write;
+		bool updateSizes;  ///< Whether the child's file size and extension count are refreshed after the write
+	};
+
+	/// Thread writing to a subset of the children, in call order
+	struct Worker
+	{
+		std::vector<Child*> children;
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<Job> jobs;
+		bool busy{false};
+		bool stop{false};
+	};
+
+	void forward_(std::function<void(FragmentDataset&)> const& write, bool updateSizes = false);
+	void work_(Worker& worker);
+	void write_(Child& child, Job const& job);
+	void rethrowChildErrors_();
+	void waitIdle_();
+	artdaq::Fragments unpack_(artdaq::Fragments const& frags) const;
+
+	std::vector<std::unique_ptr<Child>> children_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::mutex errorMutex_;
+	bool unpackContainers_;
+	size_t queueDepth_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+artdaq::hdf5::TeeDataset::TeeDataset(fhicl::ParameterSet const& ps)
+    : FragmentDataset(ps, ps.get<std::string>("mode", "write"))
+    , unpackContainers_(ps.get<bool>("unpackContainers", false))
+    , queueDepth_(ps.get<size_t>("queueDepth", 0))
+{
+	TLOG(TLVL_DEBUG) << "TeeDataset CONSTRUCTOR BEGIN";
+	auto mode = ps.get<std::string>("mode", "write");
+	for (auto child_ps : ps.get<std::vector<fhicl::ParameterSet>>("children"))
+	{
+		if (!child_ps.has_key("mode")) child_ps.put<std::string>("mode", mode);
+		fhicl::ParameterSet plugin_ps;
+		plugin_ps.put<fhicl::ParameterSet>("dataset", child_ps);
+		auto child = std::make_unique<Child>();
+		child->dataset = MakeDatasetPlugin(plugin_ps, "dataset");
+		TLOG(TLVL_DEBUG) << "TeeDataset: Added child " << child_ps.get<std::string>("datasetPluginType") << " writing " << child_ps.get<std::string>("fileName", "");
+		children_.push_back(std::move(child));
+	}
+	if (children_.empty())
+	{
+		throw cet::exception("TeeDataset") << "TeeDataset: No children configured";  // NOLINT(cert-err60-cpp)
+	}
+
+	auto parallel = ps.get<bool>("parallel", false);
+	if (mode_ == FragmentDatasetMode::Read)
+	{
+		if (children_.size() > 1) TLOG(TLVL_WARNING) << "TeeDataset: In read mode, only the first child is read";
+		return;
+	}
+	if (!parallel && queueDepth_ == 0) return;
+
+	hbool_t threadsafe = 0;
+	H5is_library_threadsafe(&threadsafe);
+	if (parallel && threadsafe == 0)
+	{
+		TLOG(TLVL_WARNING) << "TeeDataset: The HDF5 library is not thread-safe, the children will share one writer thread";
+		parallel = false;
+	}
+	auto nWorkers = parallel ? children_.size() : 1;
+	for (size_t ii = 0; ii < nWorkers; ++ii)
+	{
+		workers_.push_back(std::make_unique<Worker>());
+	}
+	for (size_t ii = 0; ii < children_.size(); ++ii)
+	{
+		workers_[ii % nWorkers]->children.push_back(children_[ii].get());
+	}
+	for (auto& worker : workers_)
+	{
+		auto w = worker.get();
+		worker->thread = std::thread([this, w] { work_(*w); });
+	}
+	TLOG(TLVL_DEBUG) << "TeeDataset CONSTRUCTOR END, " << children_.size() << " children on " << workers_.size() << " writer threads, queueDepth " << queueDepth_;
+}
+
+artdaq::hdf5::TeeDataset::~TeeDataset() noexcept
+{
+	TLOG(TLVL_DEBUG) << "~TeeDataset BEGIN";
+	for (auto& worker : workers_)
+	{
+		{
+			std::lock_guard<std::mutex> lk(worker->mutex);
+			worker->stop = true;
+		}
+		worker->cv.notify_all();
+		worker->thread.join();
+	}
+	workers_.clear();
+	for (auto& child : children_)
+	{
+		if (!child->error || child->reported) continue;
+		try
+		{
+			std::rethrow_exception(child->error);
+		}
+		catch (std::exception const& ex)
+		{
+			TLOG(TLVL_ERROR) << "~TeeDataset: Error writing to a child Dataset: " << ex.what();
+		}
+		catch (...)
+		{
+			TLOG(TLVL_ERROR) << "~TeeDataset: Unknown error writing to a child Dataset";
+		}
+	}
+	children_.clear();  // Closes the children's files
+	TLOG(TLVL_DEBUG) << "~TeeDataset END";
+}
+
+void artdaq::hdf5::TeeDataset::insertOne(artdaq::Fragment const& frag)
+{
+	TLOG(TLVL_TRACE) << "insertOne BEGIN";
+	if (unpackContainers_ && frag.type() == artdaq::Fragment::ContainerFragmentType)
+	{
+		insertMany(artdaq::Fragments{frag});  // Copies, but containers are unpacked into copies anyway
+		return;
+	}
+	if (queueDepth_ == 0)
+	{
+		forward_([&frag](FragmentDataset& child) { child.insertOne(frag); });
+	}
+	else
+	{
+		auto shared = std::make_shared<artdaq::Fragment const>(frag);
+		forward_([shared](FragmentDataset& child) { child.insertOne(*shared); });
+	}
+	TLOG(TLVL_TRACE) << "insertOne END";
+}
+
+void artdaq::hdf5::TeeDataset::insertMany(artdaq::Fragments const& frags)
+{
+	TLOG(TLVL_TRACE) << "insertMany BEGIN";
+	if (unpackContainers_)
+	{
+		auto shared = std::make_shared<artdaq::Fragments const>(unpack_(frags));
+		forward_([shared](FragmentDataset& child) { child.insertMany(*shared); });
+	}
+	else if (queueDepth_ == 0)
+	{
+		forward_([&frags](FragmentDataset& child) { child.insertMany(frags); });
+	}
+	else
+	{
+		auto shared = std::make_shared<artdaq::Fragments const>(frags);
+		forward_([shared](FragmentDataset& child) { child.insertMany(*shared); });
+	}
+	TLOG(TLVL_TRACE) << "insertMany END";
+}
+
+void artdaq::hdf5::TeeDataset::insertHeader(artdaq::detail::RawEventHeader const& hdr)
+{
+	TLOG(TLVL_TRACE) << "insertHeader BEGIN";
+	// The header is the last insert of an event (see HDFFileOutput), so the children's file sizes are updated after it
+	forward_([hdr](FragmentDataset& child) { child.insertHeader(hdr); }, true);
+	TLOG(TLVL_TRACE) << "insertHeader END";
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::TeeDataset::readNextEvent()
+{
+	return children_.front()->dataset->readNextEvent();
+}
+
+std::unique_ptr<artdaq::detail::RawEventHeader> artdaq::hdf5::TeeDataset::getEventHeader(artdaq::Fragment::sequence_id_t const& seqID)
+{
+	return children_.front()->dataset->getEventHeader(seqID);
+}
+
+size_t artdaq::hdf5::TeeDataset::getFileSize()
+{
+	size_t size = 0;
+	for (auto const& child : children_) size += child->fileSize;
+	return size;
+}
+
+size_t artdaq::hdf5::TeeDataset::getDatasetExtensionCount()
+{
+	size_t count = 0;
+	for (auto const& child : children_) count += child->extensionCount;
+	return count;
+}
+
+void artdaq::hdf5::TeeDataset::forward_(std::function<void(FragmentDataset&)> const& write, bool updateSizes)
+{
+	Job job{write, updateSizes};
+	if (workers_.empty())
+	{
+		for (auto& child : children_) write_(*child, job);
+		rethrowChildErrors_();
+		return;
+	}
+
+	for (auto& worker : workers_)
+	{
+		std::unique_lock<std::mutex> lk(worker->mutex);
+		worker->cv.wait(lk, [&] { return worker->jobs.size() < std::max<size_t>(queueDepth_, 1); });
+		worker->jobs.push_back(job);
+		worker->cv.notify_all();
+	}
+	if (queueDepth_ == 0)
+	{
+		// The job refers to the caller's data, so it must be written before returning
+		waitIdle_();
+	}
+	// Errors are reported after the job has been queued, so that the children which did not fail still receive it
+	rethrowChildErrors_();
+}
+
+void artdaq::hdf5::TeeDataset::work_(Worker& worker)
+{
+	std::unique_lock<std::mutex> lk(worker.mutex);
+	while (true)
+	{
+		worker.cv.wait(lk, [&] { return !worker.jobs.empty() || worker.stop; });
+		if (worker.jobs.empty()) break;  // Stopping, and every queued job has been written
+		auto job = std::move(worker.jobs.front());
+		worker.jobs.pop_front();
+		worker.busy = true;
+		lk.unlock();
+
+		for (auto child : worker.children)
+		{
+			write_(*child, job);
+		}
+
+		lk.lock();
+		worker.busy = false;
+		worker.cv.notify_all();
+	}
+}
+
+void artdaq::hdf5::TeeDataset::write_(Child& child, Job const& job)
+{
+	{
+		std::lock_guard<std::mutex> lk(errorMutex_);
+		if (child.error) return;
+	}
+	try
+	{
+		job.write(*child.dataset);
+		if (job.updateSizes)
+		{
+			child.fileSize = child.dataset->getFileSize();
+			child.extensionCount = child.dataset->getDatasetExtensionCount();
+		}
+	}
+	catch (...)
+	{
+		TLOG(TLVL_ERROR) << "Error writing to a child Dataset, it will not be written to again";
+		std::lock_guard<std::mutex> lk(errorMutex_);
+		child.error = std::current_exception();
+	}
+}
+
+void artdaq::hdf5::TeeDataset::rethrowChildErrors_()
+{
+	std::lock_guard<std::mutex> lk(errorMutex_);
+	std::exception_ptr error;
+	size_t failed = 0;
+	for (auto& child : children_)
+	{
+		if (!child->error) continue;
+		failed++;
+		if (!child->reported && !error)
+		{
+			child->reported = true;
+			error = child->error;
+		}
+	}
+	if (error) std::rethrow_exception(error);
+	if (failed == children_.size())
+	{
+		throw cet::exception("TeeDataset") << "TeeDataset: Every child Dataset has failed";  // NOLINT(cert-err60-cpp)
+	}
+}
+
+void artdaq::hdf5::TeeDataset::waitIdle_()
+{
+	for (auto& worker : workers_)
+	{
+		std::unique_lock<std::mutex> lk(worker->mutex);
+		worker->cv.wait(lk, [&] { return worker->jobs.empty() && !worker->busy; });
+	}
+}
+
+artdaq::Fragments artdaq::hdf5::TeeDataset::unpack_(artdaq::Fragments const& frags) const
+{
+	artdaq::Fragments output;
+	output.reserve(frags.size());
+	for (auto const& frag : frags)
+	{
+		if (frag.type() != artdaq::Fragment::ContainerFragmentType)
+		{
+			output.push_back(frag);
+			continue;
+		}
+		artdaq::ContainerFragment cf(frag);
+		TLOG(TLVL_TRACE) << "unpack_: Decoding ContainerFragment with " << cf.block_count() << " blocks";
+		for (size_t ii = 0; ii < cf.block_count(); ++ii)
+		{
+			output.push_back(*cf.at(ii));
+		}
+	}
+	return output;
+}
+
+DEFINE_ARTDAQ_DATASET_PLUGIN(artdaq::hdf5::TeeDataset)
@@ -0,0 +1,280 @@
+#include "tracemf.h"
+#define TRACE_NAME "DatasetReader"
+
+#include "artdaq-demo-hdf5/Reader/DatasetReader.hh"
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+
+#include <algorithm>
+
+namespace {
+fhicl::ParameterSet makeDatasetConfig(fhicl::ParameterSet dataset_ps)
+{
+	dataset_ps.put_or_replace<std::string>("mode", "read");
+	fhicl::ParameterSet ps;
+	ps.put<fhicl::ParameterSet>("dataset", dataset_ps);
+	return ps;
+}
+
+fhicl::ParameterSet makeDatasetConfig(std::string const& fileName, std::string const& pluginType)
+{
+	fhicl::ParameterSet dataset_ps;
+	dataset_ps.put<std::string>("datasetPluginType", pluginType);
+	dataset_ps.put<std::string>("fileName", fileName);
+	return dataset_ps;
+}
+}  // namespace
+
+artdaq::hdf5::DatasetEvent::DatasetEvent(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> fragments, std::unique_ptr<artdaq::detail::RawEventHeader> header)
+    : fragments_(std::move(fragments))
+    , header_(std::move(header))
+    , sequence_id_(artdaq::Fragment::InvalidSequenceID)
+{
+	// Present the Fragments in type order, so that the order does not depend on the hash map
+	std::vector<artdaq::Fragment::type_t> types;
+	size_t count = 0;
+	for (auto const& type : fragments_)
+	{
+		types.push_back(type.first);
+		count += type.second->size();
+	}
+	std::sort(types.begin(), types.end());
+
+	views_.reserve(count);
+	for (auto type : types)
+	{
+		for (auto const& frag : *fragments_[type])
+		{
+			views_.emplace_back(frag);
+		}
+	}
+
+	if (header_)
+	{
+		sequence_id_ = header_->sequence_id;
+	}
+	else if (!views_.empty())
+	{
+		sequence_id_ = views_.front().sequenceID();
+	}
+}
+
+std::vector<artdaq::hdf5::FragmentView> artdaq::hdf5::DatasetEvent::fragments(artdaq::Fragment::type_t type) const
+{
+	std::vector<FragmentView> output;
+	auto it = fragments_.find(type);
+	if (it != fragments_.end())
+	{
+		output.reserve(it->second->size());
+		for (auto const& frag : *it->second)
+		{
+			output.emplace_back(frag);
+		}
+	}
+	return output;
+}
+
+std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> artdaq::hdf5::DatasetEvent::release()
+{
+	views_.clear();
+	return std::move(fragments_);
+}
+
+artdaq::hdf5::DatasetReader::DatasetReader(fhicl::ParameterSet const& dataset_ps, DatasetReaderOptions options)
+    : options_(std::move(options))
+    , dataset_(MakeDatasetPlugin(makeDatasetConfig(dataset_ps), "dataset"))
+{
+	TLOG(TLVL_DEBUG) << "DatasetReader opened " << dataset_ps.get<std::string>("fileName", "") << " with " << dataset_ps.get<std::string>("datasetPluginType", "")
+	                 << ", prefetch " << options_.prefetch << " events";
+	if (options_.prefetch > 0)
+	{
+		thread_ = std::thread([this] { prefetch_(); });
+	}
+}
+
+artdaq::hdf5::DatasetReader::DatasetReader(std::string const& fileName, std::string const& pluginType, DatasetReaderOptions options)
+    : DatasetReader(makeDatasetConfig(fileName, pluginType), std::move(options))
+{}
+
+artdaq::hdf5::DatasetReader::~DatasetReader() noexcept
+{
+	if (thread_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			stop_ = true;
+		}
+		not_full_.notify_all();
+		thread_.join();
+	}
+}
+
+std::unique_ptr<artdaq::hdf5::DatasetEvent> artdaq::hdf5::DatasetReader::next()
+{
+	if (!thread_.joinable())
+	{
+		return readSelected_();
+	}
+
+	std::unique_lock<std::mutex> lk(mutex_);
+	not_empty_.wait(lk, [this] { return !queue_.empty() || done_; });
+	if (!queue_.empty())
+	{
+		auto event = std::move(queue_.front());
+		queue_.pop_front();
+		not_full_.notify_one();
+		return event;
+	}
+	if (error_)
+	{
+		// Report the error once; later calls see the end of the file
+		std::exception_ptr error;
+		std::swap(error, error_);
+		std::rethrow_exception(error);
+	}
+	return nullptr;
+}
+
+std::unique_ptr<artdaq::hdf5::DatasetEvent> artdaq::hdf5::DatasetReader::readSelected_()
+{
+	if (!eventsSelected_) selectEvents_();
+
+	while (true)
+	{
+		std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> fragments;
+		artdaq::Fragment::sequence_id_t seqID = artdaq::Fragment::InvalidSequenceID;
+		if (readByIndex_)
+		{
+			if (selectedEvents_.empty()) return nullptr;
+			seqID = selectedEvents_.front();
+			selectedEvents_.pop_front();
+			auto lk = lockHDF5_();
+			fragments = dataset_->readEvent(seqID);
+		}
+		else
+		{
+			{
+				auto lk = lockHDF5_();
+				fragments = dataset_->readNextEvent();
+			}
+			if (fragments.empty()) return nullptr;
+
+			for (auto const& type : fragments)
+			{
+				if (!type.second->empty()) seqID = type.second->front().sequenceID();
+			}
+			if (seqID != artdaq::Fragment::InvalidSequenceID && seqID > options_.last_sequence_id)
+			{
+				// Events are read in sequence ID order, so the rest of the file is past the range
+				TLOG(TLVL_DEBUG) << "Event " << seqID << " is past the selected sequence ID range, stopping";
+				readByIndex_ = true;  // With no selected events left, later calls also return nullptr
+				return nullptr;
+			}
+			if (seqID < options_.first_sequence_id)
+			{
+				TLOG(TLVL_TRACE) << "Skipping event " << seqID << ", before the selected sequence ID range";
+				continue;
+			}
+		}
+
+		project_(fragments);
+
+		std::unique_ptr<artdaq::detail::RawEventHeader> header;
+		if (options_.read_headers && seqID != artdaq::Fragment::InvalidSequenceID)
+		{
+			auto lk = lockHDF5_();
+			header = dataset_->getEventHeader(seqID);
+		}
+		if (fragments.empty() && !header) continue;
+
+		return std::make_unique<DatasetEvent>(std::move(fragments), std::move(header));
+	}
+}
+
+void artdaq::hdf5::DatasetReader::selectEvents_()
+{
+	eventsSelected_ = true;
+	if (options_.first_sequence_id == 0 && options_.last_sequence_id == std::numeric_limits<artdaq::Fragment::sequence_id_t>::max())
+	{
+		return;
+	}
+
+	// Only the events in the range are read, instead of reading every event and skipping most of them
+	std::vector<FragmentDatasetEventSummary> events;
+	{
+		auto lk = lockHDF5_();
+		events = dataset_->scanEvents();
+	}
+	if (events.empty())
+	{
+		TLOG(TLVL_DEBUG) << "No event list from the Dataset plugin, reading events until the end of the sequence ID range";
+		return;
+	}
+	readByIndex_ = true;
+	for (auto const& event : events)
+	{
+		if (event.sequence_id >= options_.first_sequence_id && event.sequence_id <= options_.last_sequence_id)
+		{
+			selectedEvents_.push_back(event.sequence_id);
+		}
+	}
+	TLOG(TLVL_DEBUG) << "Reading " << selectedEvents_.size() << " of " << events.size() << " events in the sequence ID range";
+}
+
+void artdaq::hdf5::DatasetReader::project_(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>& fragments) const
+{
+	// Drop the Fragments which were not selected
+	for (auto it = fragments.begin(); it != fragments.end();)
+	{
+		auto& frags = *it->second;
+		if (!options_.types.empty() && options_.types.count(it->first) == 0u)
+		{
+			it = fragments.erase(it);
+			continue;
+		}
+		if (!options_.fragment_ids.empty())
+		{
+			artdaq::Fragments selected;
+			for (auto& frag : frags)
+			{
+				if (options_.fragment_ids.count(frag.fragmentID()) != 0u) selected.emplace_back(std::move(frag));
+			}
+			frags.swap(selected);
+		}
+		it = frags.empty() ? fragments.erase(it) : std::next(it);
+	}
+}
+
+std::unique_lock<std::mutex> artdaq::hdf5::DatasetReader::lockHDF5_()
+{
+	return options_.hdf5_mutex != nullptr ? std::unique_lock<std::mutex>(*options_.hdf5_mutex) : std::unique_lock<std::mutex>();
+}
+
+void artdaq::hdf5::DatasetReader::prefetch_()
+{
+	TLOG(TLVL_DEBUG) << "Read-ahead thread started";
+	try
+	{
+		while (true)
+		{
+			auto event = readSelected_();
+
+			std::unique_lock<std::mutex> lk(mutex_);
+			if (!event) break;
+			not_full_.wait(lk, [this] { return queue_.size() < options_.prefetch || stop_; });
+			if (stop_) break;
+			queue_.push_back(std::move(event));
+			not_empty_.notify_one();
+		}
+	}
+	catch (...)
+	{
+		TLOG(TLVL_ERROR) << "Error reading events, it will be reported by DatasetReader::next";
+		std::lock_guard<std::mutex> lk(mutex_);
+		error_ = std::current_exception();
+	}
+
+	std::lock_guard<std::mutex> lk(mutex_);
+	done_ = true;
+	not_empty_.notify_all();
+	TLOG(TLVL_DEBUG) << "Read-ahead thread done";
+}
@@ -0,0 +1,306 @@
+#ifndef artdaq_demo_hdf5_Reader_DatasetReader_hh
+#define artdaq_demo_hdf5_Reader_DatasetReader_hh 1
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Data/RawEvent.hh"
+#include "artdaq-demo-hdf5/HDF5/FragmentDataset.hh"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+namespace artdaq {
+namespace hdf5 {
+
+/**
+ * @brief Non-owning view of a contiguous range of values (std::span for C++17 code)
+ *
+ * Converts to std::span where the standard library provides it.
+ */
+template<typename T>
+class DataSpan
+{
+public:
+	/**
+	 * @brief DataSpan Constructor
+	 * @param data First value
+	 * @param size Number of values
+	 */
+	DataSpan(T* data, size_t size)
+	    : data_(data), size_(size) {}
+
+	T* data() const { return data_; }                     ///< @return Pointer to the first value
+	size_t size() const { return size_; }                 ///< @return Number of values
+	size_t size_bytes() const { return size_ * sizeof(T); }  ///< @return Size of the range, in bytes
+	bool empty() const { return size_ == 0; }             ///< @return Whether the range is empty
+	T* begin() const { return data_; }                    ///< @return Iterator to the first value
+	T* end() const { return data_ + size_; }              ///< @return Iterator past the last value
+	T& operator[](size_t ii) const { return data_[ii]; }  ///< @return Value ii of the range
+
+#if defined(__cpp_lib_span)
+	operator std::span<T>() const { return std::span<T>(data_, size_); }  ///< @return The range as a std::span
+#endif
+
+private:
+	T* data_;
+	size_t size_;
+};
+
+/**
+ * @brief Read-only view of one Fragment of a DatasetEvent
+ *
+ * Header fields are decoded from the Fragment's header only when they are asked for, and the metadata and payload are
+ * exposed as spans over the Fragment's own storage, without copies. A FragmentView is valid as long as its DatasetEvent.
+ */
+class FragmentView
+{
+public:
+	/**
+	 * @brief FragmentView Constructor
+	 * @param frag Fragment to view
+	 */
+	explicit FragmentView(artdaq::Fragment const& frag)
+	    : frag_(&frag) {}
+
+	artdaq::Fragment::sequence_id_t sequenceID() const { return frag_->sequenceID(); }  ///< @return Sequence ID of the Fragment
+	artdaq::Fragment::fragment_id_t fragmentID() const { return frag_->fragmentID(); }  ///< @return Fragment ID of the Fragment
+	artdaq::Fragment::type_t type() const { return frag_->type(); }                      ///< @return Type of the Fragment
+	artdaq::Fragment::timestamp_t timestamp() const { return frag_->timestamp(); }       ///< @return Timestamp of the Fragment
+	size_t sizeBytes() const { return frag_->sizeBytes(); }                              ///< @return Size of the Fragment (header included), in bytes
+
+	/**
+	 * @brief Get the whole Fragment, header included
+	 * @return Span over the words of the Fragment
+	 */
+	DataSpan<artdaq::RawDataType const> words() const { return DataSpan<artdaq::RawDataType const>(frag_->headerBegin(), frag_->size()); }
+	/**
+	 * @brief Get the metadata of the Fragment
+	 * @return Span over the metadata bytes (empty if the Fragment has no metadata)
+	 */
+	DataSpan<artdaq::Fragment::byte_t const> metadata() const
+	{
+		auto begin = reinterpret_cast<artdaq::Fragment::byte_t const*>(frag_->headerBegin() + frag_->headerSizeWords());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return DataSpan<artdaq::Fragment::byte_t const>(begin, frag_->dataBeginBytes() - begin);
+	}
+	/**
+	 * @brief Get the payload of the Fragment
+	 * @return Span over the payload bytes
+	 */
+	DataSpan<artdaq::Fragment::byte_t const> payload() const { return DataSpan<artdaq::Fragment::byte_t const>(frag_->dataBeginBytes(), frag_->dataSizeBytes()); }
+	/**
+	 * @brief Get the underlying Fragment, e.g. for overlay classes
+	 * @return The Fragment
+	 */
+	artdaq::Fragment const& fragment() const { return *frag_; }
+
+private:
+	artdaq::Fragment const* frag_;
+};
+
+/**
+ * @brief One event read by a DatasetReader
+ */
+class DatasetEvent
+{
+public:
+	/**
+	 * @brief DatasetEvent Constructor
+	 * @param fragments Fragments of the event, by type (as returned by FragmentDataset::readNextEvent)
+	 * @param header RawEventHeader of the event (may be nullptr)
+	 */
+	DatasetEvent(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> fragments, std::unique_ptr<artdaq::detail::RawEventHeader> header);
+
+	/**
+	 * @brief Get the sequence ID of the event
+	 * @return Sequence ID from the header, or from the first Fragment if there is no header
+	 */
+	artdaq::Fragment::sequence_id_t sequenceID() const { return sequence_id_; }
+	/**
+	 * @brief Get the RawEventHeader of the event
+	 * @return Pointer to the header, nullptr if the file has none for this event or headers were not requested
+	 */
+	artdaq::detail::RawEventHeader const* header() const { return header_.get(); }
+
+	size_t size() const { return views_.size(); }                                   ///< @return Number of Fragments in the event
+	bool empty() const { return views_.empty(); }                                   ///< @return Whether the event has no Fragments
+	FragmentView const& operator[](size_t ii) const { return views_[ii]; }          ///< @return Fragment ii of the event
+	std::vector<FragmentView>::const_iterator begin() const { return views_.begin(); }  ///< @return Iterator to the first Fragment
+	std::vector<FragmentView>::const_iterator end() const { return views_.end(); }      ///< @return Iterator past the last Fragment
+
+	/**
+	 * @brief Get the Fragments of one type
+	 * @param type Fragment type
+	 * @return Views of the Fragments of this type (empty if there are none)
+	 */
+	std::vector<FragmentView> fragments(artdaq::Fragment::type_t type) const;
+	/**
+	 * @brief Take ownership of the Fragments, e.g. to hand them to other code; the views of this event become invalid
+	 * @return Fragments of the event, by type
+	 */
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> release();
+
+private:
+	std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>> fragments_;
+	std::unique_ptr<artdaq::detail::RawEventHeader> header_;
+	std::vector<FragmentView> views_;
+	artdaq::Fragment::sequence_id_t sequence_id_;
+};
+
+/**
+ * @brief Event selection and read-ahead settings of a DatasetReader
+ */
+struct DatasetReaderOptions
+{
+	std::set<artdaq::Fragment::type_t> types;              ///< Fragment types to return (all types if empty)
+	std::set<artdaq::Fragment::fragment_id_t> fragment_ids;  ///< Fragment IDs to return (all IDs if empty)
+	artdaq::Fragment::sequence_id_t first_sequence_id{0};  ///< Events with lower sequence IDs are skipped
+	artdaq::Fragment::sequence_id_t last_sequence_id{std::numeric_limits<artdaq::Fragment::sequence_id_t>::max()};  ///< Events with higher sequence IDs are skipped
+	bool read_headers{true};                               ///< Whether the RawEventHeader of each event is read
+	size_t prefetch{0};                                    ///< Number of events read ahead on a background thread (0 reads on the calling thread)
+	std::mutex* hdf5_mutex{nullptr};                       ///< If set, held around every call into the plugin, so that other threads can share a serial HDF5 library
+};
+
+/**
+ * @brief Reads events from a file written by any FragmentDataset plugin, without art
+ *
+ * The reader loads the plugin with MakeDatasetPlugin and returns one DatasetEvent at a time, either through next() or
+ * by iterating over the reader. Fragments which do not pass the projection in DatasetReaderOptions are dropped before
+ * events are returned. The projection is applied after each event has been read in full, so it limits what is
+ * returned (and kept in memory), not what is read from the file.
+ *
+ * With a sequence ID range, the reader lists the events with FragmentDataset::scanEvents and reads only those in the
+ * range, with readEvent. For plugins which do not support scanning, events are read with readNextEvent, those before
+ * the range are skipped, and reading stops at the first event past the range.
+ *
+ * With prefetch > 0, events are read on a background thread into a queue of that depth, so that reading overlaps the
+ * processing of earlier events. The plugin is then only used from that thread; unless the HDF5 library is built
+ * thread-safe, the application must not make other HDF5 calls while the reader is open, or must hold hdf5_mutex
+ * (see DatasetReaderOptions) around them.
+ */
+class DatasetReader
+{
+public:
+	/**
+	 * @brief DatasetReader Constructor
+	 * @param dataset_ps Dataset plugin configuration ("datasetPluginType", "fileName", and any plugin parameters); "mode" is set to "read"
+	 * @param options Event selection and read-ahead settings
+	 */
+	explicit DatasetReader(fhicl::ParameterSet const& dataset_ps, DatasetReaderOptions options = DatasetReaderOptions());
+	/**
+	 * @brief DatasetReader Constructor
+	 * @param fileName File to read
+	 * @param pluginType Dataset plugin which wrote the file
+	 * @param options Event selection and read-ahead settings
+	 */
+	DatasetReader(std::string const& fileName, std::string const& pluginType, DatasetReaderOptions options = DatasetReaderOptions());
+	/**
+	 * @brief DatasetReader Destructor, stops the read-ahead thread
+	 */
+	~DatasetReader() noexcept;
+
+	/**
+	 * @brief Read the next selected event
+	 * @return The event, or nullptr at the end of the file
+	 *
+	 * Errors from the plugin are rethrown here, also when they happened on the read-ahead thread.
+	 */
+	std::unique_ptr<DatasetEvent> next();
+
+	/**
+	 * @brief Input iterator over the events of a DatasetReader
+	 */
+	class iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;  ///< Single-pass iterator
+		using value_type = DatasetEvent;                    ///< Events
+		using difference_type = std::ptrdiff_t;             ///< Not meaningful for an input iterator
+		using pointer = DatasetEvent*;                      ///< Pointer to an event
+		using reference = DatasetEvent&;                    ///< Reference to an event
+
+		/**
+		 * @brief iterator Constructor
+		 * @param reader Reader to iterate over, nullptr for the end iterator
+		 */
+		explicit iterator(DatasetReader* reader)
+		    : reader_(reader)
+		{
+			if (reader_) ++(*this);
+		}
+		reference operator*() const { return *event_; }   ///< @return Current event
+		pointer operator->() const { return event_.get(); }  ///< @return Current event
+		/**
+		 * @brief Read the next event
+		 * @return This iterator
+		 */
+		iterator& operator++()
+		{
+			event_ = reader_->next();
+			if (!event_) reader_ = nullptr;
+			return *this;
+		}
+		bool operator==(iterator const& other) const { return reader_ == other.reader_; }  ///< @return Whether both iterators are at the same reader (or both at the end)
+		bool operator!=(iterator const& other) const { return !(*this == other); }         ///< @return Whether the iterators differ
+
+	private:
+		DatasetReader* reader_;
+		std::unique_ptr<DatasetEvent> event_;
+	};
+
+	iterator begin() { return iterator(this); }  ///< @return Iterator at the next event
+	iterator end() { return iterator(nullptr); }  ///< @return End iterator
+
+	/**
+	 * @brief Get the Dataset plugin, e.g. for getTimeIndex or readTimeRange
+	 * @return The FragmentDataset
+	 *
+	 * Must not be used while the read-ahead thread is running (prefetch > 0).
+	 */
+	FragmentDataset& dataset() { return *dataset_; }
+
+private:
+	DatasetReader(DatasetReader const&) = delete;
+	DatasetReader(DatasetReader&&) = delete;
+	DatasetReader& operator=(DatasetReader const&) = delete;
+	DatasetReader& operator=(DatasetReader&&) = delete;
+
+	std::unique_ptr<DatasetEvent> readSelected_();
+	void selectEvents_();
+	void project_(std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>& fragments) const;
+	std::unique_lock<std::mutex> lockHDF5_();
+	void prefetch_();
+
+	DatasetReaderOptions options_;
+	std::unique_ptr<FragmentDataset> dataset_;
+	bool eventsSelected_{false};                                   ///< Whether selectEvents_ has run
+	bool readByIndex_{false};                                      ///< Whether events are read with readEvent from selectedEvents_
+	std::deque<artdaq::Fragment::sequence_id_t> selectedEvents_;  ///< Events in the sequence ID range not yet read
+
+	std::mutex mutex_;
+	std::condition_variable not_empty_;
+	std::condition_variable not_full_;
+	std::deque<std::unique_ptr<DatasetEvent>> queue_;
+	bool done_{false};
+	bool stop_{false};
+	std::exception_ptr error_;
+	std::thread thread_;
+};
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_Reader_DatasetReader_hh
@@ -0,0 +1,157 @@
+#include "artdaq-demo-hdf5/ArtModules/detail/FragmentSelector.hh"
+
+#define BOOST_TEST_MODULE FragmentSelector_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <vector>
+
+namespace {
+artdaq::Fragment makeFragment(artdaq::Fragment::type_t type, artdaq::Fragment::fragment_id_t id = 1, artdaq::Fragment::timestamp_t timestamp = 1000, size_t words = 4)
+{
+	artdaq::Fragment frag(words);
+	frag.setSequenceID(1);
+	frag.setFragmentID(id);
+	if (type == artdaq::Fragment::ContainerFragmentType)
+	{
+		frag.setSystemType(type);
+	}
+	else
+	{
+		frag.setUserType(type);
+	}
+	frag.setTimestamp(timestamp);
+	return frag;
+}
+
+artdaq::detail::FragmentSelector makeSelector(std::string const& config)
+{
+	return artdaq::detail::FragmentSelector(fhicl::ParameterSet::make(config));
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(FragmentSelector_test)
+
+BOOST_AUTO_TEST_CASE(Default)
+{
+	auto selector = makeSelector("");
+	BOOST_REQUIRE(!selector.enabled());
+	BOOST_REQUIRE(!selector.selectsFragments());
+	BOOST_REQUIRE(!selector.requiresTrigger());
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1)));
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(200, 65000, 0)));
+	BOOST_REQUIRE(selector.acceptEvent(false, false));
+	BOOST_REQUIRE(selector.acceptEvent(false, false));
+}
+
+BOOST_AUTO_TEST_CASE(Types)
+{
+	auto selector = makeSelector("includeTypes: [1, 2] excludeTypes: [2]");
+	BOOST_REQUIRE(selector.enabled());
+	BOOST_REQUIRE(selector.selectsFragments());
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(2)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(3)));
+
+	auto excludeOnly = makeSelector("excludeTypes: [3]");
+	BOOST_REQUIRE(excludeOnly.acceptFragment(makeFragment(1)));
+	BOOST_REQUIRE(!excludeOnly.acceptFragment(makeFragment(3)));
+}
+
+BOOST_AUTO_TEST_CASE(FragmentIDs)
+{
+	auto selector = makeSelector("includeFragmentIDs: [5, 6] excludeFragmentIDs: [6]");
+	BOOST_REQUIRE(selector.selectsFragments());
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1, 5)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 6)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 7)));
+
+	auto excludeOnly = makeSelector("excludeFragmentIDs: [65535]");
+	BOOST_REQUIRE(excludeOnly.acceptFragment(makeFragment(1, 0)));
+	BOOST_REQUIRE(!excludeOnly.acceptFragment(makeFragment(1, 65535)));
+}
+
+BOOST_AUTO_TEST_CASE(TimestampWindows)
+{
+	// Overlapping windows are merged, empty windows are ignored
+	auto selector = makeSelector("timestampWindows: [[500, 600], [100, 200], [150, 300], [700, 700]]");
+	BOOST_REQUIRE(selector.selectsFragments());
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 1, 0)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 1, 99)));
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1, 1, 100)));
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1, 1, 250)));
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1, 1, 299)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 1, 300)));
+	BOOST_REQUIRE(selector.acceptFragment(makeFragment(1, 1, 550)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 1, 600)));
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(1, 1, 700)));
+
+	auto noValidWindows = makeSelector("timestampWindows: [[10, 10]]");
+	BOOST_REQUIRE(!noValidWindows.selectsFragments());
+	BOOST_REQUIRE(noValidWindows.acceptFragment(makeFragment(1, 1, 10)));
+}
+
+BOOST_AUTO_TEST_CASE(Containers)
+{
+	// ContainerFragments are selected by their own type, ID and timestamp, not by their contents
+	auto selector = makeSelector("includeTypes: [1]");
+	BOOST_REQUIRE(!selector.acceptFragment(makeFragment(artdaq::Fragment::ContainerFragmentType)));
+
+	auto containers = makeSelector("includeTypes: [" + std::to_string(artdaq::Fragment::ContainerFragmentType) + "] includeFragmentIDs: [3]");
+	BOOST_REQUIRE(containers.acceptFragment(makeFragment(artdaq::Fragment::ContainerFragmentType, 3)));
+	BOOST_REQUIRE(!containers.acceptFragment(makeFragment(artdaq::Fragment::ContainerFragmentType, 4)));
+}
+
+BOOST_AUTO_TEST_CASE(SelectFragments)
+{
+	auto selector = makeSelector("includeFragmentIDs: [1, 3]");
+	artdaq::Fragments frags;
+	for (artdaq::Fragment::fragment_id_t id = 1; id <= 4; ++id) frags.push_back(makeFragment(1, id, 1000, id));
+
+	artdaq::Fragments selected;
+	size_t rejectedBytes = 0;
+	BOOST_REQUIRE(!selector.selectFragments(frags, selected, rejectedBytes));
+	BOOST_REQUIRE_EQUAL(selected.size(), 2u);
+	BOOST_REQUIRE_EQUAL(selected[0].fragmentID(), 1);
+	BOOST_REQUIRE_EQUAL(selected[1].fragmentID(), 3);
+	BOOST_REQUIRE_EQUAL(rejectedBytes, frags[1].sizeBytes() + frags[3].sizeBytes());
+
+	// Nothing is copied when every Fragment is selected
+	artdaq::Fragments all{frags[0], frags[2]};
+	selected.clear();
+	rejectedBytes = 0;
+	BOOST_REQUIRE(selector.selectFragments(all, selected, rejectedBytes));
+	BOOST_REQUIRE(selected.empty());
+	BOOST_REQUIRE_EQUAL(rejectedBytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Events)
+{
+	auto trigger = makeSelector("triggerTypes: [4] requireComplete: true");
+	BOOST_REQUIRE(trigger.enabled());
+	BOOST_REQUIRE(trigger.requiresTrigger());
+	BOOST_REQUIRE(!trigger.selectsFragments());
+	BOOST_REQUIRE(trigger.hasTrigger(artdaq::Fragments{makeFragment(1), makeFragment(4)}));
+	BOOST_REQUIRE(!trigger.hasTrigger(artdaq::Fragments{makeFragment(1), makeFragment(2)}));
+	BOOST_REQUIRE(!trigger.acceptEvent(false, true));
+	BOOST_REQUIRE(!trigger.acceptEvent(true, false));
+	BOOST_REQUIRE(trigger.acceptEvent(true, true));
+}
+
+BOOST_AUTO_TEST_CASE(Prescale)
+{
+	// Only events passing the other requirements are counted by the prescale
+	auto selector = makeSelector("prescale: 3 requireComplete: true");
+	std::vector<bool> accepted;
+	for (int ii = 0; ii < 7; ++ii)
+	{
+		BOOST_REQUIRE(!selector.acceptEvent(true, false));
+		accepted.push_back(selector.acceptEvent(true, true));
+	}
+	BOOST_REQUIRE(accepted == (std::vector<bool>{true, false, false, true, false, false, true}));
+
+	auto zero = makeSelector("prescale: 0");
+	BOOST_REQUIRE(zero.acceptEvent(false, false));
+	BOOST_REQUIRE(zero.acceptEvent(false, false));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,262 @@
+#ifndef artdaq_demo_hdf5_test_HDF5_DatasetTestUtils_hh
+#define artdaq_demo_hdf5_test_HDF5_DatasetTestUtils_hh 1
+
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+
+#include "cetlib/quiet_unit_test.hpp"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+// Shared fixture of the Dataset plugin tests. Include it after defining BOOST_TEST_MODULE and including
+// cetlib/quiet_unit_test.hpp.
+
+namespace artdaq {
+namespace hdf5 {
+namespace test {
+
+/// Map of Fragment type to Fragments, as returned by the FragmentDataset read functions
+using FragmentMap = std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>;
+/// Function producing the Fragments of the event with the given sequence ID
+using EventMaker = std::function<artdaq::Fragments(artdaq::Fragment::sequence_id_t)>;
+
+/**
+ * @brief Create a Fragment whose payload identifies its event, Fragment ID and word
+ * @param seqID Sequence ID of the Fragment
+ * @param id Fragment ID of the Fragment
+ * @param type User type of the Fragment
+ * @param words Payload size, in words
+ * @return Fragment with timestamp 1000 * seqID + id
+ */
+inline artdaq::Fragment makeFragment(artdaq::Fragment::sequence_id_t seqID, artdaq::Fragment::fragment_id_t id, artdaq::Fragment::type_t type, size_t words)
+{
+	artdaq::Fragment frag(words);
+	frag.setSequenceID(seqID);
+	frag.setFragmentID(id);
+	frag.setUserType(type);
+	frag.setTimestamp(1000 * seqID + id);
+	for (size_t ii = 0; ii < words; ++ii)
+	{
+		*(frag.dataBegin() + ii) = (seqID << 48) + (static_cast<uint64_t>(id) << 32) + ii;
+	}
+	return frag;
+}
+
+/**
+ * @brief Create the Fragments of a test event
+ * @param seqID Sequence ID of the event
+ * @return Type 1 Fragments with IDs 0 (3 + 5 * seqID words) and 1 (20 words), and a type 2 Fragment with ID 2 (7 * seqID words)
+ *
+ * The sizes vary from event to event, so that Fragments straddle the chunks and rows of the datasets they are written to.
+ */
+inline artdaq::Fragments makeEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	artdaq::Fragments frags;
+	frags.push_back(makeFragment(seqID, 0, 1, 3 + 5 * seqID));
+	frags.push_back(makeFragment(seqID, 1, 1, 20));
+	frags.push_back(makeFragment(seqID, 2, 2, 7 * seqID));
+	return frags;
+}
+
+/**
+ * @brief Create the RawEventHeader of a test event
+ * @param seqID Sequence ID of the event
+ * @return Header with run 1, subrun 2, event 10 + seqID and timestamp 1000 * seqID, complete unless seqID is a multiple of 3
+ */
+inline artdaq::detail::RawEventHeader makeHeader(artdaq::Fragment::sequence_id_t seqID)
+{
+	artdaq::detail::RawEventHeader hdr(1, 2, 10 + seqID, seqID, 1000 * seqID);
+	hdr.is_complete = seqID % 3 != 0;
+	return hdr;
+}
+
+/**
+ * @brief Create the configuration table of a Dataset plugin
+ * @param pluginType Value of datasetPluginType
+ * @param fileName File to read or write
+ * @param mode "read" or "write"
+ * @param extra Additional FHiCL parameters of the plugin
+ * @return ParameterSet of the plugin
+ */
+inline fhicl::ParameterSet makeDatasetConfig(std::string const& pluginType, std::string const& fileName, std::string const& mode, std::string const& extra = "")
+{
+	auto dataset = fhicl::ParameterSet::make(extra);
+	dataset.put("datasetPluginType", pluginType);
+	dataset.put("fileName", fileName);
+	dataset.put("mode", mode);
+	return dataset;
+}
+
+/**
+ * @brief Load a Dataset plugin
+ * @param dataset ParameterSet of the plugin (see makeDatasetConfig)
+ * @return The FragmentDataset
+ */
+inline std::unique_ptr<FragmentDataset> openDataset(fhicl::ParameterSet const& dataset)
+{
+	fhicl::ParameterSet ps;
+	ps.put("dataset", dataset);
+	auto output = MakeDatasetPlugin(ps, "dataset");
+	BOOST_REQUIRE(output);
+	return output;
+}
+
+/**
+ * @brief Load a Dataset plugin
+ * @param pluginType Value of datasetPluginType
+ * @param fileName File to read or write
+ * @param mode "read" or "write"
+ * @param extra Additional FHiCL parameters of the plugin
+ * @return The FragmentDataset
+ */
+inline std::unique_ptr<FragmentDataset> openDataset(std::string const& pluginType, std::string const& fileName, std::string const& mode, std::string const& extra = "")
+{
+	return openDataset(makeDatasetConfig(pluginType, fileName, mode, extra));
+}
+
+/**
+ * @brief Write events 1 to events, with their headers
+ * @param dataset FragmentDataset to write to
+ * @param events Number of events to write
+ * @param maker Function creating the Fragments of each event
+ *
+ * The first Fragment of each event is written with insertOne and the others with insertMany, so that both are used.
+ */
+inline void writeEvents(FragmentDataset& dataset, artdaq::Fragment::sequence_id_t events, EventMaker const& maker = makeEvent)
+{
+	for (artdaq::Fragment::sequence_id_t seqID = 1; seqID <= events; ++seqID)
+	{
+		dataset.insertHeader(makeHeader(seqID));
+		auto frags = maker(seqID);
+		dataset.insertOne(frags.front());
+		dataset.insertMany(artdaq::Fragments(frags.begin() + 1, frags.end()));
+	}
+}
+
+/**
+ * @brief Write a file with events 1 to events, and close it
+ * @param pluginType Value of datasetPluginType
+ * @param fileName File to write
+ * @param extra Additional FHiCL parameters of the plugin
+ * @param events Number of events to write
+ * @param maker Function creating the Fragments of each event
+ */
+inline void writeFile(std::string const& pluginType, std::string const& fileName, std::string const& extra, artdaq::Fragment::sequence_id_t events, EventMaker const& maker = makeEvent)
+{
+	writeEvents(*openDataset(pluginType, fileName, "write", extra), events, maker);
+}
+
+/**
+ * @brief Sort Fragments by sequence ID and Fragment ID
+ * @param frags Fragments to sort
+ */
+inline void sortFragments(artdaq::Fragments& frags)
+{
+	std::sort(frags.begin(), frags.end(), [](artdaq::Fragment const& a, artdaq::Fragment const& b) { return std::make_tuple(a.sequenceID(), a.fragmentID()) < std::make_tuple(b.sequenceID(), b.fragmentID()); });
+}
+
+/**
+ * @brief Collect the Fragments of an event read from a Dataset, checking that each is stored under its own type
+ * @param event Event as returned by readNextEvent or readEvent
+ * @return The Fragments of the event, sorted by sequence ID and Fragment ID
+ */
+inline artdaq::Fragments flatten(FragmentMap const& event)
+{
+	artdaq::Fragments output;
+	for (auto const& type : event)
+	{
+		for (auto const& frag : *type.second)
+		{
+			BOOST_REQUIRE_EQUAL(frag.type(), type.first);
+			output.push_back(frag);
+		}
+	}
+	sortFragments(output);
+	return output;
+}
+
+/**
+ * @brief Check that Fragments read back match the Fragments written
+ * @param expected Fragments written, sorted by sequence ID and Fragment ID
+ * @param actual Fragments read, sorted by sequence ID and Fragment ID
+ */
+inline void requireSameFragments(artdaq::Fragments const& expected, artdaq::Fragments const& actual)
+{
+	BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+	for (size_t ii = 0; ii < expected.size(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(actual[ii].sequenceID(), expected[ii].sequenceID());
+		BOOST_REQUIRE_EQUAL(actual[ii].fragmentID(), expected[ii].fragmentID());
+		BOOST_REQUIRE_EQUAL(actual[ii].type(), expected[ii].type());
+		BOOST_REQUIRE_EQUAL(actual[ii].timestamp(), expected[ii].timestamp());
+		BOOST_REQUIRE_EQUAL(actual[ii].dataSize(), expected[ii].dataSize());
+		BOOST_REQUIRE(std::equal(actual[ii].dataBegin(), actual[ii].dataEnd(), expected[ii].dataBegin()));
+	}
+}
+
+/**
+ * @brief Check that an event read back matches the test event written
+ * @param seqID Sequence ID of the event
+ * @param event Event as returned by readNextEvent or readEvent
+ */
+inline void requireEvent(artdaq::Fragment::sequence_id_t seqID, FragmentMap const& event)
+{
+	requireSameFragments(makeEvent(seqID), flatten(event));
+}
+
+/**
+ * @brief Check that a header read back matches the test header written
+ * @param seqID Sequence ID of the event
+ * @param hdr Header as returned by getEventHeader
+ */
+inline void requireHeader(artdaq::Fragment::sequence_id_t seqID, std::unique_ptr<artdaq::detail::RawEventHeader> const& hdr)
+{
+	auto expected = makeHeader(seqID);
+	BOOST_REQUIRE(hdr);
+	BOOST_REQUIRE_EQUAL(hdr->run_id, expected.run_id);
+	BOOST_REQUIRE_EQUAL(hdr->subrun_id, expected.subrun_id);
+	BOOST_REQUIRE_EQUAL(hdr->event_id, expected.event_id);
+	BOOST_REQUIRE_EQUAL(hdr->sequence_id, expected.sequence_id);
+	BOOST_REQUIRE_EQUAL(hdr->timestamp, expected.timestamp);
+	BOOST_REQUIRE_EQUAL(hdr->is_complete, expected.is_complete);
+}
+
+/**
+ * @brief Read every event with readNextEvent, and check the events and their headers
+ * @param dataset FragmentDataset to read
+ * @param events Number of events written (events 1 to events, see writeEvents)
+ *
+ * Events are matched by sequence ID, as some plugins do not return them in sequence ID order.
+ */
+inline void requireAllEvents(FragmentDataset& dataset, artdaq::Fragment::sequence_id_t events)
+{
+	std::map<artdaq::Fragment::sequence_id_t, artdaq::Fragments> read;
+	for (artdaq::Fragment::sequence_id_t ii = 1; ii <= events; ++ii)
+	{
+		auto event = flatten(dataset.readNextEvent());
+		BOOST_REQUIRE(!event.empty());
+		auto seqID = event.front().sequenceID();
+		BOOST_REQUIRE(read.emplace(seqID, std::move(event)).second);
+	}
+	BOOST_REQUIRE(dataset.readNextEvent().empty());
+
+	BOOST_REQUIRE_EQUAL(read.size(), events);
+	for (artdaq::Fragment::sequence_id_t seqID = 1; seqID <= events; ++seqID)
+	{
+		requireSameFragments(makeEvent(seqID), read[seqID]);
+		requireHeader(seqID, dataset.getEventHeader(seqID));
+	}
+	BOOST_REQUIRE(!dataset.getEventHeader(events + 1));
+}
+
+}  // namespace test
+}  // namespace hdf5
+}  // namespace artdaq
+
+#endif  // artdaq_demo_hdf5_test_HDF5_DatasetTestUtils_hh
@@ -0,0 +1,123 @@
+#include "artdaq-demo-hdf5/HDF5/FragmentChecksum.hh"
+
+#define BOOST_TEST_MODULE FragmentChecksum_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+/// CRC-32C test vectors from RFC 3720, appendix B.4, and the common "123456789" check value
+struct KnownAnswer
+{
+	std::vector<uint8_t> data;
+	uint32_t crc;
+};
+
+std::vector<KnownAnswer> knownAnswers()
+{
+	std::vector<KnownAnswer> answers;
+	answers.push_back(KnownAnswer{std::vector<uint8_t>(), 0x00000000});
+	answers.push_back(KnownAnswer{std::vector<uint8_t>(32, 0x00), 0x8A9136AA});
+	answers.push_back(KnownAnswer{std::vector<uint8_t>(32, 0xFF), 0x62A8AB43});
+	std::vector<uint8_t> ascending(32);
+	std::iota(ascending.begin(), ascending.end(), 0);
+	answers.push_back(KnownAnswer{ascending, 0x46DD794E});
+	answers.push_back(KnownAnswer{std::vector<uint8_t>(ascending.rbegin(), ascending.rend()), 0x113FDB5C});
+	std::string check = "123456789";
+	answers.push_back(KnownAnswer{std::vector<uint8_t>(check.begin(), check.end()), 0xE3069283});
+	return answers;
+}
+
+std::vector<uint8_t> randomBytes(size_t bytes)
+{
+	std::mt19937 engine(12345);
+	std::uniform_int_distribution<int> dist(0, 255);
+	std::vector<uint8_t> data(bytes);
+	for (auto& byte : data) byte = static_cast<uint8_t>(dist(engine));
+	return data;
+}
+
+artdaq::Fragment makeFragment()
+{
+	artdaq::Fragment frag(100);
+	frag.setSequenceID(42);
+	frag.setFragmentID(7);
+	frag.setUserType(3);
+	frag.setTimestamp(0x123456789ABCULL);
+	std::iota(frag.dataBegin(), frag.dataEnd(), 1000);
+	return frag;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(FragmentChecksum_test)
+
+BOOST_AUTO_TEST_CASE(SoftwareKnownAnswers)
+{
+	for (auto const& answer : knownAnswers())
+	{
+		BOOST_REQUIRE_EQUAL(artdaq::hdf5::crc32cSoftware(answer.data.data(), answer.data.size()), answer.crc);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DispatchedKnownAnswers)
+{
+	// crc32c uses SSE4.2 on x86-64 and the ARMv8 CRC32 instructions on AArch64 when the CPU provides them
+#if defined(__x86_64__)
+	BOOST_TEST_MESSAGE("crc32c uses " << (artdaq::hdf5::crc32cIsHardware() ? "SSE4.2" : "the table"));
+#elif defined(__aarch64__)
+	BOOST_TEST_MESSAGE("crc32c uses " << (artdaq::hdf5::crc32cIsHardware() ? "ARMv8 CRC32" : "the table"));
+#endif
+	for (auto const& answer : knownAnswers())
+	{
+		BOOST_REQUIRE_EQUAL(artdaq::hdf5::crc32c(answer.data.data(), answer.data.size()), answer.crc);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PathsAgree)
+{
+	// Every length and alignment, so that both the 8-byte loop and the byte tail are covered
+	auto data = randomBytes(300);
+	for (size_t offset = 0; offset < 8; ++offset)
+	{
+		for (size_t bytes = 0; bytes + offset <= 264; ++bytes)
+		{
+			BOOST_REQUIRE_EQUAL(artdaq::hdf5::crc32c(data.data() + offset, bytes), artdaq::hdf5::crc32cSoftware(data.data() + offset, bytes));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Incremental)
+{
+	auto data = randomBytes(1000);
+	auto whole = artdaq::hdf5::crc32c(data.data(), data.size());
+	BOOST_REQUIRE_EQUAL(whole, artdaq::hdf5::crc32cSoftware(data.data(), data.size()));
+	for (size_t split : std::vector<size_t>{0, 1, 7, 8, 333, 999, 1000})
+	{
+		auto first = artdaq::hdf5::crc32c(data.data(), split);
+		BOOST_REQUIRE_EQUAL(artdaq::hdf5::crc32c(data.data() + split, data.size() - split, first), whole);
+		auto firstSoftware = artdaq::hdf5::crc32cSoftware(data.data(), split);
+		BOOST_REQUIRE_EQUAL(artdaq::hdf5::crc32cSoftware(data.data() + split, data.size() - split, firstSoftware), whole);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FragmentChecksum)
+{
+	auto frag = makeFragment();
+	auto checksum = artdaq::hdf5::fragmentChecksum(frag);
+	BOOST_REQUIRE_EQUAL(artdaq::hdf5::fragmentChecksum(frag.headerAddress()), checksum);
+
+	auto changedPayload = frag;
+	*(changedPayload.dataBegin() + 50) ^= 1;
+	BOOST_REQUIRE_NE(artdaq::hdf5::fragmentChecksum(changedPayload), checksum);
+
+	auto changedHeader = frag;
+	changedHeader.setSequenceID(43);
+	BOOST_REQUIRE_NE(artdaq::hdf5::fragmentChecksum(changedHeader), checksum);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+#define BOOST_TEST_MODULE TeeDataset_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include "DatasetTestUtils.hh"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace artdaq::hdf5::test;
+
+namespace {
+fhicl::ParameterSet makeTeeConfig(std::string const& mode, std::string const& config, std::vector<fhicl::ParameterSet> const& children)
+{
+	auto tee = fhicl::ParameterSet::make("datasetPluginType: TeeDataset " + config);
+	tee.put("mode", mode);
+	tee.put("children", children);
+	return tee;
+}
+
+void readFile(fhicl::ParameterSet const& dataset_ps, artdaq::Fragment::sequence_id_t events)
+{
+	auto dataset = openDataset(dataset_ps);
+	requireAllEvents(*dataset, events);
+}
+
+// Writes the events through a TeeDataset with a HighFiveStreamDataset and a HighFiveNtupleDataset child, and reads both files back
+void roundTrip(std::string const& name, std::string const& config)
+{
+	std::string streamFile = "TeeDataset_t_" + name + "_stream.hdf5";
+	std::string ntupleFile = "TeeDataset_t_" + name + "_ntuple.hdf5";
+	writeEvents(*openDataset(makeTeeConfig("write", config, {makeDatasetConfig("highFiveStreamDataset", streamFile, "write"), makeDatasetConfig("highFiveNtupleDataset", ntupleFile, "write")})), 8);
+
+	readFile(makeDatasetConfig("highFiveStreamDataset", streamFile, "read"), 8);
+	readFile(makeDatasetConfig("highFiveNtupleDataset", ntupleFile, "read"), 8);
+
+	// In read mode, the TeeDataset reads its first child
+	readFile(makeTeeConfig("read", "", {makeDatasetConfig("highFiveStreamDataset", streamFile, "read")}), 8);
+
+	std::remove(streamFile.c_str());
+	std::remove(ntupleFile.c_str());
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(TeeDataset_test)
+
+BOOST_AUTO_TEST_CASE(Synchronous)
+{
+	roundTrip("Synchronous", "");
+}
+
+BOOST_AUTO_TEST_CASE(Parallel)
+{
+	roundTrip("Parallel", "parallel: true");
+}
+
+BOOST_AUTO_TEST_CASE(Queued)
+{
+	roundTrip("Queued", "queueDepth: 3");
+}
+
+BOOST_AUTO_TEST_CASE(NoChildren)
+{
+	BOOST_REQUIRE_THROW(openDataset(makeTeeConfig("write", "", {})), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+#include "tracemf.h"
+
+#include "artdaq-demo-hdf5/HDF5/highFive/highFiveDatasetHelper.hh"
+
+#define BOOST_TEST_MODULE highFiveDatasetHelper_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr size_t ChunkSize = 4;
+
+HighFive::DataSet createColumn(HighFive::File& file, std::string const& name)
+{
+	HighFive::DataSetCreateProps props;
+	props.add(HighFive::Chunking(std::vector<hsize_t>{ChunkSize, 1}));
+	return file.createDataSet<uint64_t>(name, HighFive::DataSpace({0, 1}, {HighFive::DataSpace::UNLIMITED, 1}), props);
+}
+
+uint64_t storedRowCount(HighFive::DataSet const& dataset)
+{
+	uint64_t rows = 0;
+	dataset.getAttribute("rowCount").read(rows);
+	return rows;
+}
+
+void writeRows(artdaq::hdf5::HighFiveDatasetHelper& helper, uint64_t first, uint64_t count)
+{
+	for (uint64_t value = first; value < first + count; ++value) helper.write(value);
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(highFiveDatasetHelper_test)
+
+BOOST_AUTO_TEST_CASE(TrimOnClose)
+{
+	std::string fileName = "highFiveDatasetHelper_t_TrimOnClose.hdf5";
+	{
+		HighFive::File file(fileName, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
+		auto dataset = createColumn(file, "column");
+		artdaq::hdf5::HighFiveDatasetHelper helper(dataset, ChunkSize);
+
+		// The extent grows one chunk at a time, ahead of the rows written
+		writeRows(helper, 1, 10);
+		BOOST_REQUIRE_EQUAL(helper.getDatasetSize(), 10u);
+		BOOST_REQUIRE_EQUAL(helper.getResizeCount(), 3u);
+		BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 12u);
+		BOOST_REQUIRE(!dataset.hasAttribute("rowCount"));
+
+		helper.close();
+		BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 10u);
+		BOOST_REQUIRE_EQUAL(storedRowCount(dataset), 10u);
+
+		// Writing after close() grows the dataset again (back to whole chunks), and the next close trims it again
+		writeRows(helper, 11, 3);
+		BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 16u);
+		helper.close();
+		BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 13u);
+		BOOST_REQUIRE_EQUAL(storedRowCount(dataset), 13u);
+	}
+	{
+		HighFive::File file(fileName, HighFive::File::ReadOnly);
+		artdaq::hdf5::HighFiveDatasetHelper helper(file.getDataSet("column"));
+		BOOST_REQUIRE_EQUAL(helper.getDatasetSize(), 13u);
+		auto values = helper.readColumn<uint64_t>();
+		BOOST_REQUIRE_EQUAL(values.size(), 13u);
+		for (size_t ii = 0; ii < values.size(); ++ii) BOOST_REQUIRE_EQUAL(values[ii], ii + 1);
+	}
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(TrimOnDestruction)
+{
+	std::string fileName = "highFiveDatasetHelper_t_TrimOnDestruction.hdf5";
+	HighFive::File file(fileName, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
+	auto dataset = createColumn(file, "column");
+	{
+		artdaq::hdf5::HighFiveDatasetHelper helper(dataset, ChunkSize);
+		writeRows(helper, 1, 5);
+	}
+	BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 5u);
+	BOOST_REQUIRE_EQUAL(storedRowCount(dataset), 5u);
+
+	// A helper which did not write does not change the dataset
+	auto unwritten = createColumn(file, "unwritten");
+	{
+		artdaq::hdf5::HighFiveDatasetHelper helper(unwritten, ChunkSize);
+	}
+	BOOST_REQUIRE_EQUAL(unwritten.getDimensions()[0], 0u);
+	BOOST_REQUIRE(!unwritten.hasAttribute("rowCount"));
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(GeometricGrowth)
+{
+	std::string fileName = "highFiveDatasetHelper_t_GeometricGrowth.hdf5";
+	HighFive::File file(fileName, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
+	auto dataset = createColumn(file, "column");
+	artdaq::hdf5::HighFiveDatasetHelper helper(dataset, ChunkSize);
+	helper.setExtentGrowth(2.0);
+
+	// Extents of 4, 8, 16 and 32 rows: whole chunks, at least one chunk larger each time
+	writeRows(helper, 1, 20);
+	BOOST_REQUIRE_EQUAL(helper.getResizeCount(), 4u);
+	BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 32u);
+
+	helper.close();
+	BOOST_REQUIRE_EQUAL(dataset.getDimensions()[0], 20u);
+	BOOST_REQUIRE_EQUAL(storedRowCount(dataset), 20u);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(RowCount)
+{
+	std::string fileName = "highFiveDatasetHelper_t_RowCount.hdf5";
+	HighFive::File file(fileName, HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate);
+
+	// A padded extent without the attribute (file not closed by the writer) is read whole
+	auto dataset = createColumn(file, "column");
+	dataset.resize({8, 1});
+	BOOST_REQUIRE_EQUAL(artdaq::hdf5::HighFiveDatasetHelper::rowCount(dataset), 8u);
+
+	artdaq::hdf5::HighFiveDatasetHelper::writeRowCount(dataset, 6);
+	BOOST_REQUIRE_EQUAL(artdaq::hdf5::HighFiveDatasetHelper::rowCount(dataset), 6u);
+	BOOST_REQUIRE_EQUAL(artdaq::hdf5::HighFiveDatasetHelper(dataset).getDatasetSize(), 6u);
+
+	// The attribute is overwritten, and never counts rows past the extent
+	artdaq::hdf5::HighFiveDatasetHelper::writeRowCount(dataset, 100);
+	BOOST_REQUIRE_EQUAL(storedRowCount(dataset), 100u);
+	BOOST_REQUIRE_EQUAL(artdaq::hdf5::HighFiveDatasetHelper::rowCount(dataset), 8u);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+#define BOOST_TEST_MODULE highFiveGroupedDataset_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include "DatasetTestUtils.hh"
+
+#include <cstdio>
+#include <string>
+
+using namespace artdaq::hdf5::test;
+
+namespace {
+void roundTrip(std::string const& fileName, size_t eventsPerBatch, artdaq::Fragment::sequence_id_t events)
+{
+	auto config = "openEventGroups: 2 eventsPerBatch: " + std::to_string(eventsPerBatch);
+	writeFile("highFiveGroupedDataset", fileName, config, events);
+
+	auto dataset = openDataset("highFiveGroupedDataset", fileName, "read", config);
+	// Event groups are visited in group name order, which is not sequence ID order
+	requireAllEvents(*dataset, events);
+
+	// Random access, including events in the middle and at the end of a batch
+	requireEvent(events, dataset->readEvent(events));
+	requireEvent(2, dataset->readEvent(2));
+	BOOST_REQUIRE(dataset->readEvent(events + 1).empty());
+
+	auto summaries = dataset->scanEvents();
+	BOOST_REQUIRE_EQUAL(summaries.size(), events);
+	for (auto const& summary : summaries)
+	{
+		BOOST_REQUIRE(summary.has_header);
+		BOOST_REQUIRE_EQUAL(summary.event_id, makeHeader(summary.sequence_id).event_id);
+		BOOST_REQUIRE_EQUAL(summary.fragment_types.at(1).count, 2u);
+		BOOST_REQUIRE_EQUAL(summary.fragment_types.at(2).count, 1u);
+	}
+
+	dataset.reset();
+	std::remove(fileName.c_str());
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(highFiveGroupedDataset_test)
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+	roundTrip("highFiveGroupedDataset_t_RoundTrip.hdf5", 1, 6);
+}
+
+BOOST_AUTO_TEST_CASE(Batched)
+{
+	// The last batch is only partly filled, and is written when the file is closed
+	roundTrip("highFiveGroupedDataset_t_Batched.hdf5", 4, 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+#define BOOST_TEST_MODULE highFiveNtupleDataset_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include "DatasetTestUtils.hh"
+
+#include "artdaq-demo-hdf5/HDF5/highFive/HighFive/include/highfive/H5File.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace artdaq::hdf5::test;
+
+namespace {
+// Fragments span several 8-word rows, except in tables which size their rows from the first Fragment
+std::string const NtupleConfig = "nWordsPerRow: 8 payloadChunkSize: 4 headerChunkSize: 4 ";
+
+void writeFile(std::string const& fileName, std::string const& extra, artdaq::Fragment::sequence_id_t events)
+{
+	artdaq::hdf5::test::writeFile("highFiveNtupleDataset", fileName, NtupleConfig + extra, events);
+}
+
+void readFile(std::string const& fileName, std::string const& extra, artdaq::Fragment::sequence_id_t events)
+{
+	auto dataset = openDataset("highFiveNtupleDataset", fileName, "read", NtupleConfig + extra);
+	requireAllEvents(*dataset, events);
+
+	requireEvent(2, dataset->readEvent(2));
+	requireEvent(events, dataset->readEvent(events));
+	BOOST_REQUIRE(dataset->readEvent(events + 1).empty());
+}
+
+void requireHeaders(std::string const& fileName, artdaq::Fragment::sequence_id_t events)
+{
+	auto dataset = openDataset("highFiveNtupleDataset", fileName, "read", NtupleConfig);
+	for (artdaq::Fragment::sequence_id_t seqID = 1; seqID <= events; ++seqID)
+	{
+		requireHeader(seqID, dataset->getEventHeader(seqID));
+	}
+	BOOST_REQUIRE(!dataset->getEventHeader(0));
+	BOOST_REQUIRE(!dataset->getEventHeader(events + 1));
+
+	auto summaries = dataset->scanEvents();
+	BOOST_REQUIRE_EQUAL(summaries.size(), events);
+	for (auto const& summary : summaries)
+	{
+		BOOST_REQUIRE(summary.has_header);
+		BOOST_REQUIRE_EQUAL(summary.event_id, makeHeader(summary.sequence_id).event_id);
+		BOOST_REQUIRE_EQUAL(summary.is_complete, makeHeader(summary.sequence_id).is_complete);
+		BOOST_REQUIRE_EQUAL(summary.fragment_types.at(1).count, 2u);
+		BOOST_REQUIRE_EQUAL(summary.fragment_types.at(2).count, 1u);
+	}
+}
+
+template<typename T>
+void writeLegacyColumn(HighFive::Group& group, std::string const& name, std::vector<T> const& values)
+{
+	std::vector<std::vector<T>> rows;
+	for (auto const& value : values) rows.push_back(std::vector<T>{value});
+	group.createDataSet<T>(name, HighFive::DataSpace({rows.size(), 1})).write(rows);
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(highFiveNtupleDataset_test)
+
+BOOST_AUTO_TEST_CASE(SingleTable)
+{
+	std::string fileName = "highFiveNtupleDataset_t_SingleTable.hdf5";
+	writeFile(fileName, "writeChecksums: true", 9);
+	readFile(fileName, "verifyChecksums: true", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(TypeTables)
+{
+	// Type 1 uses the configured row width, type 2 sizes its rows from its first Fragment
+	std::string fileName = "highFiveNtupleDataset_t_TypeTables.hdf5";
+	writeFile(fileName, "tableMode: type fragmentTables: [{ fragmentType: 1 nWordsPerRow: 8 }] writeChecksums: true", 9);
+	readFile(fileName, "verifyChecksums: true", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(InstanceTables)
+{
+	std::string fileName = "highFiveNtupleDataset_t_InstanceTables.hdf5";
+	writeFile(fileName, "tableMode: instance", 9);
+	readFile(fileName, "", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(Compressed)
+{
+	std::string fileName = "highFiveNtupleDataset_t_Compressed.hdf5";
+	writeFile(fileName, "tableMode: type fileProfile: { deflateLevel: 1 } compressionThreads: 2", 9);
+	readFile(fileName, "decompressionThreads: 2", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(EventHeaders)
+{
+	// Headers span several chunks of the compound-typed table
+	std::string fileName = "highFiveNtupleDataset_t_EventHeaders.hdf5";
+	writeFile(fileName, "", 9);
+	{
+		HighFive::File file(fileName, HighFive::File::ReadOnly);
+		BOOST_REQUIRE(file.exist("/EventHeaders/records"));
+		BOOST_REQUIRE(!file.exist("/EventHeaders/sequenceID"));
+	}
+	requireHeaders(fileName, 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(LegacyEventHeaders)
+{
+	// Replace the header table with the per-field columns of older files: two zero-filled rows at the end,
+	// and one column a row shorter than the others (a file closed while a header was being written)
+	std::string fileName = "highFiveNtupleDataset_t_LegacyEventHeaders.hdf5";
+	writeFile(fileName, "", 9);
+	{
+		HighFive::File file(fileName, HighFive::File::ReadWrite);
+		auto group = file.getGroup("/EventHeaders");
+		BOOST_REQUIRE(H5Ldelete(group.getId(), "records", H5P_DEFAULT) >= 0);
+
+		std::vector<uint64_t> seqIDs, timestamps;
+		std::vector<uint32_t> runIDs, subrunIDs, eventIDs;
+		std::vector<uint8_t> isCompletes;
+		// Headers in reverse order, readers sort them by sequence ID
+		for (artdaq::Fragment::sequence_id_t seqID = 9; seqID >= 1; --seqID)
+		{
+			auto hdr = makeHeader(seqID);
+			seqIDs.push_back(hdr.sequence_id);
+			runIDs.push_back(hdr.run_id);
+			subrunIDs.push_back(hdr.subrun_id);
+			eventIDs.push_back(hdr.event_id);
+			timestamps.push_back(hdr.timestamp);
+			isCompletes.push_back(hdr.is_complete ? 1 : 0);
+		}
+		isCompletes.push_back(0);
+		for (size_t ii = 0; ii < 2; ++ii)
+		{
+			seqIDs.push_back(0);
+			runIDs.push_back(0);
+			subrunIDs.push_back(0);
+			eventIDs.push_back(0);
+			timestamps.push_back(0);
+		}
+
+		writeLegacyColumn(group, "sequenceID", seqIDs);
+		writeLegacyColumn(group, "run_id", runIDs);
+		writeLegacyColumn(group, "subrun_id", subrunIDs);
+		writeLegacyColumn(group, "event_id", eventIDs);
+		writeLegacyColumn(group, "timestamp", timestamps);
+		writeLegacyColumn(group, "is_complete", isCompletes);
+	}
+	requireHeaders(fileName, 9);
+	readFile(fileName, "", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+#define BOOST_TEST_MODULE highFiveStreamDataset_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include "DatasetTestUtils.hh"
+
+#include <cstdio>
+#include <string>
+
+using namespace artdaq::hdf5::test;
+
+namespace {
+// Small chunks, so that Fragments straddle the chunks of their source's data dataset
+std::string const StreamConfig = "dataChunkWords: 16 indexChunkSize: 4 ";
+
+void readFile(std::string const& fileName, std::string const& extra, artdaq::Fragment::sequence_id_t events)
+{
+	auto dataset = openDataset("highFiveStreamDataset", fileName, "read", StreamConfig + extra);
+	requireAllEvents(*dataset, events);
+
+	// Random access does not depend on the readNextEvent position
+	requireEvent(3, dataset->readEvent(3));
+	requireEvent(1, dataset->readEvent(1));
+	BOOST_REQUIRE(dataset->readEvent(events + 1).empty());
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(highFiveStreamDataset_test)
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+	std::string fileName = "highFiveStreamDataset_t_RoundTrip.hdf5";
+	writeFile("highFiveStreamDataset", fileName, StreamConfig, 9);
+	readFile(fileName, "", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(Compressed)
+{
+	std::string fileName = "highFiveStreamDataset_t_Compressed.hdf5";
+	writeFile("highFiveStreamDataset", fileName, StreamConfig + "fileProfile: { deflateLevel: 1 } compressionThreads: 2", 9);
+	readFile(fileName, "decompressionThreads: 2", 9);
+	readFile(fileName, "", 9);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(Checksums)
+{
+	std::string fileName = "highFiveStreamDataset_t_Checksums.hdf5";
+	writeFile("highFiveStreamDataset", fileName, StreamConfig + "writeChecksums: true", 5);
+
+	auto dataset = openDataset("highFiveStreamDataset", fileName, "read", "verifyChecksums: true");
+	while (!dataset->readNextEvent().empty())
+	{
+	}
+	BOOST_REQUIRE_EQUAL(dataset->getChecksumsVerified(), 15u);
+	BOOST_REQUIRE(dataset->getChecksumErrors().empty());
+	dataset.reset();
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
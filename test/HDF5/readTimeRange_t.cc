@@ -0,0 +1,147 @@
+#define BOOST_TEST_MODULE readTimeRange_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include "DatasetTestUtils.hh"
+
+#include <cstdio>
+#include <string>
+
+using namespace artdaq::hdf5::test;
+
+namespace {
+constexpr artdaq::Fragment::type_t FramedType = 3;
+constexpr artdaq::Fragment::fragment_id_t FramedID = 10;
+constexpr size_t FrameWords = 4;
+constexpr size_t FramesPerFragment = 8;
+
+// Frames of the framed Fragment of event seqID are 10 ticks apart, starting at 100 * seqID. The frame timestamp
+// is the second word of the frame, the other words identify the frame.
+artdaq::Fragment makeFramedFragment(artdaq::Fragment::sequence_id_t seqID)
+{
+	auto frag = makeFragment(seqID, FramedID, FramedType, FrameWords * FramesPerFragment);
+	frag.setTimestamp(100 * seqID);
+	for (size_t frame = 0; frame < FramesPerFragment; ++frame)
+	{
+		auto data = frag.dataBegin() + frame * FrameWords;
+		data[1] = 100 * seqID + 10 * frame;
+	}
+	return frag;
+}
+
+artdaq::Fragment makeTimedFragment(artdaq::Fragment::sequence_id_t seqID, artdaq::Fragment::fragment_id_t id, uint64_t timestamp)
+{
+	auto frag = makeFragment(seqID, id, 1, 5);
+	frag.setTimestamp(timestamp);
+	*frag.dataBegin() = timestamp;
+	return frag;
+}
+
+// Each event has a framed Fragment covering [100 * seqID, 100 * seqID + 70], and two unframed Fragments with
+// timestamps 100 * seqID + 5 (ID 0) and 100 * seqID + 50 (ID 1)
+artdaq::Fragments makeTimedEvent(artdaq::Fragment::sequence_id_t seqID)
+{
+	return artdaq::Fragments{makeTimedFragment(seqID, 0, 100 * seqID + 5), makeTimedFragment(seqID, 1, 100 * seqID + 50), makeFramedFragment(seqID)};
+}
+
+std::string const FrameFormats = "frameFormats: [{ fragmentType: " + std::to_string(FramedType) + " frameWords: " + std::to_string(FrameWords) + " timestampWord: 1 }]";
+
+void requireFragment(artdaq::Fragment const& frag, artdaq::Fragment::sequence_id_t seqID, artdaq::Fragment::fragment_id_t id)
+{
+	BOOST_REQUIRE_EQUAL(frag.sequenceID(), seqID);
+	BOOST_REQUIRE_EQUAL(frag.fragmentID(), id);
+}
+
+// Checks that a framed Fragment holds frames [first, first + count) of its event
+void requireFrames(artdaq::Fragment const& frag, size_t first, size_t count)
+{
+	BOOST_REQUIRE_EQUAL(frag.type(), FramedType);
+	BOOST_REQUIRE_EQUAL(frag.dataSize(), count * FrameWords);
+	auto expected = makeFramedFragment(frag.sequenceID());
+	BOOST_REQUIRE(std::equal(frag.dataBegin(), frag.dataEnd(), expected.dataBegin() + first * FrameWords));
+}
+
+void checkPlugin(std::string const& pluginType)
+{
+	std::string fileName = "readTimeRange_t_" + pluginType + ".hdf5";
+	writeFile(pluginType, fileName, FrameFormats, 6, makeTimedEvent);
+	auto dataset = openDataset(pluginType, fileName, "read", FrameFormats);
+
+	auto index = dataset->getTimeIndex();
+	BOOST_REQUIRE_EQUAL(index.size(), 18u);
+	for (auto const& entry : index)
+	{
+		if (entry.type != FramedType) continue;
+		BOOST_REQUIRE_EQUAL(entry.frame_count, FramesPerFragment);
+		BOOST_REQUIRE_EQUAL(entry.first_timestamp, 100 * entry.sequence_id);
+		BOOST_REQUIRE_EQUAL(entry.last_timestamp, 100 * entry.sequence_id + 70);
+	}
+
+	// [220, 345) overlaps frames 2-7 and Fragment 1 of event 2, and frames 0-4 and Fragment 0 of event 3
+	auto frags = dataset->readTimeRange(220, 345);
+	sortFragments(frags);
+	BOOST_REQUIRE_EQUAL(frags.size(), 4u);
+	requireFragment(frags[0], 2, 1);
+	requireFragment(frags[1], 2, FramedID);
+	requireFrames(frags[1], 2, 6);
+	requireFragment(frags[2], 3, 0);
+	requireFragment(frags[3], 3, FramedID);
+	requireFrames(frags[3], 0, 5);
+
+	artdaq::hdf5::FragmentTimeRangeFilter untrimmed;
+	untrimmed.trim_frames = false;
+	frags = dataset->readTimeRange(220, 345, untrimmed);
+	sortFragments(frags);
+	BOOST_REQUIRE_EQUAL(frags.size(), 4u);
+	requireFrames(frags[1], 0, FramesPerFragment);
+	requireFrames(frags[3], 0, FramesPerFragment);
+
+	artdaq::hdf5::FragmentTimeRangeFilter framedOnly;
+	framedOnly.types.insert(FramedType);
+	frags = dataset->readTimeRange(220, 345, framedOnly);
+	sortFragments(frags);
+	BOOST_REQUIRE_EQUAL(frags.size(), 2u);
+	requireFrames(frags[0], 2, 6);
+	requireFrames(frags[1], 0, 5);
+
+	artdaq::hdf5::FragmentTimeRangeFilter idZero;
+	idZero.fragment_ids.insert(0);
+	frags = dataset->readTimeRange(220, 345, idZero);
+	BOOST_REQUIRE_EQUAL(frags.size(), 1u);
+	requireFragment(frags[0], 3, 0);
+	BOOST_REQUIRE_EQUAL(*frags[0].dataBegin(), 305u);
+
+	// A range between frames of a framed Fragment returns no frames of it
+	frags = dataset->readTimeRange(431, 439);
+	BOOST_REQUIRE(frags.empty());
+	BOOST_REQUIRE(dataset->readTimeRange(1000, 2000).empty());
+
+	// readTimeRange does not move the readNextEvent position
+	auto event = dataset->readNextEvent();
+	BOOST_REQUIRE(!event.empty());
+	BOOST_REQUIRE_EQUAL(event.begin()->second->front().sequenceID(), 1u);
+
+	dataset.reset();
+	std::remove(fileName.c_str());
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(readTimeRange_test)
+
+BOOST_AUTO_TEST_CASE(StreamDataset)
+{
+	// Reads single Fragments (readIndexedFragments override)
+	checkPlugin("highFiveStreamDataset");
+}
+
+BOOST_AUTO_TEST_CASE(NtupleDataset)
+{
+	// Reads whole events (default readIndexedFragments)
+	checkPlugin("highFiveNtupleDataset");
+}
+
+BOOST_AUTO_TEST_CASE(GroupedDataset)
+{
+	checkPlugin("highFiveGroupedDataset");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
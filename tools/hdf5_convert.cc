@@ -0,0 +1,226 @@
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+#include "artdaq-demo-hdf5/Reader/DatasetReader.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include <hdf5.h>
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+void usage(const char* argv0)
+{
+	std::cerr << "Usage: " << argv0 << " [options] <inputFile> <outputFile>" << std::endl
+	          << "  Copies the events of a file written by one FragmentDataset plugin into a new file written by another," << std::endl
+	          << "  without art. Events are read and written by separate threads, connected by a bounded queue." << std::endl
+	          << "  -i <plugin>: Dataset plugin used to read the input (Default: highFiveGroupedDataset)" << std::endl
+	          << "  -o <plugin>: Dataset plugin used to write the output (Default: highFiveGroupedDataset)" << std::endl
+	          << "  -I <fhicl>: Extra input dataset parameters, e.g. 'decompressionThreads: 4'" << std::endl
+	          << "  -O <fhicl>: Extra output dataset parameters, e.g. 'nWordsPerRow: 1024 fileProfile: { preset: \"daq_write\" }'" << std::endl
+	          << "  -t <types>: Comma-separated Fragment types to copy (Default: all)" << std::endl
+	          << "  -f <ids>: Comma-separated Fragment IDs to copy (Default: all)" << std::endl
+	          << "  -r <first>:<last>: Only copy events with sequence IDs in [first, last] (either may be omitted)" << std::endl
+	          << "  -n <count>: Stop after copying this many events" << std::endl
+	          << "  -q <events>: Queue depth between the reader and the writer (Default: 16)" << std::endl;
+}
+
+template<typename T>
+std::set<T> parseList(std::string const& list)
+{
+	std::set<T> output;
+	std::istringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty()) output.insert(static_cast<T>(std::stoul(item)));
+	}
+	return output;
+}
+
+fhicl::ParameterSet makeDatasetConfig(std::string const& pluginType, std::string const& fileName, std::string const& extra)
+{
+	auto dataset_ps = fhicl::ParameterSet::make(extra);
+	dataset_ps.put_or_replace<std::string>("datasetPluginType", pluginType);
+	dataset_ps.put_or_replace<std::string>("fileName", fileName);
+	return dataset_ps;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	std::string inputPlugin = "highFiveGroupedDataset";
+	std::string outputPlugin = "highFiveGroupedDataset";
+	std::string inputExtra, outputExtra;
+	std::set<artdaq::Fragment::type_t> types;
+	std::set<artdaq::Fragment::fragment_id_t> fragmentIDs;
+	artdaq::Fragment::sequence_id_t firstSeqID = 0;
+	artdaq::Fragment::sequence_id_t lastSeqID = std::numeric_limits<artdaq::Fragment::sequence_id_t>::max();
+	size_t maxEvents = std::numeric_limits<size_t>::max();
+	size_t queueDepth = 16;
+	std::vector<std::string> files;
+
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		auto hasValue = ii + 1 < argc;
+		if (strcmp(argv[ii], "-i") == 0 && hasValue)
+		{
+			inputPlugin = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-o") == 0 && hasValue)
+		{
+			outputPlugin = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-I") == 0 && hasValue)
+		{
+			inputExtra = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-O") == 0 && hasValue)
+		{
+			outputExtra = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-t") == 0 && hasValue)
+		{
+			types = parseList<artdaq::Fragment::type_t>(argv[++ii]);
+		}
+		else if (strcmp(argv[ii], "-f") == 0 && hasValue)
+		{
+			fragmentIDs = parseList<artdaq::Fragment::fragment_id_t>(argv[++ii]);
+		}
+		else if (strcmp(argv[ii], "-r") == 0 && hasValue)
+		{
+			std::string range = argv[++ii];
+			auto colon = range.find(':');
+			if (colon == std::string::npos)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			if (colon > 0) firstSeqID = std::stoull(range.substr(0, colon));
+			if (colon + 1 < range.size()) lastSeqID = std::stoull(range.substr(colon + 1));
+		}
+		else if (strcmp(argv[ii], "-n") == 0 && hasValue)
+		{
+			maxEvents = std::stoul(argv[++ii]);
+		}
+		else if (strcmp(argv[ii], "-q") == 0 && hasValue)
+		{
+			queueDepth = std::stoul(argv[++ii]);
+		}
+		else if (strcmp(argv[ii], "-h") == 0 || strcmp(argv[ii], "--help") == 0)
+		{
+			usage(argv[0]);
+			return 0;
+		}
+		else
+		{
+			files.emplace_back(argv[ii]);
+		}
+	}
+
+	if (files.size() != 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	// A serial (non-threadsafe) HDF5 library must only be entered by one thread at a time. The threads then still
+	// overlap everything outside the library: copies, projection, and the plugins' own worker pools.
+	hbool_t threadsafe = 0;
+	H5is_library_threadsafe(&threadsafe);
+	std::mutex hdf5Mutex;
+	auto hdf5Lock = [&] { return threadsafe != 0 ? std::unique_lock<std::mutex>() : std::unique_lock<std::mutex>(hdf5Mutex); };
+	if (threadsafe == 0)
+	{
+		std::cerr << "HDF5 library is not thread-safe, HDF5 calls of the reader and writer threads will be serialized" << std::endl;
+	}
+
+	// The DatasetReader reads ahead on its own thread, into a queue of queueDepth events
+	artdaq::hdf5::DatasetReaderOptions options;
+	options.types = types;
+	options.fragment_ids = fragmentIDs;
+	options.first_sequence_id = firstSeqID;
+	options.last_sequence_id = lastSeqID;
+	options.prefetch = queueDepth > 0 ? queueDepth : 1;
+	options.hdf5_mutex = threadsafe != 0 ? nullptr : &hdf5Mutex;
+
+	// The output is opened first: the reader thread makes HDF5 calls as soon as the DatasetReader exists
+	auto output_ps = makeDatasetConfig(outputPlugin, files[1], outputExtra);
+	output_ps.put_or_replace<std::string>("mode", "write");
+	fhicl::ParameterSet outputConfig;
+	outputConfig.put<fhicl::ParameterSet>("dataset", output_ps);
+	auto output = artdaq::hdf5::MakeDatasetPlugin(outputConfig, "dataset");
+	auto input = std::make_unique<artdaq::hdf5::DatasetReader>(makeDatasetConfig(inputPlugin, files[0], inputExtra), options);
+
+	size_t eventsWritten = 0;
+	size_t fragmentsWritten = 0;
+	size_t bytesWritten = 0;
+	int status = 0;
+	auto start_time = std::chrono::steady_clock::now();
+	auto report_time = start_time;
+	while (eventsWritten < maxEvents)
+	{
+		std::unique_ptr<artdaq::hdf5::DatasetEvent> event;
+		try
+		{
+			event = input->next();
+		}
+		catch (std::exception const& ex)
+		{
+			std::cerr << "Error reading " << files[0] << ": " << ex.what() << std::endl;
+			status = 2;
+			break;
+		}
+		catch (...)
+		{
+			std::cerr << "Unknown error reading " << files[0] << std::endl;
+			status = 2;
+			break;
+		}
+		if (!event) break;
+
+		try
+		{
+			auto lk = hdf5Lock();
+			if (event->header() != nullptr) output->insertHeader(*event->header());
+			for (auto const& type : event->release())
+			{
+				output->insertMany(*type.second);
+				fragmentsWritten += type.second->size();
+				for (auto const& frag : *type.second) bytesWritten += frag.sizeBytes();
+			}
+		}
+		catch (std::exception const& ex)
+		{
+			std::cerr << "Error writing " << files[1] << ": " << ex.what() << std::endl;
+			status = 2;
+			break;
+		}
+		eventsWritten++;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - report_time > std::chrono::seconds(10))
+		{
+			report_time = now;
+			auto elapsed = std::chrono::duration<double>(now - start_time).count();
+			std::cerr << "Copied " << eventsWritten << " events, " << bytesWritten / 1048576.0 << " MiB (" << bytesWritten / 1048576.0 / elapsed << " MiB/s)" << std::endl;
+		}
+	}
+
+	// Stopping the reader joins its thread; closing the output then flushes any data the plugin still holds
+	input.reset();
+	output.reset();
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	std::cerr << "Wrote " << eventsWritten << " events (" << fragmentsWritten << " Fragments, "
+	          << bytesWritten / 1048576.0 << " MiB) in " << elapsed << " s (" << (elapsed > 0 ? bytesWritten / 1048576.0 / elapsed : 0) << " MiB/s)" << std::endl;
+	return status;
+}
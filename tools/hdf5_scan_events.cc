@@ -0,0 +1,74 @@
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+void usage(const char* argv0)
+{
+	std::cerr << "Usage: " << argv0 << " [-p <datasetPluginType>] <fileName>" << std::endl
+	          << "  Prints one line per event (sequence ID, run, subrun, event, timestamp, is_complete," << std::endl
+	          << "  and count/bytes for each Fragment type) using only header columns and attributes." << std::endl
+	          << "  -p: Dataset plugin used to read the file (Default: highFiveGroupedDataset)" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	std::string pluginType = "highFiveGroupedDataset";
+	std::string fileName;
+
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		if (strcmp(argv[ii], "-p") == 0 && ii + 1 < argc)
+		{
+			pluginType = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-h") == 0 || strcmp(argv[ii], "--help") == 0)
+		{
+			usage(argv[0]);
+			return 0;
+		}
+		else
+		{
+			fileName = argv[ii];
+		}
+	}
+
+	if (fileName.empty())
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	fhicl::ParameterSet dataset_ps;
+	dataset_ps.put<std::string>("datasetPluginType", pluginType);
+	dataset_ps.put<std::string>("mode", "read");
+	dataset_ps.put<std::string>("fileName", fileName);
+	fhicl::ParameterSet ps;
+	ps.put<fhicl::ParameterSet>("dataset", dataset_ps);
+
+	auto start_time = std::chrono::steady_clock::now();
+	auto dataset = artdaq::hdf5::MakeDatasetPlugin(ps, "dataset");
+	auto events = dataset->scanEvents();
+	auto scan_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	std::cout << "# sequence_id run subrun event timestamp is_complete [type:count:bytes ...]" << std::endl;
+	for (auto const& evt : events)
+	{
+		std::cout << evt.sequence_id << " " << evt.run_id << " " << evt.subrun_id << " " << evt.event_id << " " << evt.timestamp << " "
+		          << (evt.has_header ? std::to_string(static_cast<int>(evt.is_complete)) : std::string("-"));
+		for (auto const& type : evt.fragment_types)
+		{
+			std::cout << " " << static_cast<int>(type.first) << ":" << type.second.count << ":" << type.second.bytes;
+		}
+		std::cout << std::endl;
+	}
+	std::cerr << "Scanned " << events.size() << " events in " << scan_time << " s" << std::endl;
+
+	return 0;
+}
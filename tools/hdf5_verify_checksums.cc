@@ -0,0 +1,109 @@
+#include "artdaq-demo-hdf5/HDF5/MakeDatasetPlugin.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+void usage(const char* argv0)
+{
+	std::cerr << "Usage: " << argv0 << " [-p <datasetPluginType>] [-t <decompressionThreads>] <fileName>" << std::endl
+	          << "  Reads every event of the file and checks each Fragment against the checksum stored when it was written" << std::endl
+	          << "  (see the writeChecksums dataset parameter). Prints one line per mismatching Fragment (sequence ID, type," << std::endl
+	          << "  Fragment ID, stored and computed checksum), then a summary." << std::endl
+	          << "  -p: Dataset plugin used to read the file (Default: highFiveGroupedDataset)" << std::endl
+	          << "  -t: Decompression threads, for plugins which support them (Default: 0)" << std::endl
+	          << "  Exit status: 0 if all checksums match, 1 on usage errors, 2 if any Fragment mismatches, 3 if the file has no checksums" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	std::string pluginType = "highFiveGroupedDataset";
+	std::string fileName;
+	size_t decompressionThreads = 0;
+
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		if (strcmp(argv[ii], "-p") == 0 && ii + 1 < argc)
+		{
+			pluginType = argv[++ii];
+		}
+		else if (strcmp(argv[ii], "-t") == 0 && ii + 1 < argc)
+		{
+			decompressionThreads = std::stoul(argv[++ii]);
+		}
+		else if (strcmp(argv[ii], "-h") == 0 || strcmp(argv[ii], "--help") == 0)
+		{
+			usage(argv[0]);
+			return 0;
+		}
+		else
+		{
+			fileName = argv[ii];
+		}
+	}
+
+	if (fileName.empty())
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	fhicl::ParameterSet dataset_ps;
+	dataset_ps.put<std::string>("datasetPluginType", pluginType);
+	dataset_ps.put<std::string>("mode", "read");
+	dataset_ps.put<std::string>("fileName", fileName);
+	dataset_ps.put<bool>("verifyChecksums", true);
+	dataset_ps.put<bool>("checksumErrorsFatal", false);
+	dataset_ps.put<size_t>("decompressionThreads", decompressionThreads);
+	fhicl::ParameterSet ps;
+	ps.put<fhicl::ParameterSet>("dataset", dataset_ps);
+
+	auto start_time = std::chrono::steady_clock::now();
+	auto dataset = artdaq::hdf5::MakeDatasetPlugin(ps, "dataset");
+
+	size_t events = 0;
+	size_t bytes = 0;
+	size_t reported = 0;
+	std::cout << "# sequence_id type fragment_id stored computed" << std::endl;
+	while (true)
+	{
+		auto event = dataset->readNextEvent();
+		if (event.empty()) break;
+		events++;
+		for (auto const& type : event)
+		{
+			for (auto const& frag : *type.second)
+			{
+				bytes += frag.sizeBytes();
+			}
+		}
+
+		auto const& errors = dataset->getChecksumErrors();
+		for (; reported < errors.size(); ++reported)
+		{
+			auto const& error = errors[reported];
+			std::cout << error.sequence_id << " " << static_cast<int>(error.type) << " " << error.fragment_id << std::hex
+			          << " 0x" << error.stored << " 0x" << error.computed << std::dec << std::endl;
+		}
+	}
+	auto read_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	auto verified = dataset->getChecksumsVerified();
+	auto failed = dataset->getChecksumErrors().size();
+	std::cerr << "Read " << events << " events (" << bytes / 1048576.0 << " MiB) in " << read_time << " s ("
+	          << (read_time > 0 ? bytes / 1048576.0 / read_time : 0) << " MiB/s)" << std::endl
+	          << "Verified " << verified << " Fragment checksums, " << failed << " mismatches" << std::endl;
+
+	if (failed > 0) return 2;
+	if (verified == 0)
+	{
+		std::cerr << "No Fragment checksums found; was the file written with writeChecksums: true?" << std::endl;
+		return 3;
+	}
+	return 0;
+}